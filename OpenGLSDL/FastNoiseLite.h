@@ -52,6 +52,15 @@
 
 #include <cmath>
 
+// Grid kernels use AVX2 or SSE4.1 when the compiler targets them, otherwise they fall back to scalar code
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define FASTNOISELITE_SIMD_AVX2
+#elif defined(__SSE4_1__) || defined(__AVX__)
+#include <smmintrin.h>
+#define FASTNOISELITE_SIMD_SSE41
+#endif
+
 class FastNoiseLite
 {
 public:
@@ -127,6 +136,10 @@ public:
         mPingPongStrength = 2.0f;
 
         mFractalBounding = 1 / 1.75f;
+        mOctaveLimit = 0;
+        mActiveOctaves = 3;
+        mFadedOctave = -1;
+        mFadedOctaveWeight = 1;
 
         mCellularDistanceFunction = CellularDistanceFunction_EuclideanSq;
         mCellularReturnType = CellularReturnType_Distance;
@@ -198,6 +211,39 @@ public:
     {
         mOctaves = octaves;
         CalculateFractalBounding();
+        CalculateOctaveLimit();
+    }
+
+    /// <summary>
+    /// Limits fractal noise to a fractional number of octaves
+    /// </summary>
+    /// <remarks>
+    /// Default: 0, every octave
+    /// Octaves past the limit are skipped and the last one is faded by the fractional part,
+    /// so the output changes continuously with the limit. The bounding still covers every
+    /// octave, which keeps the low octaves identical to unlimited noise.
+    /// Limits below 1 keep the first octave. Only GetNoise fractals are limited, not DomainWarp.
+    /// </remarks>
+    void SetFractalOctaveLimit(float octaves)
+    {
+        mOctaveLimit = octaves;
+        CalculateOctaveLimit();
+    }
+
+    /// <summary>
+    /// Fractional octave count whose octaves all stay above two samples per wavelength
+    /// </summary>
+    /// <remarks>
+    /// For SetFractalOctaveLimit: octaves finer than this alias on a grid with this spacing.
+    /// Clamped to 1...octave count.
+    /// </remarks>
+    float GetFractalOctavesForSpacing(float sampleSpacing) const
+    {
+        if (sampleSpacing <= 0 || mLacunarity <= 1)
+            return (float)mOctaves;
+
+        float octaves = 1 + std::log(0.5f / (mFrequency * sampleSpacing)) / std::log(mLacunarity);
+        return octaves < 1 ? 1 : octaves > mOctaves ? (float)mOctaves : octaves;
     }
 
     /// <summary>
@@ -297,19 +343,7 @@ public:
     {
         Arguments_must_be_floating_point_values<FNfloat>();
 
-        TransformNoiseCoordinate(x, y);
-
-        switch (mFractalType)
-        {
-        default:
-            return GenNoiseSingle(mSeed, x, y);
-        case FractalType_FBm:
-            return GenFractalFBm(x, y);
-        case FractalType_Ridged:
-            return GenFractalRidged(x, y);
-        case FractalType_PingPong:
-            return GenFractalPingPong(x, y);
-        }
+        return GenNoise<DynamicType, DynamicType>(x, y);
     }
 
     /// <summary>
@@ -323,19 +357,7 @@ public:
     {
         Arguments_must_be_floating_point_values<FNfloat>();
 
-        TransformNoiseCoordinate(x, y, z);
-
-        switch (mFractalType)
-        {
-        default:
-            return GenNoiseSingle(mSeed, x, y, z);
-        case FractalType_FBm:
-            return GenFractalFBm(x, y, z);
-        case FractalType_Ridged:
-            return GenFractalRidged(x, y, z);
-        case FractalType_PingPong:
-            return GenFractalPingPong(x, y, z);
-        }
+        return GenNoise<DynamicType, DynamicType, DynamicType>(x, y, z);
     }
 
 
@@ -393,7 +415,387 @@ public:
         }
     }
 
+    /// <summary>
+    /// 2D noise for a regular grid of samples using current settings
+    /// </summary>
+    /// <remarks>
+    /// Sample (ix, iy) equals GetNoise(xStart + (xFirst + ix) * xStep, yStart + (yFirst + iy) * yStep)
+    /// and is written to out[ix * xStride + iy * yStride].
+    /// yStride 0 means tightly packed rows (countX * xStride).
+    /// xFirst/yFirst place the grid inside a larger lattice, so neighbouring tiles compute
+    /// bit-identical coordinates along their shared edges.
+    /// Noise and fractal type are dispatched once per grid line, and Value noise
+    /// runs an AVX2/SSE4.1 kernel along the axis with unit stride when available.
+    /// </remarks>
+    template <typename FNfloat>
+    void GetNoiseGrid2D(float* out, int countX, int countY,
+        FNfloat xStart, FNfloat yStart, FNfloat xStep, FNfloat yStep,
+        int xStride = 1, int yStride = 0, int xFirst = 0, int yFirst = 0) const
+    {
+        Arguments_must_be_floating_point_values<FNfloat>();
+
+        GridLines2D([this](float* line, int count, int stride, FNfloat xBase, FNfloat xLineStep, int xLineFirst, FNfloat yBase, FNfloat yLineStep, int yLineFirst)
+            {
+                GenGridLine2D(line, count, stride, xBase, xLineStep, xLineFirst, yBase, yLineStep, yLineFirst);
+            },
+            out, countX, countY, xStart, yStart, xStep, yStep, xStride, yStride, xFirst, yFirst);
+    }
+
+    /// <summary>
+    /// 3D noise for a regular grid of samples using current settings
+    /// </summary>
+    /// <remarks>
+    /// Sample (ix, iy, iz) equals GetNoise(xStart + (xFirst + ix) * xStep, yStart + (yFirst + iy) * yStep, zStart + (zFirst + iz) * zStep)
+    /// and is written to out[ix * xStride + iy * yStride + iz * zStride].
+    /// Zero strides mean tightly packed (yStride = countX * xStride, zStride = countY * yStride).
+    /// Value noise without 3D rotation runs an AVX2/SSE4.1 kernel along the unit stride axis.
+    /// </remarks>
+    template <typename FNfloat>
+    void GetNoiseGrid3D(float* out, int countX, int countY, int countZ,
+        FNfloat xStart, FNfloat yStart, FNfloat zStart, FNfloat xStep, FNfloat yStep, FNfloat zStep,
+        int xStride = 1, int yStride = 0, int zStride = 0, int xFirst = 0, int yFirst = 0, int zFirst = 0) const
+    {
+        Arguments_must_be_floating_point_values<FNfloat>();
+
+        GridLines3D([this](float* line, int count, int stride, FNfloat xBase, FNfloat xLineStep, int xLineFirst,
+                FNfloat yBase, FNfloat yLineStep, int yLineFirst, FNfloat zBase, FNfloat zLineStep, int zLineFirst)
+            {
+                GenGridLine3D(line, count, stride, xBase, xLineStep, xLineFirst, yBase, yLineStep, yLineFirst, zBase, zLineStep, zLineFirst);
+            },
+            out, countX, countY, countZ, xStart, yStart, zStart, xStep, yStep, zStep, xStride, yStride, zStride, xFirst, yFirst, zFirst);
+    }
+
+    /// <summary>
+    /// 2D noise at a domain warped position using current settings
+    /// </summary>
+    /// <remarks>
+    /// Same as DomainWarp(x, y) followed by GetNoise(x, y)
+    /// </remarks>
+    template <typename FNfloat>
+    float GetWarpedNoise(FNfloat x, FNfloat y) const
+    {
+        Arguments_must_be_floating_point_values<FNfloat>();
+
+        DomainWarp(x, y);
+        return GetNoise(x, y);
+    }
+
+    /// <summary>
+    /// 2D domain warped noise for a regular grid of samples using current settings
+    /// </summary>
+    /// <remarks>
+    /// Sample (ix, iy) equals GetWarpedNoise at the position GetNoiseGrid2D samples and is
+    /// written to the same place.
+    /// Value noise with an OpenSimplex2 or OpenSimplex2Reduced warp runs the warp and the fractal
+    /// in one AVX2/SSE4.1 pass along each line: the warp offsets stay in registers and feed the
+    /// first octave directly, with no per-sample dispatch in between.
+    /// </remarks>
+    template <typename FNfloat>
+    void GetWarpedNoiseGrid2D(float* out, int countX, int countY,
+        FNfloat xStart, FNfloat yStart, FNfloat xStep, FNfloat yStep,
+        int xStride = 1, int yStride = 0, int xFirst = 0, int yFirst = 0) const
+    {
+        Arguments_must_be_floating_point_values<FNfloat>();
+
+        GridLines2D([this](float* line, int count, int stride, FNfloat xBase, FNfloat xLineStep, int xLineFirst, FNfloat yBase, FNfloat yLineStep, int yLineFirst)
+            {
+                if (GenWarpedGridLineSimd2D(line, count, stride, xBase, xLineStep, xLineFirst, yBase, yLineStep, yLineFirst))
+                    return;
+
+                for (int k = 0; k < count; k++)
+                {
+                    line[k * stride] = GetWarpedNoise((FNfloat)(xBase + (xLineFirst + k) * xLineStep), (FNfloat)(yBase + (yLineFirst + k) * yLineStep));
+                }
+            },
+            out, countX, countY, xStart, yStart, xStep, yStep, xStride, yStride, xFirst, yFirst);
+    }
+
+    /// <summary>
+    /// 64-bit FNV-1a hash of every setting that affects the noise output
+    /// </summary>
+    /// <remarks>
+    /// Equal settings always hash equal, on any platform, so the hash can key results cached on disk.
+    /// </remarks>
+    unsigned long long GetSettingsHash() const
+    {
+        unsigned long long hash = 14695981039346656037ull;
+        auto mix = [&hash](const void* data, size_t size)
+        {
+            const unsigned char* bytes = static_cast<const unsigned char*>(data);
+            for (size_t i = 0; i < size; i++)
+            {
+                hash = (hash ^ bytes[i]) * 1099511628211ull;
+            }
+        };
+
+        const int enums[] = { (int)mNoiseType, (int)mRotationType3D, (int)mTransformType3D, (int)mFractalType,
+            (int)mCellularDistanceFunction, (int)mCellularReturnType, (int)mDomainWarpType, (int)mWarpTransformType3D };
+        const float floats[] = { mFrequency, mLacunarity, mGain, mWeightedStrength, mPingPongStrength,
+            mCellularJitterModifier, mDomainWarpAmp, mOctaveLimit };
+
+        mix(&mSeed, sizeof(mSeed));
+        mix(&mOctaves, sizeof(mOctaves));
+        mix(enums, sizeof(enums));
+        mix(floats, sizeof(floats));
+        return hash;
+    }
+
+    /// <summary>
+    /// Fractal and 2D domain warp settings as the noise kernels use them
+    /// </summary>
+    /// <remarks>
+    /// For ports of the noise to shaders. Octaves and the faded octave already follow the
+    /// octave limit, bounding is the first octave's amplitude and warpAmp is the amplitude
+    /// DomainWarp passes to its 2D kernel, scaled for the domain warp type.
+    /// </remarks>
+    struct FractalParameters
+    {
+        int seed;
+        float frequency;
+        int octaves;
+        int fadedOctave;
+        float fadedOctaveWeight;
+        float lacunarity;
+        float gain;
+        float weightedStrength;
+        float bounding;
+        float warpAmp;
+    };
+
+    FractalParameters GetFractalParameters() const
+    {
+        FractalParameters parameters;
+        parameters.seed = mSeed;
+        parameters.frequency = mFrequency;
+        parameters.octaves = mActiveOctaves;
+        parameters.fadedOctave = mFadedOctave;
+        parameters.fadedOctaveWeight = mFadedOctaveWeight;
+        parameters.lacunarity = mLacunarity;
+        parameters.gain = mGain;
+        parameters.weightedStrength = mWeightedStrength;
+        parameters.bounding = mFractalBounding;
+
+        bool outGradOnly;
+        if (!SimplexWarpAmp(parameters.warpAmp, outGradOnly))
+            parameters.warpAmp = mDomainWarpAmp * mFractalBounding;
+        return parameters;
+    }
+
+    /// <summary>
+    /// Octaves an AxisAnchor covers
+    /// </summary>
+    static const int AnchorOctaves = 16;
+
+    /// <summary>
+    /// Where one axis of a far sample origin falls on the noise lattices
+    /// </summary>
+    /// <remarks>
+    /// A float position keeps fewer fraction bits the further it is from 0, and the octaves and the
+    /// domain warp magnify what is lost. GetAxisAnchor splits an origin coordinate in double into
+    /// the integer cell and float fraction it has on each octave's lattice and in the skewed
+    /// OpenSimplex2 warp coordinates. The anchored GetNoise overloads take an anchor per axis and
+    /// a position relative to them, and only add that small offset in float, so they are as precise
+    /// anywhere as near (0, 0). The axes are split separately, so shader ports can pass anchors per
+    /// row and per column.
+    /// Only Value noise with FBm, Ridged or no fractal and the OpenSimplex2 warps are split; other
+    /// settings are sampled at origin + offset in float. Octaves past AnchorOctaves are skipped.
+    /// </remarks>
+    struct AxisAnchor
+    {
+        double origin;
+        int cell[AnchorOctaves];
+        float fraction[AnchorOctaves];
+        // Skewed warp coordinates: [0] of this axis, [1] added to the other axis
+        int warpCell[2];
+        float warpFraction[2];
+    };
+
+    AxisAnchor GetAxisAnchor(double origin) const
+    {
+        AxisAnchor anchor;
+        anchor.origin = origin;
+
+        // TransformDomainWarpCoordinate adds (x + y) * F2 to both axes
+        const double F2 = 0.5 * (1.7320508075688772935274463415059 - 1);
+        SplitCoordinate(origin * (1 + F2) * mFrequency, anchor.warpCell[0], anchor.warpFraction[0]);
+        SplitCoordinate(origin * F2 * mFrequency, anchor.warpCell[1], anchor.warpFraction[1]);
+
+        double coordinate = origin * mFrequency;
+        for (int i = 0; i < AnchorOctaves; i++)
+        {
+            SplitCoordinate(coordinate, anchor.cell[i], anchor.fraction[i]);
+            coordinate *= mLacunarity;
+        }
+        return anchor;
+    }
+
+    /// <summary>
+    /// 2D noise at (x, y) from the anchors' origins, see AxisAnchor
+    /// </summary>
+    float GetNoise(const AxisAnchor& xAnchor, const AxisAnchor& yAnchor, float x, float y) const
+    {
+        if (!AnchoredSupported(false))
+            return GetNoise((float)(xAnchor.origin + x), (float)(yAnchor.origin + y));
+
+        return GenAnchoredValue(xAnchor, yAnchor, x, y);
+    }
+
+    /// <summary>
+    /// 2D noise at a domain warped position (x, y) from the anchors' origins, see AxisAnchor
+    /// </summary>
+    float GetWarpedNoise(const AxisAnchor& xAnchor, const AxisAnchor& yAnchor, float x, float y) const
+    {
+        if (!AnchoredSupported(true))
+            return GetWarpedNoise((float)(xAnchor.origin + x), (float)(yAnchor.origin + y));
+
+        AnchoredWarpSimplex(xAnchor, yAnchor, x, y);
+        return GenAnchoredValue(xAnchor, yAnchor, x, y);
+    }
+
+    /// <summary>
+    /// Noise sampler with the noise type, fractal type and 3D rotation compiled in
+    /// </summary>
+    /// <remarks>
+    /// Made by GetSampler. Every sample runs one fully inlined kernel instead of switching on the
+    /// types per octave. Results are bit-identical to GetNoise and GetNoiseGrid2D/3D unless the
+    /// compiler contracts multiply-adds differently in the two paths (e.g. GCC with -mfma).
+    /// The remaining settings are read from the FastNoiseLite that made it, which must outlive it;
+    /// after changing the noise type, fractal type or rotation type get a new sampler.
+    /// </remarks>
+    class Sampler
+    {
+    public:
+        float GetNoise(float x, float y) const { return mNoise2D(*mOwner, x, y); }
+
+        float GetNoise(float x, float y, float z) const { return mNoise3D(*mOwner, x, y, z); }
+
+        float GetWarpedNoise(float x, float y) const
+        {
+            mOwner->DomainWarp(x, y);
+            return mNoise2D(*mOwner, x, y);
+        }
+
+        void GetNoiseGrid2D(float* out, int countX, int countY,
+            float xStart, float yStart, float xStep, float yStep,
+            int xStride = 1, int yStride = 0, int xFirst = 0, int yFirst = 0) const
+        {
+            GridLines2D([this](float* line, int count, int stride, float xBase, float xLineStep, int xLineFirst, float yBase, float yLineStep, int yLineFirst)
+                {
+                    mLine2D(*mOwner, line, count, stride, xBase, xLineStep, xLineFirst, yBase, yLineStep, yLineFirst);
+                },
+                out, countX, countY, xStart, yStart, xStep, yStep, xStride, yStride, xFirst, yFirst);
+        }
+
+        void GetNoiseGrid3D(float* out, int countX, int countY, int countZ,
+            float xStart, float yStart, float zStart, float xStep, float yStep, float zStep,
+            int xStride = 1, int yStride = 0, int zStride = 0, int xFirst = 0, int yFirst = 0, int zFirst = 0) const
+        {
+            GridLines3D([this](float* line, int count, int stride, float xBase, float xLineStep, int xLineFirst,
+                    float yBase, float yLineStep, int yLineFirst, float zBase, float zLineStep, int zLineFirst)
+                {
+                    mLine3D(*mOwner, line, count, stride, xBase, xLineStep, xLineFirst, yBase, yLineStep, yLineFirst, zBase, zLineStep, zLineFirst);
+                },
+                out, countX, countY, countZ, xStart, yStart, zStart, xStep, yStep, zStep, xStride, yStride, zStride, xFirst, yFirst, zFirst);
+        }
+
+        void GetWarpedNoiseGrid2D(float* out, int countX, int countY,
+            float xStart, float yStart, float xStep, float yStep,
+            int xStride = 1, int yStride = 0, int xFirst = 0, int yFirst = 0) const
+        {
+            GridLines2D([this](float* line, int count, int stride, float xBase, float xLineStep, int xLineFirst, float yBase, float yLineStep, int yLineFirst)
+                {
+                    if (mOwner->GenWarpedGridLineSimd2D(line, count, stride, xBase, xLineStep, xLineFirst, yBase, yLineStep, yLineFirst))
+                        return;
+
+                    for (int k = 0; k < count; k++)
+                    {
+                        line[k * stride] = GetWarpedNoise((float)(xBase + (xLineFirst + k) * xLineStep), (float)(yBase + (yLineFirst + k) * yLineStep));
+                    }
+                },
+                out, countX, countY, xStart, yStart, xStep, yStep, xStride, yStride, xFirst, yFirst);
+        }
+
+        AxisAnchor GetAxisAnchor(double origin) const { return mOwner->GetAxisAnchor(origin); }
+
+        float GetNoise(const AxisAnchor& xAnchor, const AxisAnchor& yAnchor, float x, float y) const { return mOwner->GetNoise(xAnchor, yAnchor, x, y); }
+
+        float GetWarpedNoise(const AxisAnchor& xAnchor, const AxisAnchor& yAnchor, float x, float y) const { return mOwner->GetWarpedNoise(xAnchor, yAnchor, x, y); }
+
+        /// Sample (ix, iy) equals the anchored GetNoise at ((xFirst + ix) * xStep, (yFirst + iy) * yStep)
+        /// and is written where GetNoiseGrid2D writes it
+        void GetNoiseGrid2D(float* out, int countX, int countY, const AxisAnchor& xAnchor, const AxisAnchor& yAnchor,
+            float xStep, float yStep, int xStride = 1, int yStride = 0, int xFirst = 0, int yFirst = 0) const
+        {
+            GridLines2D([this, &xAnchor, &yAnchor](float* line, int count, int stride, float xBase, float xLineStep, int xLineFirst, float yBase, float yLineStep, int yLineFirst)
+                {
+                    mOwner->GenAnchoredGridLine2D(line, count, stride, xAnchor, xBase, xLineStep, xLineFirst, yAnchor, yBase, yLineStep, yLineFirst, false);
+                },
+                out, countX, countY, 0.0f, 0.0f, xStep, yStep, xStride, yStride, xFirst, yFirst);
+        }
+
+        /// The same with the domain warp, equal to the anchored GetWarpedNoise
+        void GetWarpedNoiseGrid2D(float* out, int countX, int countY, const AxisAnchor& xAnchor, const AxisAnchor& yAnchor,
+            float xStep, float yStep, int xStride = 1, int yStride = 0, int xFirst = 0, int yFirst = 0) const
+        {
+            GridLines2D([this, &xAnchor, &yAnchor](float* line, int count, int stride, float xBase, float xLineStep, int xLineFirst, float yBase, float yLineStep, int yLineFirst)
+                {
+                    mOwner->GenAnchoredGridLine2D(line, count, stride, xAnchor, xBase, xLineStep, xLineFirst, yAnchor, yBase, yLineStep, yLineFirst, true);
+                },
+                out, countX, countY, 0.0f, 0.0f, xStep, yStep, xStride, yStride, xFirst, yFirst);
+        }
+
+    private:
+        friend class FastNoiseLite;
+
+        typedef float (*Noise2D)(const FastNoiseLite&, float, float);
+        typedef float (*Noise3D)(const FastNoiseLite&, float, float, float);
+        typedef void (*Line2D)(const FastNoiseLite&, float*, int, int, float, float, int, float, float, int);
+        typedef void (*Line3D)(const FastNoiseLite&, float*, int, int, float, float, int, float, float, int, float, float, int);
+
+        const FastNoiseLite* mOwner = nullptr;
+        Noise2D mNoise2D = nullptr;
+        Noise3D mNoise3D = nullptr;
+        Line2D mLine2D = nullptr;
+        Line3D mLine3D = nullptr;
+    };
+
+    /// <summary>
+    /// Sampler specialized for the current noise type, fractal type and 3D rotation
+    /// </summary>
+    Sampler GetSampler() const
+    {
+        Sampler sampler;
+        sampler.mOwner = this;
+
+        switch (mNoiseType)
+        {
+        case NoiseType_OpenSimplex2:
+            SelectFractal<NoiseType_OpenSimplex2>(sampler);
+            break;
+        case NoiseType_OpenSimplex2S:
+            SelectFractal<NoiseType_OpenSimplex2S>(sampler);
+            break;
+        case NoiseType_Cellular:
+            SelectFractal<NoiseType_Cellular>(sampler);
+            break;
+        case NoiseType_Perlin:
+            SelectFractal<NoiseType_Perlin>(sampler);
+            break;
+        case NoiseType_ValueCubic:
+            SelectFractal<NoiseType_ValueCubic>(sampler);
+            break;
+        case NoiseType_Value:
+            SelectFractal<NoiseType_Value>(sampler);
+            break;
+        }
+
+        return sampler;
+    }
+
 private:
+    // Template argument for a type read from the settings at run time, as GetNoise does
+    static const int DynamicType = -1;
+
     template <typename T>
     struct Arguments_must_be_floating_point_values;
 
@@ -420,6 +822,12 @@ private:
 
     float mFractalBounding;
 
+    // From the octave limit: octaves that run, and the last one with its weight if it fades
+    float mOctaveLimit;
+    int mActiveOctaves;
+    int mFadedOctave;
+    float mFadedOctaveWeight;
+
     CellularDistanceFunction mCellularDistanceFunction;
     CellularReturnType mCellularReturnType;
     float mCellularJitterModifier;
@@ -483,6 +891,26 @@ private:
         mFractalBounding = 1 / ampFractal;
     }
 
+    void CalculateOctaveLimit()
+    {
+        mActiveOctaves = mOctaves;
+        mFadedOctave = -1;
+        mFadedOctaveWeight = 1;
+
+        if (mOctaveLimit <= 0 || mOctaveLimit >= mOctaves)
+            return;
+
+        float limit = mOctaveLimit < 1 ? 1 : mOctaveLimit;
+        mActiveOctaves = (int)std::ceil(limit);
+
+        float weight = limit - (mActiveOctaves - 1);
+        if (weight < 1)
+        {
+            mFadedOctave = mActiveOctaves - 1;
+            mFadedOctaveWeight = weight;
+        }
+    }
+
     // Hashing
     static const int PrimeX = 501125321;
     static const int PrimeY = 1136930381;
@@ -613,10 +1041,10 @@ private:
 
     // Generic noise gen
 
-    template <typename FNfloat>
+    template <int Noise = DynamicType, typename FNfloat>
     float GenNoiseSingle(int seed, FNfloat x, FNfloat y) const
     {
-        switch (mNoiseType)
+        switch (Noise == DynamicType ? (int)mNoiseType : Noise)
         {
         case NoiseType_OpenSimplex2:
             return SingleSimplex(seed, x, y);
@@ -635,10 +1063,10 @@ private:
         }
     }
 
-    template <typename FNfloat>
+    template <int Noise = DynamicType, typename FNfloat>
     float GenNoiseSingle(int seed, FNfloat x, FNfloat y, FNfloat z) const
     {
-        switch (mNoiseType)
+        switch (Noise == DynamicType ? (int)mNoiseType : Noise)
         {
         case NoiseType_OpenSimplex2:
             return SingleOpenSimplex2(seed, x, y, z);
@@ -660,13 +1088,13 @@ private:
 
     // Noise Coordinate Transforms (frequency, and possible skew or rotation)
 
-    template <typename FNfloat>
+    template <int Noise = DynamicType, typename FNfloat>
     void TransformNoiseCoordinate(FNfloat& x, FNfloat& y) const
     {
         x *= mFrequency;
         y *= mFrequency;
 
-        switch (mNoiseType)
+        switch (Noise == DynamicType ? (int)mNoiseType : Noise)
         {
         case NoiseType_OpenSimplex2:
         case NoiseType_OpenSimplex2S:
@@ -683,14 +1111,14 @@ private:
         }
     }
 
-    template <typename FNfloat>
+    template <int Transform = DynamicType, typename FNfloat>
     void TransformNoiseCoordinate(FNfloat& x, FNfloat& y, FNfloat& z) const
     {
         x *= mFrequency;
         y *= mFrequency;
         z *= mFrequency;
 
-        switch (mTransformType3D)
+        switch (Transform == DynamicType ? (int)mTransformType3D : Transform)
         {
         case TransformType3D_ImproveXYPlanes:
             {
@@ -839,18 +1267,60 @@ private:
     }
 
 
+    // Noise, fractal and transform types are either DynamicType or fixed by a Sampler
+
+    template <int Noise, int Fractal, typename FNfloat>
+    float GenNoise(FNfloat x, FNfloat y) const
+    {
+        TransformNoiseCoordinate<Noise>(x, y);
+
+        switch (Fractal == DynamicType ? (int)mFractalType : Fractal)
+        {
+        default:
+            return GenNoiseSingle<Noise>(mSeed, x, y);
+        case FractalType_FBm:
+            return GenFractalFBm<Noise>(x, y);
+        case FractalType_Ridged:
+            return GenFractalRidged<Noise>(x, y);
+        case FractalType_PingPong:
+            return GenFractalPingPong<Noise>(x, y);
+        }
+    }
+
+    template <int Noise, int Fractal, int Transform, typename FNfloat>
+    float GenNoise(FNfloat x, FNfloat y, FNfloat z) const
+    {
+        TransformNoiseCoordinate<Transform>(x, y, z);
+
+        switch (Fractal == DynamicType ? (int)mFractalType : Fractal)
+        {
+        default:
+            return GenNoiseSingle<Noise>(mSeed, x, y, z);
+        case FractalType_FBm:
+            return GenFractalFBm<Noise>(x, y, z);
+        case FractalType_Ridged:
+            return GenFractalRidged<Noise>(x, y, z);
+        case FractalType_PingPong:
+            return GenFractalPingPong<Noise>(x, y, z);
+        }
+    }
+
+
     // Fractal FBm
 
-    template <typename FNfloat>
+    template <int Noise = DynamicType, typename FNfloat>
     float GenFractalFBm(FNfloat x, FNfloat y) const
     {
         int seed = mSeed;
         float sum = 0;
         float amp = mFractalBounding;
 
-        for (int i = 0; i < mOctaves; i++)
+        for (int i = 0; i < mActiveOctaves; i++)
         {
-            float noise = GenNoiseSingle(seed++, x, y);
+            if (i == mFadedOctave)
+                amp *= mFadedOctaveWeight;
+
+            float noise = GenNoiseSingle<Noise>(seed++, x, y);
             sum += noise * amp;
             amp *= Lerp(1.0f, FastMin(noise + 1, 2) * 0.5f, mWeightedStrength);
 
@@ -862,16 +1332,19 @@ private:
         return sum;
     }
 
-    template <typename FNfloat>
+    template <int Noise = DynamicType, typename FNfloat>
     float GenFractalFBm(FNfloat x, FNfloat y, FNfloat z) const
     {
         int seed = mSeed;
         float sum = 0;
         float amp = mFractalBounding;
 
-        for (int i = 0; i < mOctaves; i++)
+        for (int i = 0; i < mActiveOctaves; i++)
         {
-            float noise = GenNoiseSingle(seed++, x, y, z);
+            if (i == mFadedOctave)
+                amp *= mFadedOctaveWeight;
+
+            float noise = GenNoiseSingle<Noise>(seed++, x, y, z);
             sum += noise * amp;
             amp *= Lerp(1.0f, (noise + 1) * 0.5f, mWeightedStrength);
 
@@ -887,16 +1360,19 @@ private:
 
     // Fractal Ridged
 
-    template <typename FNfloat>
+    template <int Noise = DynamicType, typename FNfloat>
     float GenFractalRidged(FNfloat x, FNfloat y) const
     {
         int seed = mSeed;
         float sum = 0;
         float amp = mFractalBounding;
 
-        for (int i = 0; i < mOctaves; i++)
+        for (int i = 0; i < mActiveOctaves; i++)
         {
-            float noise = FastAbs(GenNoiseSingle(seed++, x, y));
+            if (i == mFadedOctave)
+                amp *= mFadedOctaveWeight;
+
+            float noise = FastAbs(GenNoiseSingle<Noise>(seed++, x, y));
             sum += (noise * -2 + 1) * amp;
             amp *= Lerp(1.0f, 1 - noise, mWeightedStrength);
 
@@ -908,16 +1384,19 @@ private:
         return sum;
     }
 
-    template <typename FNfloat>
+    template <int Noise = DynamicType, typename FNfloat>
     float GenFractalRidged(FNfloat x, FNfloat y, FNfloat z) const
     {
         int seed = mSeed;
         float sum = 0;
         float amp = mFractalBounding;
 
-        for (int i = 0; i < mOctaves; i++)
+        for (int i = 0; i < mActiveOctaves; i++)
         {
-            float noise = FastAbs(GenNoiseSingle(seed++, x, y, z));
+            if (i == mFadedOctave)
+                amp *= mFadedOctaveWeight;
+
+            float noise = FastAbs(GenNoiseSingle<Noise>(seed++, x, y, z));
             sum += (noise * -2 + 1) * amp;
             amp *= Lerp(1.0f, 1 - noise, mWeightedStrength);
 
@@ -933,16 +1412,19 @@ private:
 
     // Fractal PingPong 
 
-    template <typename FNfloat>
+    template <int Noise = DynamicType, typename FNfloat>
     float GenFractalPingPong(FNfloat x, FNfloat y) const
     {
         int seed = mSeed;
         float sum = 0;
         float amp = mFractalBounding;
 
-        for (int i = 0; i < mOctaves; i++)
+        for (int i = 0; i < mActiveOctaves; i++)
         {
-            float noise = PingPong((GenNoiseSingle(seed++, x, y) + 1) * mPingPongStrength);
+            if (i == mFadedOctave)
+                amp *= mFadedOctaveWeight;
+
+            float noise = PingPong((GenNoiseSingle<Noise>(seed++, x, y) + 1) * mPingPongStrength);
             sum += (noise - 0.5f) * 2 * amp;
             amp *= Lerp(1.0f, noise, mWeightedStrength);
 
@@ -954,16 +1436,19 @@ private:
         return sum;
     }
 
-    template <typename FNfloat>
+    template <int Noise = DynamicType, typename FNfloat>
     float GenFractalPingPong(FNfloat x, FNfloat y, FNfloat z) const
     {
         int seed = mSeed;
         float sum = 0;
         float amp = mFractalBounding;
 
-        for (int i = 0; i < mOctaves; i++)
+        for (int i = 0; i < mActiveOctaves; i++)
         {
-            float noise = PingPong((GenNoiseSingle(seed++, x, y, z) + 1) * mPingPongStrength);
+            if (i == mFadedOctave)
+                amp *= mFadedOctaveWeight;
+
+            float noise = PingPong((GenNoiseSingle<Noise>(seed++, x, y, z) + 1) * mPingPongStrength);
             sum += (noise - 0.5f) * 2 * amp;
             amp *= Lerp(1.0f, noise, mWeightedStrength);
 
@@ -2228,9 +2713,6 @@ private:
     template <typename FNfloat>
     void SingleDomainWarpSimplexGradient(int seed, float warpAmp, float frequency, FNfloat x, FNfloat y, FNfloat& xr, FNfloat& yr, bool outGradOnly) const
     {
-        const float SQRT3 = 1.7320508075688772935274463415059f;
-        const float G2 = (3 - SQRT3) / 6;
-
         x *= frequency;
         y *= frequency;
 
@@ -2246,14 +2728,26 @@ private:
         float xi = (float)(x - i);
         float yi = (float)(y - j);
 
-        float t = (xi + yi) * G2;
-        float x0 = (float)(xi - t);
-        float y0 = (float)(yi - t);
+        float vx, vy;
+        SimplexWarpVector(seed, i, j, xi, yi, outGradOnly, vx, vy);
 
-        i *= PrimeX;
+        xr += vx * warpAmp;
+        yr += vy * warpAmp;
+    }
+
+    // Warp vector of the skewed cell (i, j) at (xi, yi) inside it
+    void SimplexWarpVector(int seed, int i, int j, float xi, float yi, bool outGradOnly, float& vx, float& vy) const
+    {
+        const float SQRT3 = 1.7320508075688772935274463415059f;
+        const float G2 = (3 - SQRT3) / 6;
+
+        float t = (xi + yi) * G2;
+        float x0 = (float)(xi - t);
+        float y0 = (float)(yi - t);
+
+        i *= PrimeX;
         j *= PrimeY;
 
-        float vx, vy;
         vx = vy = 0;
 
         float a = 0.5f - x0 * x0 - y0 * y0;
@@ -2318,9 +2812,6 @@ private:
                 vy += bbbb * yo;
             }
         }
-
-        xr += vx * warpAmp;
-        yr += vy * warpAmp;
     }
 
     template <typename FNfloat>
@@ -2442,6 +2933,968 @@ private:
         yr += vy * warpAmp;
         zr += vz * warpAmp;
     }
+
+    // Anchored 2D noise, see AxisAnchor
+
+    static void SplitCoordinate(double coordinate, int& cell, float& fraction)
+    {
+        long long whole = (long long)coordinate;
+        if (coordinate < whole)
+            whole--;
+
+        // Cells wrap like the primed int arithmetic they feed
+        cell = (int)(unsigned int)(unsigned long long)whole;
+        fraction = (float)(coordinate - whole);
+    }
+
+    // DoSingleDomainWarp's amplitude for the OpenSimplex2 warps; false for the other warp types
+    bool SimplexWarpAmp(float& warpAmp, bool& outGradOnly) const
+    {
+        const float amp = mDomainWarpAmp * mFractalBounding;
+        switch (mDomainWarpType)
+        {
+        case DomainWarpType_OpenSimplex2:
+            warpAmp = amp * 38.283687591552734375f;
+            outGradOnly = false;
+            return true;
+        case DomainWarpType_OpenSimplex2Reduced:
+            warpAmp = amp * 16.0f;
+            outGradOnly = true;
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    bool AnchoredSupported(bool warp) const
+    {
+        if (mNoiseType != NoiseType_Value)
+            return false;
+        if (mFractalType != FractalType_None && mFractalType != FractalType_FBm && mFractalType != FractalType_Ridged)
+            return false;
+
+        float warpAmp;
+        bool outGradOnly;
+        return !warp || SimplexWarpAmp(warpAmp, outGradOnly);
+    }
+
+    // SingleValue at cell + x and cell + y, with x and y small
+    static float SingleValueAnchored(int seed, int xCell, float x, int yCell, float y)
+    {
+        int x0 = FastFloor(x);
+        int y0 = FastFloor(y);
+
+        float xs = InterpHermite(x - x0);
+        float ys = InterpHermite(y - y0);
+
+        x0 = (x0 + xCell) * PrimeX;
+        y0 = (y0 + yCell) * PrimeY;
+        int x1 = x0 + PrimeX;
+        int y1 = y0 + PrimeY;
+
+        float xf0 = Lerp(ValCoord(seed, x0, y0), ValCoord(seed, x1, y0), xs);
+        float xf1 = Lerp(ValCoord(seed, x0, y1), ValCoord(seed, x1, y1), xs);
+
+        return Lerp(xf0, xf1, ys);
+    }
+
+    // GenNoise for Value noise, the octave lattices offset by the anchors
+    float GenAnchoredValue(const AxisAnchor& xAnchor, const AxisAnchor& yAnchor, float x, float y) const
+    {
+        // TransformNoiseCoordinate for Value noise is only the frequency
+        x *= mFrequency;
+        y *= mFrequency;
+
+        if (mFractalType == FractalType_None)
+            return SingleValueAnchored(mSeed, xAnchor.cell[0], xAnchor.fraction[0] + x, yAnchor.cell[0], yAnchor.fraction[0] + y);
+
+        int seed = mSeed;
+        float sum = 0;
+        float amp = mFractalBounding;
+        const int octaves = mActiveOctaves < AnchorOctaves ? mActiveOctaves : AnchorOctaves;
+
+        for (int i = 0; i < octaves; i++)
+        {
+            if (i == mFadedOctave)
+                amp *= mFadedOctaveWeight;
+
+            float noise = SingleValueAnchored(seed++, xAnchor.cell[i], xAnchor.fraction[i] + x, yAnchor.cell[i], yAnchor.fraction[i] + y);
+            if (mFractalType == FractalType_FBm)
+            {
+                sum += noise * amp;
+                amp *= Lerp(1.0f, FastMin(noise + 1, 2) * 0.5f, mWeightedStrength);
+            }
+            else
+            {
+                noise = FastAbs(noise);
+                sum += (noise * -2 + 1) * amp;
+                amp *= Lerp(1.0f, 1 - noise, mWeightedStrength);
+            }
+
+            x *= mLacunarity;
+            y *= mLacunarity;
+            amp *= mGain;
+        }
+
+        return sum;
+    }
+
+    // DomainWarpSingle with an OpenSimplex2 warp, the skewed lattice offset by the anchors
+    void AnchoredWarpSimplex(const AxisAnchor& xAnchor, const AxisAnchor& yAnchor, float& x, float& y) const
+    {
+        float warpAmp;
+        bool outGradOnly;
+        SimplexWarpAmp(warpAmp, outGradOnly);
+
+        const float F2 = 0.5f * ((float)1.7320508075688772935274463415059 - 1);
+        float skew = (x + y) * F2;
+        float xs = (xAnchor.warpFraction[0] + yAnchor.warpFraction[1]) + (x + skew) * mFrequency;
+        float ys = (yAnchor.warpFraction[0] + xAnchor.warpFraction[1]) + (y + skew) * mFrequency;
+
+        int i = FastFloor(xs);
+        int j = FastFloor(ys);
+        float xi = xs - i;
+        float yi = ys - j;
+
+        float vx, vy;
+        SimplexWarpVector(mSeed, i + xAnchor.warpCell[0] + yAnchor.warpCell[1], j + yAnchor.warpCell[0] + xAnchor.warpCell[1], xi, yi, outGradOnly, vx, vy);
+
+        x += vx * warpAmp;
+        y += vy * warpAmp;
+    }
+
+    void GenAnchoredGridLine2D(float* out, int count, int stride, const AxisAnchor& xAnchor, float xBase, float xLineStep, int xFirst,
+        const AxisAnchor& yAnchor, float yBase, float yLineStep, int yFirst, bool warp) const
+    {
+        if (GenAnchoredGridLineSimd2D(out, count, stride, xAnchor, xBase, xLineStep, xFirst, yAnchor, yBase, yLineStep, yFirst, warp))
+            return;
+
+        for (int k = 0; k < count; k++)
+        {
+            float x = (float)(xBase + (xFirst + k) * xLineStep);
+            float y = (float)(yBase + (yFirst + k) * yLineStep);
+            out[k * stride] = warp ? GetWarpedNoise(xAnchor, yAnchor, x, y) : GetNoise(xAnchor, yAnchor, x, y);
+        }
+    }
+
+
+    // Grid lines
+    // Sample k of a line sits at (base + (first + k) * lineStep) on every axis; the fixed axes have a lineStep of 0.
+
+    template <typename FNfloat>
+    void GenGridLine2D(float* out, int count, int stride, FNfloat xBase, FNfloat xLineStep, int xFirst, FNfloat yBase, FNfloat yLineStep, int yFirst) const
+    {
+        if (GenGridLineSimd2D(out, count, stride, xBase, xLineStep, xFirst, yBase, yLineStep, yFirst))
+            return;
+
+        for (int k = 0; k < count; k++)
+        {
+            out[k * stride] = GetNoise((FNfloat)(xBase + (xFirst + k) * xLineStep), (FNfloat)(yBase + (yFirst + k) * yLineStep));
+        }
+    }
+
+    template <typename FNfloat>
+    void GenGridLine3D(float* out, int count, int stride, FNfloat xBase, FNfloat xLineStep, int xFirst, FNfloat yBase, FNfloat yLineStep, int yFirst, FNfloat zBase, FNfloat zLineStep, int zFirst) const
+    {
+        if (GenGridLineSimd3D(out, count, stride, xBase, xLineStep, xFirst, yBase, yLineStep, yFirst, zBase, zLineStep, zFirst))
+            return;
+
+        for (int k = 0; k < count; k++)
+        {
+            out[k * stride] = GetNoise((FNfloat)(xBase + (xFirst + k) * xLineStep), (FNfloat)(yBase + (yFirst + k) * yLineStep), (FNfloat)(zBase + (zFirst + k) * zLineStep));
+        }
+    }
+
+    // Splits a grid into lines along whichever axis is contiguous in memory, see GetNoiseGrid2D
+    template <typename Line, typename FNfloat>
+    static void GridLines2D(Line line, float* out, int countX, int countY,
+        FNfloat xStart, FNfloat yStart, FNfloat xStep, FNfloat yStep, int xStride, int yStride, int xFirst, int yFirst)
+    {
+        if (yStride == 0)
+            yStride = countX * xStride;
+
+        if (xStride != 1 && yStride == 1)
+        {
+            for (int ix = 0; ix < countX; ix++)
+            {
+                line(out + ix * xStride, countY, yStride,
+                    (FNfloat)(xStart + (xFirst + ix) * xStep), (FNfloat)0, 0,
+                    yStart, yStep, yFirst);
+            }
+        }
+        else
+        {
+            for (int iy = 0; iy < countY; iy++)
+            {
+                line(out + iy * yStride, countX, xStride,
+                    xStart, xStep, xFirst,
+                    (FNfloat)(yStart + (yFirst + iy) * yStep), (FNfloat)0, 0);
+            }
+        }
+    }
+
+    template <typename Line, typename FNfloat>
+    static void GridLines3D(Line line, float* out, int countX, int countY, int countZ,
+        FNfloat xStart, FNfloat yStart, FNfloat zStart, FNfloat xStep, FNfloat yStep, FNfloat zStep,
+        int xStride, int yStride, int zStride, int xFirst, int yFirst, int zFirst)
+    {
+        if (yStride == 0)
+            yStride = countX * xStride;
+        if (zStride == 0)
+            zStride = countY * yStride;
+
+        if (xStride != 1 && yStride == 1)
+        {
+            for (int iz = 0; iz < countZ; iz++)
+                for (int ix = 0; ix < countX; ix++)
+                    line(out + ix * xStride + iz * zStride, countY, yStride,
+                        (FNfloat)(xStart + (xFirst + ix) * xStep), (FNfloat)0, 0,
+                        yStart, yStep, yFirst,
+                        (FNfloat)(zStart + (zFirst + iz) * zStep), (FNfloat)0, 0);
+        }
+        else if (xStride != 1 && zStride == 1)
+        {
+            for (int iy = 0; iy < countY; iy++)
+                for (int ix = 0; ix < countX; ix++)
+                    line(out + ix * xStride + iy * yStride, countZ, zStride,
+                        (FNfloat)(xStart + (xFirst + ix) * xStep), (FNfloat)0, 0,
+                        (FNfloat)(yStart + (yFirst + iy) * yStep), (FNfloat)0, 0,
+                        zStart, zStep, zFirst);
+        }
+        else
+        {
+            for (int iz = 0; iz < countZ; iz++)
+                for (int iy = 0; iy < countY; iy++)
+                    line(out + iy * yStride + iz * zStride, countX, xStride,
+                        xStart, xStep, xFirst,
+                        (FNfloat)(yStart + (yFirst + iy) * yStep), (FNfloat)0, 0,
+                        (FNfloat)(zStart + (zFirst + iz) * zStep), (FNfloat)0, 0);
+        }
+    }
+
+    // Sampler kernels
+
+    template <int Noise, int Fractal>
+    static float SpecializedNoise2D(const FastNoiseLite& noise, float x, float y)
+    {
+        return noise.GenNoise<Noise, Fractal>(x, y);
+    }
+
+    template <int Noise, int Fractal, int Transform>
+    static float SpecializedNoise3D(const FastNoiseLite& noise, float x, float y, float z)
+    {
+        return noise.GenNoise<Noise, Fractal, Transform>(x, y, z);
+    }
+
+    template <int Noise, int Fractal>
+    static void SpecializedLine2D(const FastNoiseLite& noise, float* out, int count, int stride, float xBase, float xLineStep, int xFirst, float yBase, float yLineStep, int yFirst)
+    {
+#if defined(FASTNOISELITE_SIMD_AVX2) || defined(FASTNOISELITE_SIMD_SSE41)
+        if (Noise == NoiseType_Value && Fractal != FractalType_PingPong)
+        {
+            noise.SimdValueLine2D<(FractalType)Fractal>(out, count, stride, xBase, xLineStep, xFirst, yBase, yLineStep, yFirst);
+            return;
+        }
+#endif
+        for (int k = 0; k < count; k++)
+        {
+            out[k * stride] = noise.GenNoise<Noise, Fractal>((float)(xBase + (xFirst + k) * xLineStep), (float)(yBase + (yFirst + k) * yLineStep));
+        }
+    }
+
+    template <int Noise, int Fractal, int Transform>
+    static void SpecializedLine3D(const FastNoiseLite& noise, float* out, int count, int stride, float xBase, float xLineStep, int xFirst, float yBase, float yLineStep, int yFirst, float zBase, float zLineStep, int zFirst)
+    {
+#if defined(FASTNOISELITE_SIMD_AVX2) || defined(FASTNOISELITE_SIMD_SSE41)
+        if (Noise == NoiseType_Value && Fractal != FractalType_PingPong && Transform == TransformType3D_None)
+        {
+            noise.SimdValueLine3D<(FractalType)Fractal>(out, count, stride, xBase, xLineStep, xFirst, yBase, yLineStep, yFirst, zBase, zLineStep, zFirst);
+            return;
+        }
+#endif
+        for (int k = 0; k < count; k++)
+        {
+            out[k * stride] = noise.GenNoise<Noise, Fractal, Transform>((float)(xBase + (xFirst + k) * xLineStep), (float)(yBase + (yFirst + k) * yLineStep), (float)(zBase + (zFirst + k) * zLineStep));
+        }
+    }
+
+    // GetSampler picks the noise type, then these pick the fractal type and the 3D transform.
+    // The domain warp fractal types leave GetNoise unfractalled, as in GenNoise.
+
+    template <int Noise>
+    void SelectFractal(Sampler& sampler) const
+    {
+        switch (mFractalType)
+        {
+        case FractalType_FBm:
+            SelectTransform<Noise, FractalType_FBm>(sampler);
+            break;
+        case FractalType_Ridged:
+            SelectTransform<Noise, FractalType_Ridged>(sampler);
+            break;
+        case FractalType_PingPong:
+            SelectTransform<Noise, FractalType_PingPong>(sampler);
+            break;
+        default:
+            SelectTransform<Noise, FractalType_None>(sampler);
+            break;
+        }
+    }
+
+    template <int Noise, int Fractal>
+    void SelectTransform(Sampler& sampler) const
+    {
+        // What UpdateTransformType3D picks for this noise type without a rotation type
+        const int defaultTransform = Noise == NoiseType_OpenSimplex2 || Noise == NoiseType_OpenSimplex2S
+            ? TransformType3D_DefaultOpenSimplex2 : TransformType3D_None;
+
+        sampler.mNoise2D = &SpecializedNoise2D<Noise, Fractal>;
+        sampler.mLine2D = &SpecializedLine2D<Noise, Fractal>;
+
+        switch (mTransformType3D)
+        {
+        case TransformType3D_ImproveXYPlanes:
+            sampler.mNoise3D = &SpecializedNoise3D<Noise, Fractal, TransformType3D_ImproveXYPlanes>;
+            sampler.mLine3D = &SpecializedLine3D<Noise, Fractal, TransformType3D_ImproveXYPlanes>;
+            break;
+        case TransformType3D_ImproveXZPlanes:
+            sampler.mNoise3D = &SpecializedNoise3D<Noise, Fractal, TransformType3D_ImproveXZPlanes>;
+            sampler.mLine3D = &SpecializedLine3D<Noise, Fractal, TransformType3D_ImproveXZPlanes>;
+            break;
+        default:
+            sampler.mNoise3D = &SpecializedNoise3D<Noise, Fractal, defaultTransform>;
+            sampler.mLine3D = &SpecializedLine3D<Noise, Fractal, defaultTransform>;
+            break;
+        }
+    }
+
+    // Only float coordinates have a vector kernel
+    template <typename FNfloat>
+    bool GenGridLineSimd2D(float*, int, int, FNfloat, FNfloat, int, FNfloat, FNfloat, int) const { return false; }
+
+    template <typename FNfloat>
+    bool GenGridLineSimd3D(float*, int, int, FNfloat, FNfloat, int, FNfloat, FNfloat, int, FNfloat, FNfloat, int) const { return false; }
+
+    template <typename FNfloat>
+    bool GenWarpedGridLineSimd2D(float*, int, int, FNfloat, FNfloat, int, FNfloat, FNfloat, int) const { return false; }
+
+#if !defined(FASTNOISELITE_SIMD_AVX2) && !defined(FASTNOISELITE_SIMD_SSE41)
+    bool GenAnchoredGridLineSimd2D(float*, int, int, const AxisAnchor&, float, float, int, const AxisAnchor&, float, float, int, bool) const { return false; }
+#endif
+
+#if defined(FASTNOISELITE_SIMD_AVX2) || defined(FASTNOISELITE_SIMD_SSE41)
+
+    // Vector Value noise
+    // Every operation mirrors the scalar code in order and without FMA, so results match GetNoise bit for bit.
+
+#if defined(FASTNOISELITE_SIMD_AVX2)
+    struct Simd
+    {
+        typedef __m256 Float;
+        typedef __m256i Int;
+        static const int Width = 8;
+
+        static Float Set(float f) { return _mm256_set1_ps(f); }
+        static Int SetInt(int i) { return _mm256_set1_epi32(i); }
+        static Int LaneIndex() { return _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7); }
+
+        static Float Add(Float a, Float b) { return _mm256_add_ps(a, b); }
+        static Float Sub(Float a, Float b) { return _mm256_sub_ps(a, b); }
+        static Float Mul(Float a, Float b) { return _mm256_mul_ps(a, b); }
+        static Float Min(Float a, Float b) { return _mm256_min_ps(a, b); }
+        static Float Abs(Float a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a); }
+
+        // Masks are all ones in the lanes where the comparison holds
+        static Float GreaterThan(Float a, Float b) { return _mm256_cmp_ps(a, b, _CMP_GT_OQ); }
+        static Float And(Float mask, Float a) { return _mm256_and_ps(mask, a); }
+        static Float Select(Float mask, Float a, Float b) { return _mm256_blendv_ps(b, a, mask); }
+        static Int SelectInt(Float mask, Int a, Int b) { return _mm256_castps_si256(_mm256_blendv_ps(_mm256_castsi256_ps(b), _mm256_castsi256_ps(a), mask)); }
+
+        static Int AddInt(Int a, Int b) { return _mm256_add_epi32(a, b); }
+        static Int MulInt(Int a, Int b) { return _mm256_mullo_epi32(a, b); }
+        static Int Xor(Int a, Int b) { return _mm256_xor_si256(a, b); }
+        static Int ShiftLeft19(Int a) { return _mm256_slli_epi32(a, 19); }
+        static Int ShiftRight7(Int a) { return _mm256_srai_epi32(a, 7); }
+        static Int AndInt(Int a, Int b) { return _mm256_and_si256(a, b); }
+        static Int OrInt(Int a, Int b) { return _mm256_or_si256(a, b); }
+
+        static Float Gather(const float* table, Int index) { return _mm256_i32gather_ps(table, index, 4); }
+
+        static Float ToFloat(Int a) { return _mm256_cvtepi32_ps(a); }
+
+        // Same as FastFloor: truncate, then subtract one unless f >= 0
+        static Int FastFloor(Float f)
+        {
+            Int truncated = _mm256_cvttps_epi32(f);
+            Int notPositive = _mm256_castps_si256(_mm256_cmp_ps(f, _mm256_setzero_ps(), _CMP_NGE_UQ));
+            return _mm256_add_epi32(truncated, notPositive);
+        }
+
+        static void Store(float* p, Float a) { _mm256_storeu_ps(p, a); }
+    };
+#else
+    struct Simd
+    {
+        typedef __m128 Float;
+        typedef __m128i Int;
+        static const int Width = 4;
+
+        static Float Set(float f) { return _mm_set1_ps(f); }
+        static Int SetInt(int i) { return _mm_set1_epi32(i); }
+        static Int LaneIndex() { return _mm_setr_epi32(0, 1, 2, 3); }
+
+        static Float Add(Float a, Float b) { return _mm_add_ps(a, b); }
+        static Float Sub(Float a, Float b) { return _mm_sub_ps(a, b); }
+        static Float Mul(Float a, Float b) { return _mm_mul_ps(a, b); }
+        static Float Min(Float a, Float b) { return _mm_min_ps(a, b); }
+        static Float Abs(Float a) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), a); }
+
+        // Masks are all ones in the lanes where the comparison holds
+        static Float GreaterThan(Float a, Float b) { return _mm_cmpgt_ps(a, b); }
+        static Float And(Float mask, Float a) { return _mm_and_ps(mask, a); }
+        static Float Select(Float mask, Float a, Float b) { return _mm_blendv_ps(b, a, mask); }
+        static Int SelectInt(Float mask, Int a, Int b) { return _mm_castps_si128(_mm_blendv_ps(_mm_castsi128_ps(b), _mm_castsi128_ps(a), mask)); }
+
+        static Int AddInt(Int a, Int b) { return _mm_add_epi32(a, b); }
+        static Int MulInt(Int a, Int b) { return _mm_mullo_epi32(a, b); }
+        static Int Xor(Int a, Int b) { return _mm_xor_si128(a, b); }
+        static Int ShiftLeft19(Int a) { return _mm_slli_epi32(a, 19); }
+        static Int ShiftRight7(Int a) { return _mm_srai_epi32(a, 7); }
+        static Int AndInt(Int a, Int b) { return _mm_and_si128(a, b); }
+        static Int OrInt(Int a, Int b) { return _mm_or_si128(a, b); }
+
+        // SSE4.1 has no gather, so the lanes are loaded one by one
+        static Float Gather(const float* table, Int index)
+        {
+            int lanes[4];
+            _mm_storeu_si128((__m128i*)lanes, index);
+            return _mm_setr_ps(table[lanes[0]], table[lanes[1]], table[lanes[2]], table[lanes[3]]);
+        }
+
+        static Float ToFloat(Int a) { return _mm_cvtepi32_ps(a); }
+
+        // Same as FastFloor: truncate, then subtract one unless f >= 0
+        static Int FastFloor(Float f)
+        {
+            Int truncated = _mm_cvttps_epi32(f);
+            Int notPositive = _mm_castps_si128(_mm_cmpnge_ps(f, _mm_setzero_ps()));
+            return _mm_add_epi32(truncated, notPositive);
+        }
+
+        static void Store(float* p, Float a) { _mm_storeu_ps(p, a); }
+    };
+#endif
+
+    typedef Simd::Float SimdFloat;
+    typedef Simd::Int SimdInt;
+
+    static SimdFloat SimdLerp(SimdFloat a, SimdFloat b, SimdFloat t) { return Simd::Add(a, Simd::Mul(t, Simd::Sub(b, a))); }
+
+    static SimdFloat SimdInterpHermite(SimdFloat t)
+    {
+        return Simd::Mul(Simd::Mul(t, t), Simd::Sub(Simd::Set(3), Simd::Mul(Simd::Set(2), t)));
+    }
+
+    static SimdFloat SimdValCoord(SimdInt seed, SimdInt xPrimed, SimdInt yPrimed)
+    {
+        SimdInt hash = Simd::MulInt(Simd::Xor(Simd::Xor(seed, xPrimed), yPrimed), Simd::SetInt(0x27d4eb2d));
+
+        hash = Simd::MulInt(hash, hash);
+        hash = Simd::Xor(hash, Simd::ShiftLeft19(hash));
+        return Simd::Mul(Simd::ToFloat(hash), Simd::Set(1 / 2147483648.0f));
+    }
+
+    static SimdFloat SimdValCoord(SimdInt seed, SimdInt xPrimed, SimdInt yPrimed, SimdInt zPrimed)
+    {
+        SimdInt hash = Simd::MulInt(Simd::Xor(Simd::Xor(Simd::Xor(seed, xPrimed), yPrimed), zPrimed), Simd::SetInt(0x27d4eb2d));
+
+        hash = Simd::MulInt(hash, hash);
+        hash = Simd::Xor(hash, Simd::ShiftLeft19(hash));
+        return Simd::Mul(Simd::ToFloat(hash), Simd::Set(1 / 2147483648.0f));
+    }
+
+    static SimdFloat SimdSingleValue(int seed, SimdFloat x, SimdFloat y)
+    {
+        SimdInt x0 = Simd::FastFloor(x);
+        SimdInt y0 = Simd::FastFloor(y);
+
+        SimdFloat xs = SimdInterpHermite(Simd::Sub(x, Simd::ToFloat(x0)));
+        SimdFloat ys = SimdInterpHermite(Simd::Sub(y, Simd::ToFloat(y0)));
+
+        return SimdValueCell(seed, Simd::MulInt(x0, Simd::SetInt(PrimeX)), Simd::MulInt(y0, Simd::SetInt(PrimeY)), xs, ys);
+    }
+
+    // SingleValueAnchored
+    static SimdFloat SimdSingleValue(int seed, int xCell, SimdFloat x, int yCell, SimdFloat y)
+    {
+        SimdInt x0 = Simd::FastFloor(x);
+        SimdInt y0 = Simd::FastFloor(y);
+
+        SimdFloat xs = SimdInterpHermite(Simd::Sub(x, Simd::ToFloat(x0)));
+        SimdFloat ys = SimdInterpHermite(Simd::Sub(y, Simd::ToFloat(y0)));
+
+        x0 = Simd::MulInt(Simd::AddInt(x0, Simd::SetInt(xCell)), Simd::SetInt(PrimeX));
+        y0 = Simd::MulInt(Simd::AddInt(y0, Simd::SetInt(yCell)), Simd::SetInt(PrimeY));
+        return SimdValueCell(seed, x0, y0, xs, ys);
+    }
+
+    // Value noise of the cell with primed corner (x0, y0), interpolated by xs and ys
+    static SimdFloat SimdValueCell(int seed, SimdInt x0, SimdInt y0, SimdFloat xs, SimdFloat ys)
+    {
+        SimdInt x1 = Simd::AddInt(x0, Simd::SetInt(PrimeX));
+        SimdInt y1 = Simd::AddInt(y0, Simd::SetInt(PrimeY));
+
+        SimdInt seedV = Simd::SetInt(seed);
+        SimdFloat xf0 = SimdLerp(SimdValCoord(seedV, x0, y0), SimdValCoord(seedV, x1, y0), xs);
+        SimdFloat xf1 = SimdLerp(SimdValCoord(seedV, x0, y1), SimdValCoord(seedV, x1, y1), xs);
+
+        return SimdLerp(xf0, xf1, ys);
+    }
+
+    static SimdFloat SimdSingleValue(int seed, SimdFloat x, SimdFloat y, SimdFloat z)
+    {
+        SimdInt x0 = Simd::FastFloor(x);
+        SimdInt y0 = Simd::FastFloor(y);
+        SimdInt z0 = Simd::FastFloor(z);
+
+        SimdFloat xs = SimdInterpHermite(Simd::Sub(x, Simd::ToFloat(x0)));
+        SimdFloat ys = SimdInterpHermite(Simd::Sub(y, Simd::ToFloat(y0)));
+        SimdFloat zs = SimdInterpHermite(Simd::Sub(z, Simd::ToFloat(z0)));
+
+        x0 = Simd::MulInt(x0, Simd::SetInt(PrimeX));
+        y0 = Simd::MulInt(y0, Simd::SetInt(PrimeY));
+        z0 = Simd::MulInt(z0, Simd::SetInt(PrimeZ));
+        SimdInt x1 = Simd::AddInt(x0, Simd::SetInt(PrimeX));
+        SimdInt y1 = Simd::AddInt(y0, Simd::SetInt(PrimeY));
+        SimdInt z1 = Simd::AddInt(z0, Simd::SetInt(PrimeZ));
+
+        SimdInt seedV = Simd::SetInt(seed);
+        SimdFloat xf00 = SimdLerp(SimdValCoord(seedV, x0, y0, z0), SimdValCoord(seedV, x1, y0, z0), xs);
+        SimdFloat xf10 = SimdLerp(SimdValCoord(seedV, x0, y1, z0), SimdValCoord(seedV, x1, y1, z0), xs);
+        SimdFloat xf01 = SimdLerp(SimdValCoord(seedV, x0, y0, z1), SimdValCoord(seedV, x1, y0, z1), xs);
+        SimdFloat xf11 = SimdLerp(SimdValCoord(seedV, x0, y1, z1), SimdValCoord(seedV, x1, y1, z1), xs);
+
+        SimdFloat yf0 = SimdLerp(xf00, xf10, ys);
+        SimdFloat yf1 = SimdLerp(xf01, xf11, ys);
+
+        return SimdLerp(yf0, yf1, zs);
+    }
+
+    // Fractal type is a template parameter so each grid line picks its loop once
+
+    template <FractalType Fractal>
+    SimdFloat SimdGenValueFractal(SimdFloat x, SimdFloat y) const
+    {
+        if (Fractal == FractalType_None)
+            return SimdSingleValue(mSeed, x, y);
+
+        int seed = mSeed;
+        SimdFloat sum = Simd::Set(0);
+        SimdFloat amp = Simd::Set(mFractalBounding);
+
+        for (int i = 0; i < mActiveOctaves; i++)
+        {
+            if (i == mFadedOctave)
+                amp = Simd::Mul(amp, Simd::Set(mFadedOctaveWeight));
+
+            SimdFloat noise = SimdSingleValue(seed++, x, y);
+            if (Fractal == FractalType_FBm)
+            {
+                sum = Simd::Add(sum, Simd::Mul(noise, amp));
+                amp = Simd::Mul(amp, SimdLerp(Simd::Set(1.0f), Simd::Mul(Simd::Min(Simd::Add(noise, Simd::Set(1)), Simd::Set(2)), Simd::Set(0.5f)), Simd::Set(mWeightedStrength)));
+            }
+            else
+            {
+                noise = Simd::Abs(noise);
+                sum = Simd::Add(sum, Simd::Mul(Simd::Add(Simd::Mul(noise, Simd::Set(-2)), Simd::Set(1)), amp));
+                amp = Simd::Mul(amp, SimdLerp(Simd::Set(1.0f), Simd::Sub(Simd::Set(1), noise), Simd::Set(mWeightedStrength)));
+            }
+
+            x = Simd::Mul(x, Simd::Set(mLacunarity));
+            y = Simd::Mul(y, Simd::Set(mLacunarity));
+            amp = Simd::Mul(amp, Simd::Set(mGain));
+        }
+
+        return sum;
+    }
+
+    // GenAnchoredValue after the frequency
+    template <FractalType Fractal>
+    SimdFloat SimdGenValueFractal(const AxisAnchor& xAnchor, const AxisAnchor& yAnchor, SimdFloat x, SimdFloat y) const
+    {
+        if (Fractal == FractalType_None)
+            return SimdSingleValue(mSeed, xAnchor.cell[0], Simd::Add(Simd::Set(xAnchor.fraction[0]), x), yAnchor.cell[0], Simd::Add(Simd::Set(yAnchor.fraction[0]), y));
+
+        int seed = mSeed;
+        SimdFloat sum = Simd::Set(0);
+        SimdFloat amp = Simd::Set(mFractalBounding);
+        const int octaves = mActiveOctaves < AnchorOctaves ? mActiveOctaves : AnchorOctaves;
+
+        for (int i = 0; i < octaves; i++)
+        {
+            if (i == mFadedOctave)
+                amp = Simd::Mul(amp, Simd::Set(mFadedOctaveWeight));
+
+            SimdFloat noise = SimdSingleValue(seed++, xAnchor.cell[i], Simd::Add(Simd::Set(xAnchor.fraction[i]), x), yAnchor.cell[i], Simd::Add(Simd::Set(yAnchor.fraction[i]), y));
+            if (Fractal == FractalType_FBm)
+            {
+                sum = Simd::Add(sum, Simd::Mul(noise, amp));
+                amp = Simd::Mul(amp, SimdLerp(Simd::Set(1.0f), Simd::Mul(Simd::Min(Simd::Add(noise, Simd::Set(1)), Simd::Set(2)), Simd::Set(0.5f)), Simd::Set(mWeightedStrength)));
+            }
+            else
+            {
+                noise = Simd::Abs(noise);
+                sum = Simd::Add(sum, Simd::Mul(Simd::Add(Simd::Mul(noise, Simd::Set(-2)), Simd::Set(1)), amp));
+                amp = Simd::Mul(amp, SimdLerp(Simd::Set(1.0f), Simd::Sub(Simd::Set(1), noise), Simd::Set(mWeightedStrength)));
+            }
+
+            x = Simd::Mul(x, Simd::Set(mLacunarity));
+            y = Simd::Mul(y, Simd::Set(mLacunarity));
+            amp = Simd::Mul(amp, Simd::Set(mGain));
+        }
+
+        return sum;
+    }
+
+    template <FractalType Fractal>
+    SimdFloat SimdGenValueFractal(SimdFloat x, SimdFloat y, SimdFloat z) const
+    {
+        if (Fractal == FractalType_None)
+            return SimdSingleValue(mSeed, x, y, z);
+
+        int seed = mSeed;
+        SimdFloat sum = Simd::Set(0);
+        SimdFloat amp = Simd::Set(mFractalBounding);
+
+        for (int i = 0; i < mActiveOctaves; i++)
+        {
+            if (i == mFadedOctave)
+                amp = Simd::Mul(amp, Simd::Set(mFadedOctaveWeight));
+
+            SimdFloat noise = SimdSingleValue(seed++, x, y, z);
+            if (Fractal == FractalType_FBm)
+            {
+                sum = Simd::Add(sum, Simd::Mul(noise, amp));
+                amp = Simd::Mul(amp, SimdLerp(Simd::Set(1.0f), Simd::Mul(Simd::Add(noise, Simd::Set(1)), Simd::Set(0.5f)), Simd::Set(mWeightedStrength)));
+            }
+            else
+            {
+                noise = Simd::Abs(noise);
+                sum = Simd::Add(sum, Simd::Mul(Simd::Add(Simd::Mul(noise, Simd::Set(-2)), Simd::Set(1)), amp));
+                amp = Simd::Mul(amp, SimdLerp(Simd::Set(1.0f), Simd::Sub(Simd::Set(1), noise), Simd::Set(mWeightedStrength)));
+            }
+
+            x = Simd::Mul(x, Simd::Set(mLacunarity));
+            y = Simd::Mul(y, Simd::Set(mLacunarity));
+            z = Simd::Mul(z, Simd::Set(mLacunarity));
+            amp = Simd::Mul(amp, Simd::Set(mGain));
+        }
+
+        return sum;
+    }
+
+    static void SimdStoreLine(float* out, int k, int count, int stride, SimdFloat value)
+    {
+        if (stride == 1 && k + Simd::Width <= count)
+        {
+            Simd::Store(out + k, value);
+            return;
+        }
+
+        float lanes[Simd::Width];
+        Simd::Store(lanes, value);
+        for (int lane = 0; lane < Simd::Width && k + lane < count; lane++)
+        {
+            out[(k + lane) * stride] = lanes[lane];
+        }
+    }
+
+    static SimdFloat SimdLineCoord(int k, float base, float lineStep, int first)
+    {
+        SimdFloat index = Simd::ToFloat(Simd::AddInt(Simd::SetInt(first + k), Simd::LaneIndex()));
+        return Simd::Add(Simd::Set(base), Simd::Mul(index, Simd::Set(lineStep)));
+    }
+
+    template <FractalType Fractal>
+    void SimdValueLine2D(float* out, int count, int stride, float xBase, float xLineStep, int xFirst, float yBase, float yLineStep, int yFirst) const
+    {
+        for (int k = 0; k < count; k += Simd::Width)
+        {
+            SimdFloat x = SimdLineCoord(k, xBase, xLineStep, xFirst);
+            SimdFloat y = SimdLineCoord(k, yBase, yLineStep, yFirst);
+
+            // TransformNoiseCoordinate for Value noise is only the frequency
+            x = Simd::Mul(x, Simd::Set(mFrequency));
+            y = Simd::Mul(y, Simd::Set(mFrequency));
+
+            SimdStoreLine(out, k, count, stride, SimdGenValueFractal<Fractal>(x, y));
+        }
+    }
+
+    template <FractalType Fractal>
+    void SimdValueLine3D(float* out, int count, int stride, float xBase, float xLineStep, int xFirst, float yBase, float yLineStep, int yFirst, float zBase, float zLineStep, int zFirst) const
+    {
+        for (int k = 0; k < count; k += Simd::Width)
+        {
+            SimdFloat x = SimdLineCoord(k, xBase, xLineStep, xFirst);
+            SimdFloat y = SimdLineCoord(k, yBase, yLineStep, yFirst);
+            SimdFloat z = SimdLineCoord(k, zBase, zLineStep, zFirst);
+
+            x = Simd::Mul(x, Simd::Set(mFrequency));
+            y = Simd::Mul(y, Simd::Set(mFrequency));
+            z = Simd::Mul(z, Simd::Set(mFrequency));
+
+            SimdStoreLine(out, k, count, stride, SimdGenValueFractal<Fractal>(x, y, z));
+        }
+    }
+
+    // Vector OpenSimplex2 domain warp, the steps of DomainWarpSingle and SingleDomainWarpSimplexGradient in order
+
+    static void SimdWarpGradient(int seed, SimdInt xPrimed, SimdInt yPrimed, SimdFloat xd, SimdFloat yd, bool outGradOnly, SimdFloat& xo, SimdFloat& yo)
+    {
+        SimdInt hash = Simd::MulInt(Simd::Xor(Simd::Xor(Simd::SetInt(seed), xPrimed), yPrimed), Simd::SetInt(0x27d4eb2d));
+
+        if (outGradOnly)
+        {
+            // GradCoordOut
+            SimdInt index = Simd::AndInt(hash, Simd::SetInt(255 << 1));
+            xo = Simd::Gather(Lookup<float>::RandVecs2D, index);
+            yo = Simd::Gather(Lookup<float>::RandVecs2D, Simd::OrInt(index, Simd::SetInt(1)));
+            return;
+        }
+
+        // GradCoordDual
+        SimdInt index1 = Simd::AndInt(hash, Simd::SetInt(127 << 1));
+        SimdInt index2 = Simd::AndInt(Simd::ShiftRight7(hash), Simd::SetInt(255 << 1));
+
+        SimdFloat xg = Simd::Gather(Lookup<float>::Gradients2D, index1);
+        SimdFloat yg = Simd::Gather(Lookup<float>::Gradients2D, Simd::OrInt(index1, Simd::SetInt(1)));
+        SimdFloat value = Simd::Add(Simd::Mul(xd, xg), Simd::Mul(yd, yg));
+
+        xo = Simd::Mul(value, Simd::Gather(Lookup<float>::RandVecs2D, index2));
+        yo = Simd::Mul(value, Simd::Gather(Lookup<float>::RandVecs2D, Simd::OrInt(index2, Simd::SetInt(1))));
+    }
+
+    // Adds the contribution of one simplex corner in the lanes where its falloff is positive
+    static void SimdWarpCorner(int seed, SimdFloat falloff, SimdInt xPrimed, SimdInt yPrimed, SimdFloat xd, SimdFloat yd, bool outGradOnly, SimdFloat& vx, SimdFloat& vy)
+    {
+        SimdFloat inside = Simd::GreaterThan(falloff, Simd::Set(0));
+        SimdFloat ffff = Simd::Mul(Simd::Mul(falloff, falloff), Simd::Mul(falloff, falloff));
+
+        SimdFloat xo, yo;
+        SimdWarpGradient(seed, xPrimed, yPrimed, xd, yd, outGradOnly, xo, yo);
+        vx = Simd::Add(vx, Simd::And(inside, Simd::Mul(ffff, xo)));
+        vy = Simd::Add(vy, Simd::And(inside, Simd::Mul(ffff, yo)));
+    }
+
+    void SimdWarpSimplex(SimdFloat& x, SimdFloat& y, float warpAmp, bool outGradOnly) const
+    {
+        // TransformDomainWarpCoordinate
+        const float F2 = 0.5f * ((float)1.7320508075688772935274463415059 - 1);
+
+        SimdFloat skew = Simd::Mul(Simd::Add(x, y), Simd::Set(F2));
+        SimdFloat xs = Simd::Mul(Simd::Add(x, skew), Simd::Set(mFrequency));
+        SimdFloat ys = Simd::Mul(Simd::Add(y, skew), Simd::Set(mFrequency));
+
+        SimdInt i = Simd::FastFloor(xs);
+        SimdInt j = Simd::FastFloor(ys);
+        SimdFloat xi = Simd::Sub(xs, Simd::ToFloat(i));
+        SimdFloat yi = Simd::Sub(ys, Simd::ToFloat(j));
+
+        SimdFloat vx, vy;
+        SimdWarpVector(i, j, xi, yi, outGradOnly, vx, vy);
+
+        x = Simd::Add(x, Simd::Mul(vx, Simd::Set(warpAmp)));
+        y = Simd::Add(y, Simd::Mul(vy, Simd::Set(warpAmp)));
+    }
+
+    // AnchoredWarpSimplex
+    void SimdWarpSimplex(const AxisAnchor& xAnchor, const AxisAnchor& yAnchor, SimdFloat& x, SimdFloat& y, float warpAmp, bool outGradOnly) const
+    {
+        const float F2 = 0.5f * ((float)1.7320508075688772935274463415059 - 1);
+
+        SimdFloat skew = Simd::Mul(Simd::Add(x, y), Simd::Set(F2));
+        SimdFloat xs = Simd::Add(Simd::Set(xAnchor.warpFraction[0] + yAnchor.warpFraction[1]), Simd::Mul(Simd::Add(x, skew), Simd::Set(mFrequency)));
+        SimdFloat ys = Simd::Add(Simd::Set(yAnchor.warpFraction[0] + xAnchor.warpFraction[1]), Simd::Mul(Simd::Add(y, skew), Simd::Set(mFrequency)));
+
+        SimdInt i = Simd::FastFloor(xs);
+        SimdInt j = Simd::FastFloor(ys);
+        SimdFloat xi = Simd::Sub(xs, Simd::ToFloat(i));
+        SimdFloat yi = Simd::Sub(ys, Simd::ToFloat(j));
+
+        SimdFloat vx, vy;
+        SimdWarpVector(Simd::AddInt(i, Simd::SetInt(xAnchor.warpCell[0] + yAnchor.warpCell[1])),
+            Simd::AddInt(j, Simd::SetInt(yAnchor.warpCell[0] + xAnchor.warpCell[1])), xi, yi, outGradOnly, vx, vy);
+
+        x = Simd::Add(x, Simd::Mul(vx, Simd::Set(warpAmp)));
+        y = Simd::Add(y, Simd::Mul(vy, Simd::Set(warpAmp)));
+    }
+
+    // SimplexWarpVector
+    void SimdWarpVector(SimdInt i, SimdInt j, SimdFloat xi, SimdFloat yi, bool outGradOnly, SimdFloat& vx, SimdFloat& vy) const
+    {
+        const float SQRT3 = 1.7320508075688772935274463415059f;
+        const float G2 = (3 - SQRT3) / 6;
+
+        SimdFloat t = Simd::Mul(Simd::Add(xi, yi), Simd::Set(G2));
+        SimdFloat x0 = Simd::Sub(xi, t);
+        SimdFloat y0 = Simd::Sub(yi, t);
+
+        i = Simd::MulInt(i, Simd::SetInt(PrimeX));
+        j = Simd::MulInt(j, Simd::SetInt(PrimeY));
+
+        vx = Simd::Set(0);
+        vy = Simd::Set(0);
+
+        SimdFloat a = Simd::Sub(Simd::Sub(Simd::Set(0.5f), Simd::Mul(x0, x0)), Simd::Mul(y0, y0));
+        SimdWarpCorner(mSeed, a, i, j, x0, y0, outGradOnly, vx, vy);
+
+        SimdFloat c = Simd::Add(Simd::Mul(Simd::Set((float)(2 * (1 - 2 * G2) * (1 / G2 - 2))), t), Simd::Add(Simd::Set((float)(-2 * (1 - 2 * G2) * (1 - 2 * G2))), a));
+        SimdFloat x2 = Simd::Add(x0, Simd::Set(2 * (float)G2 - 1));
+        SimdFloat y2 = Simd::Add(y0, Simd::Set(2 * (float)G2 - 1));
+        SimdWarpCorner(mSeed, c, Simd::AddInt(i, Simd::SetInt(PrimeX)), Simd::AddInt(j, Simd::SetInt(PrimeY)), x2, y2, outGradOnly, vx, vy);
+
+        // Third corner is above or below the diagonal, picked per lane
+        SimdFloat upper = Simd::GreaterThan(y0, x0);
+        SimdFloat x1 = Simd::Select(upper, Simd::Add(x0, Simd::Set((float)G2)), Simd::Add(x0, Simd::Set((float)G2 - 1)));
+        SimdFloat y1 = Simd::Select(upper, Simd::Add(y0, Simd::Set((float)G2 - 1)), Simd::Add(y0, Simd::Set((float)G2)));
+        SimdInt i1 = Simd::SelectInt(upper, i, Simd::AddInt(i, Simd::SetInt(PrimeX)));
+        SimdInt j1 = Simd::SelectInt(upper, Simd::AddInt(j, Simd::SetInt(PrimeY)), j);
+        SimdFloat b = Simd::Sub(Simd::Sub(Simd::Set(0.5f), Simd::Mul(x1, x1)), Simd::Mul(y1, y1));
+        SimdWarpCorner(mSeed, b, i1, j1, x1, y1, outGradOnly, vx, vy);
+    }
+
+    template <FractalType Fractal>
+    void SimdWarpedValueLine2D(float* out, int count, int stride, float xBase, float xLineStep, int xFirst, float yBase, float yLineStep, int yFirst, float warpAmp, bool outGradOnly) const
+    {
+        for (int k = 0; k < count; k += Simd::Width)
+        {
+            SimdFloat x = SimdLineCoord(k, xBase, xLineStep, xFirst);
+            SimdFloat y = SimdLineCoord(k, yBase, yLineStep, yFirst);
+
+            SimdWarpSimplex(x, y, warpAmp, outGradOnly);
+
+            x = Simd::Mul(x, Simd::Set(mFrequency));
+            y = Simd::Mul(y, Simd::Set(mFrequency));
+
+            SimdStoreLine(out, k, count, stride, SimdGenValueFractal<Fractal>(x, y));
+        }
+    }
+
+    bool GenWarpedGridLineSimd2D(float* out, int count, int stride, float xBase, float xLineStep, int xFirst, float yBase, float yLineStep, int yFirst) const
+    {
+        if (mNoiseType != NoiseType_Value)
+            return false;
+
+        float warpAmp;
+        bool outGradOnly;
+        if (!SimplexWarpAmp(warpAmp, outGradOnly))
+            return false;
+
+        // The domain warp fractal types warp progressively or independently, which stays scalar
+        switch (mFractalType)
+        {
+        case FractalType_None:
+            SimdWarpedValueLine2D<FractalType_None>(out, count, stride, xBase, xLineStep, xFirst, yBase, yLineStep, yFirst, warpAmp, outGradOnly);
+            return true;
+        case FractalType_FBm:
+            SimdWarpedValueLine2D<FractalType_FBm>(out, count, stride, xBase, xLineStep, xFirst, yBase, yLineStep, yFirst, warpAmp, outGradOnly);
+            return true;
+        case FractalType_Ridged:
+            SimdWarpedValueLine2D<FractalType_Ridged>(out, count, stride, xBase, xLineStep, xFirst, yBase, yLineStep, yFirst, warpAmp, outGradOnly);
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    template <FractalType Fractal>
+    void SimdAnchoredValueLine2D(float* out, int count, int stride, const AxisAnchor& xAnchor, float xBase, float xLineStep, int xFirst,
+        const AxisAnchor& yAnchor, float yBase, float yLineStep, int yFirst, bool warp, float warpAmp, bool outGradOnly) const
+    {
+        for (int k = 0; k < count; k += Simd::Width)
+        {
+            SimdFloat x = SimdLineCoord(k, xBase, xLineStep, xFirst);
+            SimdFloat y = SimdLineCoord(k, yBase, yLineStep, yFirst);
+
+            if (warp)
+                SimdWarpSimplex(xAnchor, yAnchor, x, y, warpAmp, outGradOnly);
+
+            x = Simd::Mul(x, Simd::Set(mFrequency));
+            y = Simd::Mul(y, Simd::Set(mFrequency));
+
+            SimdStoreLine(out, k, count, stride, SimdGenValueFractal<Fractal>(xAnchor, yAnchor, x, y));
+        }
+    }
+
+    bool GenAnchoredGridLineSimd2D(float* out, int count, int stride, const AxisAnchor& xAnchor, float xBase, float xLineStep, int xFirst,
+        const AxisAnchor& yAnchor, float yBase, float yLineStep, int yFirst, bool warp) const
+    {
+        if (!AnchoredSupported(warp))
+            return false;
+
+        float warpAmp = 0;
+        bool outGradOnly = false;
+        if (warp)
+            SimplexWarpAmp(warpAmp, outGradOnly);
+
+        switch (mFractalType)
+        {
+        case FractalType_FBm:
+            SimdAnchoredValueLine2D<FractalType_FBm>(out, count, stride, xAnchor, xBase, xLineStep, xFirst, yAnchor, yBase, yLineStep, yFirst, warp, warpAmp, outGradOnly);
+            return true;
+        case FractalType_Ridged:
+            SimdAnchoredValueLine2D<FractalType_Ridged>(out, count, stride, xAnchor, xBase, xLineStep, xFirst, yAnchor, yBase, yLineStep, yFirst, warp, warpAmp, outGradOnly);
+            return true;
+        default:
+            SimdAnchoredValueLine2D<FractalType_None>(out, count, stride, xAnchor, xBase, xLineStep, xFirst, yAnchor, yBase, yLineStep, yFirst, warp, warpAmp, outGradOnly);
+            return true;
+        }
+    }
+
+    bool GenGridLineSimd2D(float* out, int count, int stride, float xBase, float xLineStep, int xFirst, float yBase, float yLineStep, int yFirst) const
+    {
+        if (mNoiseType != NoiseType_Value)
+            return false;
+
+        switch (mFractalType)
+        {
+        default:
+            SimdValueLine2D<FractalType_None>(out, count, stride, xBase, xLineStep, xFirst, yBase, yLineStep, yFirst);
+            return true;
+        case FractalType_FBm:
+            SimdValueLine2D<FractalType_FBm>(out, count, stride, xBase, xLineStep, xFirst, yBase, yLineStep, yFirst);
+            return true;
+        case FractalType_Ridged:
+            SimdValueLine2D<FractalType_Ridged>(out, count, stride, xBase, xLineStep, xFirst, yBase, yLineStep, yFirst);
+            return true;
+        case FractalType_PingPong:
+            return false;
+        }
+    }
+
+    bool GenGridLineSimd3D(float* out, int count, int stride, float xBase, float xLineStep, int xFirst, float yBase, float yLineStep, int yFirst, float zBase, float zLineStep, int zFirst) const
+    {
+        if (mNoiseType != NoiseType_Value || mTransformType3D != TransformType3D_None)
+            return false;
+
+        switch (mFractalType)
+        {
+        default:
+            SimdValueLine3D<FractalType_None>(out, count, stride, xBase, xLineStep, xFirst, yBase, yLineStep, yFirst, zBase, zLineStep, zFirst);
+            return true;
+        case FractalType_FBm:
+            SimdValueLine3D<FractalType_FBm>(out, count, stride, xBase, xLineStep, xFirst, yBase, yLineStep, yFirst, zBase, zLineStep, zFirst);
+            return true;
+        case FractalType_Ridged:
+            SimdValueLine3D<FractalType_Ridged>(out, count, stride, xBase, xLineStep, xFirst, yBase, yLineStep, yFirst, zBase, zLineStep, zFirst);
+            return true;
+        case FractalType_PingPong:
+            return false;
+        }
+    }
+
+#endif
 };
 
 template <>
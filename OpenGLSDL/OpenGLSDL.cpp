@@ -1,6 +1,9 @@
 #include <iostream>
 
 #include "program.h"
+#include "benchmark.h"
+#include "noisebenchmark.h"
+#include "gpuparity.h"
 #define SDL_MAIN_USE_CALLBACKS 
 #include "SDL3/SDL_main.h"
 
@@ -8,6 +11,20 @@ Program program;
 
 SDL_AppResult SDL_AppInit(void** appstate, int argc, char** argv) 
 {
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--benchmark") == 0) {
+            runBenchmarks();
+            return SDL_APP_SUCCESS;
+        }
+        if (std::strcmp(argv[i], "--noise-benchmark") == 0) {
+            const bool written = runNoiseBenchmark(i + 1 < argc ? argv[i + 1] : "");
+            return written ? SDL_APP_SUCCESS : SDL_APP_FAILURE;
+        }
+        if (std::strcmp(argv[i], "--gpu-parity") == 0) {
+            return runGpuParity() ? SDL_APP_SUCCESS : SDL_APP_FAILURE;
+        }
+    }
+
     if (program.init()) {
         return SDL_APP_CONTINUE;
     }
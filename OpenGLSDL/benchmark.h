@@ -0,0 +1,1115 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "erosion.h"
+#include "heightfield.h"
+#include "mappedfile.h"
+#include "meshcache.h"
+#include "meshoptimize.h"
+#include "model.h"
+#include "modelloader.h"
+#include "shape.h"
+#include "threadpool.h"
+
+// Run with --benchmark to print these instead of opening the window.
+
+double elapsedMs(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Thread counts 1, 2, 4, ... up to (and including) the hardware thread count
+std::vector<unsigned int> benchmarkThreadCounts()
+{
+    const unsigned int hardware = std::max(1u, std::thread::hardware_concurrency());
+
+    std::vector<unsigned int> counts;
+    for (unsigned int threads = 1; threads < hardware; threads *= 2) {
+        counts.push_back(threads);
+    }
+    counts.push_back(hardware);
+
+    return counts;
+}
+
+void benchmarkGeneratePlane(int width, int height, float resolution)
+{
+    std::cout << std::defaultfloat << "Shape::buildPlane " << width << "x" << height << " @ " << resolution << "\n";
+
+    Shape reference;
+    double baseline = 0.0;
+
+    for (unsigned int threads : benchmarkThreadCounts()) {
+        ThreadPool pool(threads);
+        Shape plane;
+
+        auto start = std::chrono::steady_clock::now();
+        plane.buildPlane(width, height, resolution, pool);
+        double ms = elapsedMs(start);
+
+        bool identical = true;
+        if (threads == 1) {
+            baseline = ms;
+            reference = std::move(plane);
+        }
+        else {
+            identical = plane.vertices.size() == reference.vertices.size()
+                && std::memcmp(plane.vertices.data(), reference.vertices.data(), plane.vertices.size() * sizeof(float)) == 0
+                && plane.indices == reference.indices;
+        }
+
+        std::cout << "  threads " << std::setw(3) << threads
+            << "  " << std::fixed << std::setprecision(1) << std::setw(8) << ms << " ms"
+            << "  speedup " << std::setprecision(2) << baseline / ms << "x"
+            << (identical ? "" : "  MISMATCH") << "\n";
+    }
+}
+
+// Terrain noise settings, one GetNoise call per sample against one GetNoiseGrid2D call per row
+void benchmarkNoiseGrid(int samplesPerSide)
+{
+    std::cout << std::defaultfloat << "FastNoiseLite terrain noise " << samplesPerSide << "x" << samplesPerSide << "\n";
+
+    const FastNoiseLite noise = noiseGen();
+    const float step = 0.012f;
+    const double samples = (double) samplesPerSide * samplesPerSide;
+    std::vector<float> single(samplesPerSide * samplesPerSide);
+    std::vector<float> grid(samplesPerSide * samplesPerSide);
+
+    auto start = std::chrono::steady_clock::now();
+    for (int j = 0; j < samplesPerSide; j++) {
+        for (int i = 0; i < samplesPerSide; i++) {
+            single[j * samplesPerSide + i] = noise.GetNoise(j * step, i * step);
+        }
+    }
+    double singleMs = elapsedMs(start);
+
+    start = std::chrono::steady_clock::now();
+    for (int j = 0; j < samplesPerSide; j++) {
+        noise.GetNoiseGrid2D(&grid[j * samplesPerSide], 1, samplesPerSide, j * step, 0.0f, step, step, samplesPerSide, 1);
+    }
+    double gridMs = elapsedMs(start);
+
+    bool identical = std::memcmp(single.data(), grid.data(), grid.size() * sizeof(float)) == 0;
+
+    std::cout << std::fixed << std::setprecision(1)
+        << "  GetNoise       " << std::setw(8) << samples / singleMs / 1000.0 << " Msamples/s\n"
+        << "  GetNoiseGrid2D " << std::setw(8) << samples / gridMs / 1000.0 << " Msamples/s"
+        << "  speedup " << std::setprecision(2) << singleMs / gridMs << "x"
+        << (identical ? "" : "  MISMATCH") << "\n";
+}
+
+// Terrain noise settings, plain FBm against DomainWarp + GetNoise per sample and the fused warped grid
+void benchmarkWarpedGrid(int samplesPerSide)
+{
+    std::cout << std::defaultfloat << "FastNoiseLite warped terrain noise " << samplesPerSide << "x" << samplesPerSide << "\n";
+
+    const FastNoiseLite noise = noiseGen();
+    const float step = 0.012f;
+    const double samples = (double) samplesPerSide * samplesPerSide;
+    std::vector<float> plain(samplesPerSide * samplesPerSide);
+    std::vector<float> separate(samplesPerSide * samplesPerSide);
+    std::vector<float> fused(samplesPerSide * samplesPerSide);
+
+    auto start = std::chrono::steady_clock::now();
+    noise.GetNoiseGrid2D(plain.data(), samplesPerSide, samplesPerSide, 0.0f, 0.0f, step, step);
+    double plainMs = elapsedMs(start);
+
+    start = std::chrono::steady_clock::now();
+    for (int j = 0; j < samplesPerSide; j++) {
+        for (int i = 0; i < samplesPerSide; i++) {
+            float x = i * step;
+            float y = j * step;
+            noise.DomainWarp(x, y);
+            separate[j * samplesPerSide + i] = noise.GetNoise(x, y);
+        }
+    }
+    double separateMs = elapsedMs(start);
+
+    start = std::chrono::steady_clock::now();
+    noise.GetWarpedNoiseGrid2D(fused.data(), samplesPerSide, samplesPerSide, 0.0f, 0.0f, step, step);
+    double fusedMs = elapsedMs(start);
+
+    bool identical = std::memcmp(separate.data(), fused.data(), fused.size() * sizeof(float)) == 0;
+
+    std::cout << std::fixed << std::setprecision(1)
+        << "  GetNoiseGrid2D        " << std::setw(8) << samples / plainMs / 1000.0 << " Msamples/s\n"
+        << "  DomainWarp + GetNoise " << std::setw(8) << samples / separateMs / 1000.0 << " Msamples/s\n"
+        << "  GetWarpedNoiseGrid2D  " << std::setw(8) << samples / fusedMs / 1000.0 << " Msamples/s"
+        << "  " << std::setprecision(2) << fusedMs / plainMs << "x plain"
+        << (identical ? "" : "  MISMATCH") << "\n";
+}
+
+// Terrain noise with every octave against the octave limit terrainNoise picks for the vertex spacing
+void benchmarkOctaveLimit(int samplesPerSide, float resolution)
+{
+    const FastNoiseLite full = noiseGen();
+    const FastNoiseLite limited = terrainNoise(resolution);
+    const float step = resolution * TERRAIN_NOISE_SCALING;
+
+    std::cout << std::defaultfloat << "FastNoiseLite octave limit " << samplesPerSide << "x" << samplesPerSide
+        << ", " << full.GetFractalOctavesForSpacing(step) << " of 9 octaves\n";
+
+    const double samples = (double) samplesPerSide * samplesPerSide;
+    std::vector<float> fullHeights(samplesPerSide * samplesPerSide);
+    std::vector<float> limitedHeights(samplesPerSide * samplesPerSide);
+
+    auto start = std::chrono::steady_clock::now();
+    full.GetNoiseGrid2D(fullHeights.data(), samplesPerSide, samplesPerSide, 0.0f, 0.0f, step, step);
+    double fullMs = elapsedMs(start);
+
+    start = std::chrono::steady_clock::now();
+    limited.GetNoiseGrid2D(limitedHeights.data(), samplesPerSide, samplesPerSide, 0.0f, 0.0f, step, step);
+    double limitedMs = elapsedMs(start);
+
+    float maxDifference = 0.0f;
+    for (size_t i = 0; i < fullHeights.size(); i++) {
+        maxDifference = std::max(maxDifference, std::abs(fullHeights[i] - limitedHeights[i]) * TERRAIN_HEIGHT_SCALE);
+    }
+
+    std::cout << std::fixed << std::setprecision(1)
+        << "  all octaves " << std::setw(8) << samples / fullMs / 1000.0 << " Msamples/s\n"
+        << "  limited     " << std::setw(8) << samples / limitedMs / 1000.0 << " Msamples/s"
+        << "  speedup " << std::setprecision(2) << fullMs / limitedMs << "x"
+        << "  max height difference " << std::setprecision(4) << maxDifference << "\n";
+}
+
+// Runtime dispatched GetNoise against a FastNoiseLite::Sampler with the same settings
+void benchmarkSampler(const char* name, const FastNoiseLite& noise, bool volume, int samples)
+{
+    const FastNoiseLite::Sampler sampler = noise.GetSampler();
+    std::vector<float> dispatched(samples);
+    std::vector<float> specialized(samples);
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < samples; i++) {
+        dispatched[i] = volume ? noise.GetNoise(i * 0.37f, i * 0.11f, i * -0.23f) : noise.GetNoise(i * 0.37f, i * 0.11f);
+    }
+    double dispatchedMs = elapsedMs(start);
+
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < samples; i++) {
+        specialized[i] = volume ? sampler.GetNoise(i * 0.37f, i * 0.11f, i * -0.23f) : sampler.GetNoise(i * 0.37f, i * 0.11f);
+    }
+    double specializedMs = elapsedMs(start);
+
+    bool identical = std::memcmp(dispatched.data(), specialized.data(), specialized.size() * sizeof(float)) == 0;
+
+    std::cout << std::fixed << std::setprecision(1)
+        << "  " << std::left << std::setw(20) << name << std::right
+        << std::setw(8) << samples / dispatchedMs / 1000.0 << " -> "
+        << std::setw(8) << samples / specializedMs / 1000.0 << " Msamples/s"
+        << "  speedup " << std::setprecision(2) << dispatchedMs / specializedMs << "x"
+        << (identical ? "" : "  MISMATCH") << "\n";
+}
+
+void benchmarkSamplers(int samples)
+{
+    std::cout << std::defaultfloat << "FastNoiseLite GetNoise -> Sampler, " << samples << " samples\n";
+
+    benchmarkSampler("terrain", noiseGen(), false, samples);
+
+    FastNoiseLite noise;
+    noise.SetFrequency(0.05f);
+    noise.SetFractalOctaves(5);
+
+    noise.SetNoiseType(FastNoiseLite::NoiseType_Perlin);
+    noise.SetFractalType(FastNoiseLite::FractalType_FBm);
+    benchmarkSampler("Perlin FBm 2D", noise, false, samples);
+
+    noise.SetNoiseType(FastNoiseLite::NoiseType_OpenSimplex2);
+    noise.SetFractalType(FastNoiseLite::FractalType_Ridged);
+    benchmarkSampler("OpenSimplex2 ridged", noise, false, samples);
+
+    noise.SetFractalType(FastNoiseLite::FractalType_FBm);
+    benchmarkSampler("OpenSimplex2 FBm 3D", noise, true, samples);
+
+    noise.SetNoiseType(FastNoiseLite::NoiseType_Cellular);
+    noise.SetFractalType(FastNoiseLite::FractalType_None);
+    benchmarkSampler("Cellular 2D", noise, false, samples);
+}
+
+// The per-triangle normals Shape used before heightfieldNormals: every vertex sums the
+// face normals of the triangles around it. Kept as the reference for the parity check.
+std::vector<float> referenceFaceNormals(const Shape& plane)
+{
+    const int vertsPerRow = plane.vertsPerRow;
+    const int vertsPerCol = plane.vertsPerCol;
+    const int numQuadsX = vertsPerRow - 1;
+    const int numQuadsZ = vertsPerCol - 1;
+    std::vector<float> normals((size_t) vertsPerRow * vertsPerCol * 3);
+
+    auto position = [&](int i, int j) {
+        const float* p = plane.vertices.data() + ((size_t) j * vertsPerRow + i) * 3;
+        return glm::vec3(p[0], p[1], p[2]);
+    };
+    auto firstTriangle = [&](int i, int j) {
+        glm::vec3 v1 = position(i, j);
+        return glm::cross(position(i, j + 1) - v1, position(i + 1, j) - v1);
+    };
+    auto secondTriangle = [&](int i, int j) {
+        glm::vec3 v1 = position(i + 1, j);
+        return glm::cross(position(i, j + 1) - v1, position(i + 1, j + 1) - v1);
+    };
+
+    for (int j = 0; j < vertsPerCol; ++j) {
+        for (int i = 0; i < vertsPerRow; ++i) {
+            glm::vec3 normal(0.0f, 0.0f, 0.0f);
+            if (j > 0) {
+                if (i > 0) {
+                    normal += secondTriangle(i - 1, j - 1);
+                }
+                if (i < numQuadsX) {
+                    normal += firstTriangle(i, j - 1);
+                    normal += secondTriangle(i, j - 1);
+                }
+            }
+            if (j < numQuadsZ) {
+                if (i > 0) {
+                    normal += firstTriangle(i - 1, j);
+                    normal += secondTriangle(i - 1, j);
+                }
+                if (i < numQuadsX) {
+                    normal += firstTriangle(i, j);
+                }
+            }
+
+            normal = glm::normalize(normal);
+            float* out = normals.data() + ((size_t) j * vertsPerRow + i) * 3;
+            out[0] = normal.x;
+            out[1] = normal.y;
+            out[2] = normal.z;
+        }
+    }
+
+    return normals;
+}
+
+// Baked horizon lighting of a plane's interior, against marching every vertex on its own. Both
+// take the same steps, so the bytes must match.
+void benchmarkHorizons(int samplesPerSide)
+{
+    std::cout << std::defaultfloat << "Horizon lighting " << samplesPerSide << "x" << samplesPerSide << "\n";
+
+    const float resolution = 0.1f;
+    const int radius = 64;
+    Shape plane;
+    plane.buildGrid(samplesPerSide, samplesPerSide, resolution, ThreadPool::shared());
+    const float sun[3] = { 0.2f, 1.0f, 0.3f };
+
+    const int inner = samplesPerSide - 2 * radius;
+    const float* interior = plane.heights.data() + (size_t) radius * samplesPerSide + radius;
+    std::vector<unsigned char> reference((size_t) inner * inner * 2);
+    std::vector<unsigned char> lighting(reference.size());
+
+    // The same marches and shading as heightfieldHorizons, one vertex at a time
+    std::vector<HorizonStep> skySteps[8];
+    for (int d = 0; d < 8; d++) {
+        const float angle = d * (6.28318531f / 8);
+        skySteps[d] = heightfieldHorizonSteps(std::cos(angle), std::sin(angle), radius, true, samplesPerSide, resolution);
+    }
+    const float sunAcross = std::sqrt(sun[0] * sun[0] + sun[2] * sun[2]);
+    const float sunElevation = std::atan2(sun[1], sunAcross);
+    const std::vector<HorizonStep> sunSteps = heightfieldHorizonSteps(sun[0] / sunAcross, sun[2] / sunAcross, radius, false, samplesPerSide, resolution);
+
+    auto start = std::chrono::steady_clock::now();
+    for (int j = 0; j < inner; j++) {
+        for (int i = 0; i < inner; i++) {
+            const float* vertex = interior + (size_t) j * samplesPerSide + i;
+            float sky = 0.0f;
+            for (const std::vector<HorizonStep>& steps : skySteps) {
+                float slope = 0.0f;
+                for (const HorizonStep& step : steps) {
+                    slope = std::max(slope, (vertex[step.offset] - vertex[0]) * step.inverseDistance);
+                }
+                sky += 1.0f / (1.0f + slope * slope);
+            }
+            float sunSlope = 0.0f;
+            for (const HorizonStep& step : sunSteps) {
+                sunSlope = std::max(sunSlope, (vertex[step.offset] - vertex[0]) * step.inverseDistance);
+            }
+            const float t = std::min(std::max((sunElevation - std::atan(sunSlope)) / 0.05f + 0.5f, 0.0f), 1.0f);
+
+            unsigned char* pair = reference.data() + ((size_t) j * inner + i) * 2;
+            pair[0] = (unsigned char) (sky / 8 * 255.0f + 0.5f);
+            pair[1] = (unsigned char) (t * t * (3.0f - 2.0f * t) * 255.0f + 0.5f);
+        }
+    }
+    double referenceMs = elapsedMs(start);
+
+    double baseline = 0.0;
+    for (unsigned int threads : benchmarkThreadCounts()) {
+        ThreadPool pool(threads);
+
+        start = std::chrono::steady_clock::now();
+        heightfieldHorizons(interior, samplesPerSide, inner, inner, resolution, radius, sun, lighting.data(), pool);
+        double ms = elapsedMs(start);
+        if (threads == 1) {
+            baseline = ms;
+        }
+
+        std::cout << "  threads " << std::setw(3) << threads
+            << "  " << std::fixed << std::setprecision(2) << std::setw(8) << ms << " ms"
+            << "  speedup over per-vertex " << std::setprecision(1) << referenceMs / ms << "x"
+            << "  over 1 thread " << std::setprecision(2) << baseline / ms << "x"
+            << (lighting == reference ? "" : "  MISMATCH") << "\n";
+    }
+
+    double occlusion = 0.0;
+    double shadow = 0.0;
+    for (size_t i = 0; i < lighting.size(); i += 2) {
+        occlusion += lighting[i];
+        shadow += lighting[i + 1];
+    }
+    std::cout << "  per-vertex     " << std::fixed << std::setprecision(2) << std::setw(8) << referenceMs << " ms\n"
+        << "  mean sky " << std::setprecision(3) << occlusion / (255.0 * inner * inner)
+        << ", mean sun " << shadow / (255.0 * inner * inner) << "\n";
+
+    // A stroke of the 2.0 radius brush Program uses bakes its vertices and everything that sees
+    // them again: Terrain copies their apron out on the main thread and bakes it on one worker
+    const int stale = (int) (2.0f * 2.0f / resolution) + 1 + 2 * radius;
+    const int pitch = stale + 2 * radius;
+    if (pitch > samplesPerSide) {
+        return;
+    }
+
+    start = std::chrono::steady_clock::now();
+    std::vector<float> apron((size_t) pitch * pitch);
+    for (int j = 0; j < pitch; j++) {
+        std::memcpy(apron.data() + (size_t) j * pitch, plane.heights.data() + (size_t) j * samplesPerSide, pitch * sizeof(float));
+    }
+    double copyMs = elapsedMs(start);
+
+    std::vector<unsigned char> strokeLighting((size_t) stale * stale * 2);
+    start = std::chrono::steady_clock::now();
+    ThreadPool::shared().submit([&]() {
+        heightfieldHorizons(apron.data() + (size_t) radius * pitch + radius, pitch, stale, stale, resolution, radius, sun,
+            strokeLighting.data(), ThreadPool::shared());
+    }).get();
+    double bakeMs = elapsedMs(start);
+
+    // The same vertices as the top left of the whole plane's bake
+    bool matches = true;
+    for (int j = 0; j < stale; j++) {
+        matches &= std::memcmp(strokeLighting.data() + (size_t) j * stale * 2, reference.data() + (size_t) j * inner * 2, (size_t) stale * 2) == 0;
+    }
+    std::cout << "  brush stroke rebake " << stale << "x" << stale << "  copy " << std::setprecision(3) << copyMs
+        << " ms on the main thread, bake " << bakeMs << " ms on one worker" << (matches ? "" : "  MISMATCH") << std::defaultfloat << "\n";
+}
+
+// Largest and mean angle between the central difference normals of plane's interior and the
+// per-triangle reference, in degrees. Border vertices are left out, the reference only sees one
+// side of them.
+void normalAngles(const Shape& plane, const std::vector<float>& reference, const std::vector<float>& normals,
+    double& maxAngle, double& meanAngle)
+{
+    const int samplesPerSide = plane.vertsPerRow;
+    const int inner = samplesPerSide - 2;
+    maxAngle = 0.0;
+    double sumAngle = 0.0;
+    for (int j = 0; j < inner; j++) {
+        for (int i = 0; i < inner; i++) {
+            const float* a = normals.data() + ((size_t) j * inner + i) * 3;
+            const float* b = reference.data() + ((size_t) (j + 1) * samplesPerSide + i + 1) * 3;
+            double cosine = std::min(1.0, (double) a[0] * b[0] + (double) a[1] * b[1] + (double) a[2] * b[2]);
+            double angle = std::acos(cosine) * 180.0 / 3.14159265358979;
+            maxAngle = std::max(maxAngle, angle);
+            sumAngle += angle;
+        }
+    }
+    meanAngle = sumAngle / ((double) inner * inner);
+}
+
+// Central difference normals against the per-triangle reference on the same heights.
+//
+// The two only agree where the grid resolves the surface. Near the Nyquist limit central
+// differences lose the detail (a wave two samples long has none) while the triangle fan still
+// sees it. terrainNoise keeps octaves down to two samples per wave, so on the shipped terrain the
+// finest octave, faded in between two and four samples, keeps the two about two degrees apart on
+// average at any grid size, and up to about 20 degrees on its sharpest creases. Its limits leave
+// a little headroom over that and no more: a spacing 20% off already doubles the mean angle.
+// The tight check runs on the same noise band limited to NORMALS_SAMPLES_PER_WAVE samples, where
+// both converge.
+constexpr double NORMALS_TERRAIN_MAX_ANGLE = 25.0;
+constexpr double NORMALS_TERRAIN_MEAN_ANGLE = 3.0;
+constexpr float NORMALS_SAMPLES_PER_WAVE = 8.0f;
+constexpr double NORMALS_MAX_ANGLE = 4.0;
+constexpr double NORMALS_MEAN_ANGLE = 0.5;
+
+void benchmarkNormals(int samplesPerSide)
+{
+    std::cout << std::defaultfloat << "Heightfield normals " << samplesPerSide << "x" << samplesPerSide << "\n";
+
+    const float resolution = 0.1f;
+    Shape plane;
+    plane.buildGrid(samplesPerSide, samplesPerSide, resolution, ThreadPool::shared());
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<float> reference = referenceFaceNormals(plane);
+    double referenceMs = elapsedMs(start);
+
+    // The plane's own heights are the apron around its interior
+    const int inner = samplesPerSide - 2;
+    const float* interior = plane.heights.data() + samplesPerSide + 1;
+    std::vector<float> normals((size_t) inner * inner * 3);
+
+    double baseline = 0.0;
+    for (unsigned int threads : benchmarkThreadCounts()) {
+        ThreadPool pool(threads);
+
+        start = std::chrono::steady_clock::now();
+        heightfieldNormals(interior, samplesPerSide, inner, inner, resolution, normals.data(), pool);
+        double ms = elapsedMs(start);
+        if (threads == 1) {
+            baseline = ms;
+        }
+
+        std::cout << "  threads " << std::setw(3) << threads
+            << "  " << std::fixed << std::setprecision(2) << std::setw(8) << ms << " ms"
+            << "  speedup over per-triangle " << std::setprecision(1) << referenceMs / ms << "x"
+            << "  over 1 thread " << std::setprecision(2) << baseline / ms << "x\n";
+    }
+
+    double maxAngle = 0.0;
+    double meanAngle = 0.0;
+    normalAngles(plane, reference, normals, maxAngle, meanAngle);
+    bool passed = maxAngle <= NORMALS_TERRAIN_MAX_ANGLE && meanAngle <= NORMALS_TERRAIN_MEAN_ANGLE;
+    std::cout << "  per-triangle   " << std::fixed << std::setprecision(2) << std::setw(8) << referenceMs << " ms\n"
+        << "  terrain: angle to per-triangle normals mean " << std::setprecision(3) << meanAngle << " deg (limit " << NORMALS_TERRAIN_MEAN_ANGLE
+        << "), max " << maxAngle << " deg (limit " << NORMALS_TERRAIN_MAX_ANGLE << ")" << (passed ? "" : "  FAILED") << "\n";
+
+    // The shipped noise without the octaves finer than NORMALS_SAMPLES_PER_WAVE samples
+    FastNoiseLite noise = noiseGen();
+    noise.SetFractalOctaveLimit(noise.GetFractalOctavesForSpacing(resolution * TERRAIN_NOISE_SCALING * NORMALS_SAMPLES_PER_WAVE * 0.5f));
+    const int pitch = samplesPerSide + 2;
+    std::vector<float> apron((size_t) pitch * pitch);
+    terrainHeights(noise.GetSampler(), resolution, -1, -1, pitch, pitch, pitch, apron.data(), ThreadPool::shared());
+    Shape smooth;
+    smooth.buildGrid(samplesPerSide, samplesPerSide, resolution, ThreadPool::shared(), 0, 0, apron.data() + pitch + 1, pitch);
+    heightfieldNormals(smooth.heights.data() + samplesPerSide + 1, samplesPerSide, inner, inner, resolution, normals.data(), ThreadPool::shared());
+    normalAngles(smooth, referenceFaceNormals(smooth), normals, maxAngle, meanAngle);
+    passed = maxAngle <= NORMALS_MAX_ANGLE && meanAngle <= NORMALS_MEAN_ANGLE;
+    std::cout << "  band limited:  angle to per-triangle normals mean " << meanAngle << " deg (limit " << NORMALS_MEAN_ANGLE
+        << "), max " << maxAngle << " deg (limit " << NORMALS_MAX_ANGLE << ")" << (passed ? "" : "  FAILED") << std::defaultfloat << "\n";
+}
+
+// Droplet erosion of a plane's heights: the same droplets run one after another over the whole
+// field, then tiled on 1, 2, 4, ... threads. Every tiled run must match the 1 thread one.
+void benchmarkErosion(int samplesPerSide)
+{
+    std::cout << std::defaultfloat << "Droplet erosion " << samplesPerSide << "x" << samplesPerSide << "\n";
+
+    Shape plane;
+    plane.buildGrid(samplesPerSide, samplesPerSide, 0.1f, ThreadPool::shared());
+    const ErosionSettings settings;
+
+    // Untiled: one generator, droplets anywhere, nothing to schedule
+    std::vector<float> sequential = plane.heights;
+    const size_t count = (size_t) std::lround(settings.dropletsPerSample * (samplesPerSide - 1) * (samplesPerSide - 1));
+    std::mt19937 rng(settings.seed);
+    auto start = std::chrono::steady_clock::now();
+    for (size_t droplet = 0; droplet < count; droplet++) {
+        const float x = erosionRandom(rng) * (samplesPerSide - 1);
+        const float y = erosionRandom(rng) * (samplesPerSide - 1);
+        erodeDroplet(sequential.data(), samplesPerSide, 0, 0, samplesPerSide - 1, samplesPerSide - 1, x, y, settings);
+    }
+    double sequentialMs = elapsedMs(start);
+    std::cout << "  untiled     " << std::fixed << std::setprecision(1) << std::setw(8) << sequentialMs << " ms"
+        << "  " << std::setprecision(2) << std::setw(6) << count / sequentialMs / 1000.0 << " Mdroplets/s\n";
+
+    std::vector<float> reference;
+    double baseline = 0.0;
+    for (unsigned int threads : benchmarkThreadCounts()) {
+        ThreadPool pool(threads);
+        std::vector<float> heights = plane.heights;
+
+        start = std::chrono::steady_clock::now();
+        const size_t droplets = erodeHeightfield(heights.data(), samplesPerSide, samplesPerSide, samplesPerSide, settings, pool);
+        double ms = elapsedMs(start);
+
+        bool identical = true;
+        if (threads == 1) {
+            baseline = ms;
+            reference = heights;
+        }
+        else {
+            identical = heights == reference;
+        }
+
+        std::cout << "  threads " << std::setw(3) << threads
+            << "  " << std::fixed << std::setprecision(1) << std::setw(8) << ms << " ms"
+            << "  " << std::setprecision(2) << std::setw(6) << droplets / ms / 1000.0 << " Mdroplets/s"
+            << "  speedup " << baseline / ms << "x"
+            << (identical ? "" : "  MISMATCH") << "\n";
+    }
+
+    double change = 0.0;
+    for (size_t i = 0; i < reference.size(); i++) {
+        change += std::abs(reference[i] - plane.heights[i]);
+    }
+    std::cout << "  mean height change " << std::setprecision(4) << change / reference.size() << "\n";
+}
+
+// Bilinear height and raycast queries against a plane's heights, one batch per thread. Every hit
+// is checked against the height at its xz and against a fine ray march.
+void benchmarkQueries(int samplesPerSide, int queriesPerThread)
+{
+    std::cout << std::defaultfloat << "Heightfield queries " << samplesPerSide << "x" << samplesPerSide << "\n";
+
+    Shape plane;
+    plane.buildGrid(samplesPerSide, samplesPerSide, 1.0f, ThreadPool::shared());
+    const int cells = samplesPerSide - 1;
+    auto corners = [&plane, cells](int column, int row, float* h) {
+        column = std::min(std::max(column, 0), cells - 1);
+        row = std::min(std::max(row, 0), cells - 1);
+        const float* heights = plane.heights.data() + (size_t) row * plane.vertsPerRow + column;
+        h[0] = heights[0];
+        h[1] = heights[1];
+        h[2] = heights[plane.vertsPerRow];
+        h[3] = heights[plane.vertsPerRow + 1];
+    };
+
+    // Rays from above the terrain, pointing down at 10 to 60 degrees. They start far enough
+    // from the border to reach the ground inside the plane.
+    auto ray = [cells](int i, float* origin, float* direction) {
+        float angle = i * 2.399963f;
+        float pitch = 0.17f + 0.87f * (float) (i * 7919u % 1000) / 1000.0f;
+        const unsigned int span = (cells - 200) * 100;
+        origin[0] = 100.0f + (float) (i * 104729u % span) / 100.0f;
+        origin[1] = TERRAIN_MAX_HEIGHT + 1.0f;
+        origin[2] = 100.0f + (float) (i * 15485863u % span) / 100.0f;
+        direction[0] = std::cos(angle) * std::cos(pitch);
+        direction[1] = -std::sin(pitch);
+        direction[2] = std::sin(angle) * std::cos(pitch);
+    };
+
+    double baseline = 0.0;
+    for (unsigned int threads : benchmarkThreadCounts()) {
+        ThreadPool pool(threads);
+        std::vector<float> sink(threads);
+
+        auto start = std::chrono::steady_clock::now();
+        pool.parallelFor(0, (int) threads, [&](int begin, int end) {
+            for (int thread = begin; thread < end; thread++) {
+                float sum = 0.0f;
+                for (int i = 0; i < queriesPerThread; i++) {
+                    sum += heightfieldHeight(corners, (i % 997) * cells / 997.0f, (i % 991) * cells / 991.0f);
+                }
+                sink[thread] = sum;
+            }
+        });
+        double heightMs = elapsedMs(start);
+
+        start = std::chrono::steady_clock::now();
+        pool.parallelFor(0, (int) threads, [&](int begin, int end) {
+            for (int thread = begin; thread < end; thread++) {
+                float sum = 0.0f;
+                for (int i = 0; i < queriesPerThread / 10; i++) {
+                    float origin[3];
+                    float direction[3];
+                    ray(i, origin, direction);
+                    sum += heightfieldRaycast(corners, origin, direction, 100.0f, TERRAIN_MIN_HEIGHT, TERRAIN_MAX_HEIGHT);
+                }
+                sink[thread] += sum;
+            }
+        });
+        double rayMs = elapsedMs(start);
+        if (threads == 1) {
+            baseline = rayMs;
+        }
+
+        const double queries = (double) queriesPerThread * threads;
+        std::cout << "  threads " << std::setw(3) << threads
+            << std::fixed << std::setprecision(1)
+            << "  heights " << std::setw(7) << queries / heightMs / 1000.0 << " M/s"
+            << "  rays " << std::setw(7) << queries / 10.0 / rayMs / 1000.0 << " M/s"
+            << "  speedup " << std::setprecision(2) << baseline * threads / rayMs << "x\n";
+    }
+
+    double surfaceError = 0.0;
+    double marchError = 0.0;
+    for (int i = 0; i < 1000; i++) {
+        float origin[3];
+        float direction[3];
+        ray(i, origin, direction);
+        float t = heightfieldRaycast(corners, origin, direction, 100.0f, TERRAIN_MIN_HEIGHT, TERRAIN_MAX_HEIGHT);
+
+        float marched = -1.0f;
+        for (int step = 0; step <= 200000; step++) {
+            float s = step * 0.0005f;
+            if (origin[1] + direction[1] * s <= heightfieldHeight(corners, origin[0] + direction[0] * s, origin[2] + direction[2] * s)) {
+                marched = s;
+                break;
+            }
+        }
+
+        if ((t < 0.0f) != (marched < 0.0f)) {
+            marchError = std::numeric_limits<double>::infinity();
+        }
+        else if (t >= 0.0f) {
+            float y = origin[1] + direction[1] * t;
+            surfaceError = std::max(surfaceError, (double) std::abs(y - heightfieldHeight(corners, origin[0] + direction[0] * t, origin[2] + direction[2] * t)));
+            marchError = std::max(marchError, (double) std::abs(t - marched));
+        }
+    }
+
+    std::cout << "  hit height error " << std::scientific << std::setprecision(2) << surfaceError
+        << ", distance to 0.0005 ray march " << marchError << std::defaultfloat << "\n";
+}
+
+// Every model in a directory imported with Assimp, then read back from the mesh cache the import
+// wrote. The cached read maps, checks and touches every byte, which is what glBufferData would
+// do with it; neither side creates GL objects.
+void benchmarkModelCache(const std::string& directory, const std::string& extension, const std::string& cacheDirectory)
+{
+    const std::vector<std::string> names = listFiles(directory, extension);
+    std::cout << std::defaultfloat << "Mesh cache, " << names.size() << " " << extension << " models in " << directory << "\n";
+    if (names.empty()) {
+        return;
+    }
+    makeDirectory(cacheDirectory);
+
+    Assimp::Importer importer;
+    double importMs = 0.0;
+    double writeMs = 0.0;
+    size_t bytes = 0;
+    size_t failures = 0;
+    for (const std::string& name : names) {
+        const std::string path = directory + '\\' + name;
+        std::vector<MeshData> meshes;
+
+        auto start = std::chrono::steady_clock::now();
+        const bool imported = Model::importMeshes(importer, path, meshes);
+        importMs += elapsedMs(start);
+
+        start = std::chrono::steady_clock::now();
+        failures += !imported || !writeMeshCache(meshCachePath(cacheDirectory, path), meshSourceKey(path, MODEL_IMPORT_FLAGS, MODEL_OPTIMIZE_FLAGS), meshes);
+        writeMs += elapsedMs(start);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    // Keeps the reads from being optimized out
+    volatile unsigned int checksum = 0;
+    for (const std::string& name : names) {
+        const std::string path = directory + '\\' + name;
+        MappedFile file;
+        MeshCacheView view;
+        if (!file.open(meshCachePath(cacheDirectory, path)) || !openMeshCache(file, meshSourceKey(path, MODEL_IMPORT_FLAGS, MODEL_OPTIMIZE_FLAGS), view)) {
+            failures++;
+            continue;
+        }
+        for (size_t i = 0; i < file.size(); i += 64) {
+            checksum += file.data()[i];
+        }
+        bytes += file.size();
+    }
+    double loadMs = elapsedMs(start);
+
+    std::cout << "  import       " << std::fixed << std::setprecision(1) << std::setw(8) << importMs << " ms\n"
+        << "  cache write  " << std::setw(8) << writeMs << " ms\n"
+        << "  cache load   " << std::setw(8) << loadMs << " ms  " << std::setprecision(2) << bytes / 1048576.0 << " MB"
+        << "  speedup " << std::setprecision(1) << importMs / loadMs << "x"
+        << (failures == 0 ? "" : "  FAILED") << "\n";
+}
+
+// Every model in a directory imported on 1, 2, 4, ... workers with ModelLoader, bypassing the mesh
+// cache. Only the reads are timed; nothing is uploaded.
+void benchmarkParallelImport(const std::string& directory, const std::string& extension)
+{
+    const std::vector<std::string> paths = ModelLoader::directoryPaths(directory, extension);
+    std::cout << std::defaultfloat << "Parallel import, " << paths.size() << " " << extension << " models in " << directory << "\n";
+    if (paths.empty()) {
+        return;
+    }
+
+    double baseline = 0.0;
+    for (unsigned int threads : benchmarkThreadCounts()) {
+        ThreadPool pool(threads);
+        ModelLoader loader(pool, "");
+
+        size_t meshes = 0;
+        auto start = std::chrono::steady_clock::now();
+        const size_t failures = loader.readAll(paths, [&meshes](size_t, ModelSource& source) {
+            meshes += source.imported.size();
+        });
+        double ms = elapsedMs(start);
+        if (threads == 1) {
+            baseline = ms;
+        }
+
+        std::cout << "  threads " << std::setw(3) << threads
+            << "  " << std::fixed << std::setprecision(1) << std::setw(8) << ms << " ms"
+            << "  " << std::setw(6) << meshes << " meshes"
+            << "  speedup " << std::setprecision(2) << baseline / ms << "x"
+            << (failures == 0 ? "" : "  FAILED") << "\n";
+    }
+}
+
+// Every model in a directory imported with welding only, then reordered with the rest of the
+// import flags except for the detail levels. Prints the FIFO cache miss rates per model before and after: ACMR is
+// vertices transformed per triangle, ATVR per vertex used.
+void benchmarkMeshOptimization(const std::string& directory, const std::string& extension)
+{
+    const std::vector<std::string> names = listFiles(directory, extension);
+    std::cout << std::defaultfloat << "Mesh optimization, " << names.size() << " " << extension << " models in " << directory
+        << ", " << MESH_VERTEX_CACHE_SIZE << " entry cache\n";
+    if (names.empty()) {
+        return;
+    }
+
+    Assimp::Importer importer;
+    double optimizeMs = 0.0;
+    size_t totalTriangles = 0;
+    double totalBefore[2] = {};
+    double totalAfter[2] = {};
+    size_t failures = 0;
+    for (const std::string& name : names) {
+        std::vector<MeshData> meshes;
+        if (!Model::importMeshes(importer, directory + '\\' + name, meshes, MESH_OPTIMIZE_WELD)) {
+            failures++;
+            continue;
+        }
+
+        // Misses and vertices used, summed over the meshes of the model
+        size_t triangles = 0;
+        double before[2] = {};
+        double after[2] = {};
+        for (MeshData& mesh : meshes) {
+            const size_t meshTriangles = mesh.indices.size() / 3;
+            MeshCacheStats stats = meshCacheStats(mesh.indices, mesh.vertices.size());
+            before[0] += stats.acmr * meshTriangles;
+            before[1] += stats.atvr > 0.0f ? stats.acmr * meshTriangles / stats.atvr : 0.0;
+
+            auto start = std::chrono::steady_clock::now();
+            optimizeMesh(mesh, MODEL_OPTIMIZE_FLAGS & ~(MESH_OPTIMIZE_WELD | MESH_OPTIMIZE_LOD));
+            optimizeMs += elapsedMs(start);
+
+            stats = meshCacheStats(mesh.indices, mesh.vertices.size());
+            after[0] += stats.acmr * meshTriangles;
+            after[1] += stats.atvr > 0.0f ? stats.acmr * meshTriangles / stats.atvr : 0.0;
+            triangles += meshTriangles;
+        }
+        if (triangles == 0) {
+            continue;
+        }
+
+        std::cout << "  " << std::left << std::setw(28) << name << std::right << std::setw(7) << triangles << " tris"
+            << std::fixed << std::setprecision(3)
+            << "  ACMR " << before[0] / triangles << " -> " << after[0] / triangles
+            << "  ATVR " << before[0] / before[1] << " -> " << after[0] / after[1] << std::defaultfloat << "\n";
+        totalTriangles += triangles;
+        for (int i = 0; i < 2; i++) {
+            totalBefore[i] += before[i];
+            totalAfter[i] += after[i];
+        }
+    }
+
+    if (totalTriangles > 0) {
+        std::cout << "  all " << std::setw(31) << totalTriangles << " tris" << std::fixed << std::setprecision(3)
+            << "  ACMR " << totalBefore[0] / totalTriangles << " -> " << totalAfter[0] / totalTriangles
+            << "  ATVR " << totalBefore[0] / totalBefore[1] << " -> " << totalAfter[0] / totalAfter[1]
+            << "  optimize " << std::setprecision(1) << optimizeMs << " ms" << std::defaultfloat;
+    }
+    std::cout << (failures == 0 ? "" : "  FAILED") << "\n";
+}
+
+// Every model in a directory quantized as Model uploads it by default, then decoded again on the
+// CPU the way shader.vert does. Prints the vertex bytes saved and the largest errors: position
+// relative to the longest side of the mesh bounds, normal angle and texture coordinate.
+void benchmarkVertexQuantization(const std::string& directory, const std::string& extension)
+{
+    const std::vector<std::string> names = listFiles(directory, extension);
+    std::cout << std::defaultfloat << "Vertex quantization, " << names.size() << " " << extension << " models in " << directory << "\n";
+    if (names.empty()) {
+        return;
+    }
+
+    Assimp::Importer importer;
+    double quantizeMs = 0.0;
+    size_t vertices = 0;
+    float positionError = 0.0f;
+    float normalError = 0.0f;
+    float texCoordError = 0.0f;
+    size_t failures = 0;
+    std::vector<QuantizedVertex> quantized;
+    for (const std::string& name : names) {
+        std::vector<MeshData> meshes;
+        if (!Model::importMeshes(importer, directory + '\\' + name, meshes)) {
+            failures++;
+            continue;
+        }
+
+        for (const MeshData& mesh : meshes) {
+            glm::vec3 boundsMin;
+            glm::vec3 boundsMax;
+            meshBounds(mesh.vertices, boundsMin, boundsMax);
+            quantized.resize(mesh.vertices.size());
+
+            auto start = std::chrono::steady_clock::now();
+            quantizeVertices(mesh.vertices.data(), mesh.vertices.size(), boundsMin, boundsMax, quantized.data());
+            quantizeMs += elapsedMs(start);
+
+            const glm::vec3 extent = boundsMax - boundsMin;
+            const float longest = std::max(std::max(extent.x, extent.y), std::max(extent.z, 1e-20f));
+            for (size_t i = 0; i < mesh.vertices.size(); i++) {
+                const Vertex& vertex = mesh.vertices[i];
+                const QuantizedVertex& packed = quantized[i];
+
+                const glm::vec3 position = boundsMin + glm::vec3(packed.Position[0], packed.Position[1], packed.Position[2]) / 65535.0f * extent;
+                positionError = std::max(positionError, glm::length(position - vertex.Position) / longest);
+
+                if (glm::length(vertex.Normal) > 0.0f) {
+                    glm::vec3 normal;
+                    octDecodeNormal(packed.Normal, &normal[0]);
+                    const float cosine = glm::dot(normal, glm::normalize(vertex.Normal));
+                    normalError = std::max(normalError, std::acos(std::min(cosine, 1.0f)));
+                }
+
+                const glm::vec2 texCoords(glm::unpackHalf1x16(packed.TexCoords[0]), glm::unpackHalf1x16(packed.TexCoords[1]));
+                texCoordError = std::max(texCoordError, glm::length(texCoords - vertex.TexCoords));
+            }
+            vertices += mesh.vertices.size();
+        }
+    }
+
+    std::cout << "  " << vertices << " vertices  " << std::fixed << std::setprecision(2)
+        << vertices * sizeof(Vertex) / 1048576.0 << " MB -> " << vertices * sizeof(QuantizedVertex) / 1048576.0 << " MB"
+        << "  quantize " << std::setprecision(1) << quantizeMs << " ms" << (failures == 0 ? "" : "  FAILED") << "\n"
+        << "  max error  position " << std::scientific << std::setprecision(2) << positionError
+        << "  normal " << std::fixed << normalError * 57.2957795f << " deg"
+        << "  uv " << std::scientific << texCoordError << std::defaultfloat << "\n";
+}
+
+// Closest point on triangle abc to p, from Ericson's Real-Time Collision Detection, 5.1.5
+inline float pointTriangleDistance(const glm::vec3& p, const glm::vec3& a, const glm::vec3& b, const glm::vec3& c)
+{
+    const glm::vec3 ab = b - a;
+    const glm::vec3 ac = c - a;
+    const glm::vec3 ap = p - a;
+    const float d1 = glm::dot(ab, ap);
+    const float d2 = glm::dot(ac, ap);
+    if (d1 <= 0 && d2 <= 0) {
+        return glm::length(p - a);
+    }
+
+    const glm::vec3 bp = p - b;
+    const float d3 = glm::dot(ab, bp);
+    const float d4 = glm::dot(ac, bp);
+    if (d3 >= 0 && d4 <= d3) {
+        return glm::length(p - b);
+    }
+
+    const float vc = d1 * d4 - d3 * d2;
+    if (vc <= 0 && d1 >= 0 && d3 <= 0) {
+        return glm::length(p - (a + ab * (d1 / (d1 - d3))));
+    }
+
+    const glm::vec3 cp = p - c;
+    const float d5 = glm::dot(ab, cp);
+    const float d6 = glm::dot(ac, cp);
+    if (d6 >= 0 && d5 <= d6) {
+        return glm::length(p - c);
+    }
+
+    const float vb = d5 * d2 - d1 * d6;
+    if (vb <= 0 && d2 >= 0 && d6 <= 0) {
+        return glm::length(p - (a + ac * (d2 / (d2 - d6))));
+    }
+
+    const float va = d3 * d6 - d5 * d4;
+    if (va <= 0 && d4 - d3 >= 0 && d5 - d6 >= 0) {
+        return glm::length(p - (b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)))));
+    }
+
+    const float denominator = 1.0f / (va + vb + vc);
+    return glm::length(p - (a + ab * (vb * denominator) + ac * (vc * denominator)));
+}
+
+// Every model in a directory imported with welding only, then simplified into detail levels.
+// Prints the triangles of every level per model, and the largest distance from a vertex of the
+// full mesh to the surface of each level, relative to the diagonal of the mesh bounds.
+void benchmarkMeshLods(const std::string& directory, const std::string& extension)
+{
+    const std::vector<std::string> names = listFiles(directory, extension);
+    std::cout << std::defaultfloat << "Mesh detail levels, " << names.size() << " " << extension << " models in " << directory << "\n";
+    if (names.empty()) {
+        return;
+    }
+
+    Assimp::Importer importer;
+    double simplifyMs = 0.0;
+    size_t totals[MESH_LOD_LEVELS] = {};
+    size_t failures = 0;
+    for (const std::string& name : names) {
+        std::vector<MeshData> meshes;
+        if (!Model::importMeshes(importer, directory + '\\' + name, meshes, MESH_OPTIMIZE_WELD)) {
+            failures++;
+            continue;
+        }
+
+        size_t triangles[MESH_LOD_LEVELS] = {};
+        float error[MESH_LOD_LEVELS] = {};
+        for (MeshData& mesh : meshes) {
+            auto start = std::chrono::steady_clock::now();
+            buildMeshLods(mesh);
+            simplifyMs += elapsedMs(start);
+
+            glm::vec3 boundsMin;
+            glm::vec3 boundsMax;
+            meshBounds(mesh.vertices, boundsMin, boundsMax);
+            const float diagonal = std::max(glm::length(boundsMax - boundsMin), 1e-20f);
+
+            // Later levels reuse the coarsest one when a mesh stopped early
+            std::vector<unsigned int> counts = mesh.lodIndexCounts;
+            if (counts.empty()) {
+                counts.push_back((unsigned int) mesh.indices.size());
+            }
+            size_t first = 0;
+            for (int level = 0; level < MESH_LOD_LEVELS; level++) {
+                if (level < (int) counts.size()) {
+                    first = level == 0 ? 0 : first + counts[level - 1];
+                }
+                const size_t count = counts[std::min(level, (int) counts.size() - 1)];
+                triangles[level] += count / 3;
+                if (level == 0) {
+                    continue;
+                }
+
+                // Distance from every vertex to the nearest triangle of the level
+                for (const Vertex& vertex : mesh.vertices) {
+                    float nearest = std::numeric_limits<float>::max();
+                    for (size_t i = first; i < first + count; i += 3) {
+                        nearest = std::min(nearest, pointTriangleDistance(vertex.Position,
+                            mesh.vertices[mesh.indices[i]].Position, mesh.vertices[mesh.indices[i + 1]].Position, mesh.vertices[mesh.indices[i + 2]].Position));
+                    }
+                    error[level] = std::max(error[level], nearest / diagonal);
+                }
+            }
+        }
+
+        std::cout << "  " << std::left << std::setw(28) << name << std::right;
+        for (int level = 0; level < MESH_LOD_LEVELS; level++) {
+            std::cout << std::setw(7) << triangles[level];
+            totals[level] += triangles[level];
+        }
+        std::cout << " tris  max error" << std::fixed << std::setprecision(3);
+        for (int level = 1; level < MESH_LOD_LEVELS; level++) {
+            std::cout << " " << error[level];
+        }
+        std::cout << std::defaultfloat << "\n";
+    }
+
+    std::cout << "  all " << std::setw(31) << totals[0];
+    for (int level = 1; level < MESH_LOD_LEVELS; level++) {
+        std::cout << std::setw(7) << totals[level];
+    }
+    std::cout << " tris  simplify " << std::fixed << std::setprecision(1) << simplifyMs << " ms" << std::defaultfloat
+        << (failures == 0 ? "" : "  FAILED") << "\n";
+}
+
+// The models imported as they load, split into meshlets. Prints their size, and for cameras on a
+// ring around each model, the share of triangles the cull pass drops outside the frustum and
+// facing away, and what the pass costs.
+void benchmarkMeshlets(const std::vector<std::string>& paths)
+{
+    std::cout << std::defaultfloat << "Meshlet culling, " << MESH_MESHLET_VERTICES << " vertices / " << MESH_MESHLET_TRIANGLES
+        << " triangles at most\n";
+
+    Assimp::Importer importer;
+    const int views = 64;
+    const glm::mat4 projection = glm::perspective(glm::radians(45.0f), 800.0f / 600.0f, 0.1f, 1000.0f);
+    for (const std::string& path : paths) {
+        std::vector<MeshData> meshes;
+        if (!Model::importMeshes(importer, path, meshes)) {
+            std::cout << "  " << path << " FAILED\n";
+            continue;
+        }
+
+        glm::vec3 boundsMin = meshes.empty() ? glm::vec3(0.0f) : meshes[0].boundsMin;
+        glm::vec3 boundsMax = boundsMin;
+        size_t triangles = 0;
+        size_t meshletCount = 0;
+        size_t meshletVertices = 0;
+        for (const MeshData& mesh : meshes) {
+            boundsMin = glm::min(boundsMin, mesh.boundsMin);
+            boundsMax = glm::max(boundsMax, mesh.boundsMax);
+            std::vector<unsigned int> usedBy(mesh.vertices.size(), 0);
+            for (const Meshlet& meshlet : mesh.meshlets) {
+                triangles += meshlet.indexCount / 3;
+                meshletCount++;
+                for (unsigned int i = meshlet.firstIndex; i < meshlet.firstIndex + meshlet.indexCount; i++) {
+                    meshletVertices += usedBy[mesh.indices[i]] != meshletCount;
+                    usedBy[mesh.indices[i]] = (unsigned int) meshletCount;
+                }
+            }
+        }
+        const glm::vec3 centre = (boundsMin + boundsMax) * 0.5f;
+        const float radius = glm::length(boundsMax - boundsMin) * 0.5f;
+
+        // Half the views from close by, where the frustum cuts the model, half from further out
+        size_t outside = 0;
+        size_t backfacing = 0;
+        double cullMs = 0.0;
+        for (int view = 0; view < views; view++) {
+            const float angle = glm::radians(360.0f * view / views);
+            const float distance = radius * (view % 2 == 0 ? 1.2f : 3.0f);
+            const glm::vec3 camera = centre + distance * glm::vec3(std::cos(angle), 0.3f, std::sin(angle));
+            glm::vec4 planes[6];
+            frustumPlanes(projection * glm::lookAt(camera, centre, glm::vec3(0.0f, 1.0f, 0.0f)), planes);
+
+            auto start = std::chrono::steady_clock::now();
+            for (const MeshData& mesh : meshes) {
+                for (const Meshlet& meshlet : mesh.meshlets) {
+                    if (!meshletVisible(meshlet, camera, planes, false)) {
+                        outside += meshlet.indexCount / 3;
+                    }
+                    else if (!meshletVisible(meshlet, camera, planes, true)) {
+                        backfacing += meshlet.indexCount / 3;
+                    }
+                }
+            }
+            cullMs += elapsedMs(start);
+        }
+
+        const double viewTriangles = std::max((double) triangles * views, 1.0);
+        std::cout << "  " << path << ": " << triangles << " tris in " << meshletCount << " meshlets, "
+            << std::fixed << std::setprecision(1) << (double) meshletVertices / std::max(meshletCount, (size_t) 1) << " vertices and "
+            << (double) triangles / std::max(meshletCount, (size_t) 1) << " tris each\n"
+            << "    culled " << 100.0 * outside / viewTriangles << "% outside the frustum, " << 100.0 * backfacing / viewTriangles
+            << "% facing away, " << std::setprecision(3) << cullMs / views << " ms per pass" << std::defaultfloat << "\n";
+    }
+}
+
+void runBenchmarks()
+{
+    benchmarkNoiseGrid(1001);
+    benchmarkWarpedGrid(1001);
+    benchmarkOctaveLimit(1001, 0.1f);
+    benchmarkSamplers(1000000);
+    benchmarkNormals(1001);
+    benchmarkHorizons(1001);
+    benchmarkQueries(1001, 2000000);
+    benchmarkErosion(1001);
+    benchmarkModelCache("asset\\kenney_nature-kit\\Models\\GLTF format", ".glb", "cache");
+    benchmarkParallelImport("asset\\kenney_nature-kit\\Models\\GLTF format", ".glb");
+    benchmarkParallelImport("asset\\kenney_nature-kit\\Models\\FBX format", ".fbx");
+    benchmarkParallelImport("asset\\kenney_nature-kit\\Models\\DAE format", ".dae");
+    benchmarkParallelImport("asset\\kenney_nature-kit\\Models\\OBJ format", ".obj");
+    benchmarkMeshOptimization("asset\\kenney_nature-kit\\Models\\GLTF format", ".glb");
+    benchmarkVertexQuantization("asset\\kenney_nature-kit\\Models\\GLTF format", ".glb");
+    benchmarkMeshLods("asset\\kenney_nature-kit\\Models\\GLTF format", ".glb");
+    benchmarkMeshlets({ "asset\\backpack\\backpack.obj", "asset\\planet\\planet.obj" });
+
+    benchmarkGeneratePlane(100, 100, 0.1f);
+    benchmarkGeneratePlane(200, 200, 0.1f);
+}
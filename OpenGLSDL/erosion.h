@@ -0,0 +1,197 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "threadpool.h"
+
+// Hydraulic erosion: water droplets run downhill over a heightfield, picking up sediment where
+// they speed up and dropping it where they slow down or fill a pit.
+// The field is split into square tiles and every droplet stays within its tile plus a halo as
+// wide as it can travel. Tiles are run in four colours, a checkerboard of 2x2 tiles, so tiles
+// of one colour are a whole tile apart and run in parallel without touching the same samples.
+// Droplets are seeded per tile and round, which makes the result independent of the thread count.
+
+// The defaults suit the terrain noise at a spacing of 0.1, which is steep per sample
+struct ErosionSettings {
+    // Droplets per heightfield sample, over all rounds; 0 disables erosion
+    float dropletsPerSample = 0.25f;
+    unsigned int seed = 1337;
+    // A droplet moves one sample spacing per step
+    int maxLifetime = 30;
+    // How much of its direction a droplet keeps instead of following the slope
+    float inertia = 0.05f;
+    float sedimentCapacity = 1.0f;
+    float minSedimentCapacity = 0.01f;
+    float erodeSpeed = 0.1f;
+    float depositSpeed = 0.1f;
+    float evaporateSpeed = 0.01f;
+    float gravity = 4.0f;
+    // In samples; widened to more than two halos so tiles of one colour never share one
+    int tileSize = 64;
+    // The droplets are spread over this many passes over every colour, so a tile does not see all
+    // of its neighbours' droplets before or after all of its own
+    int rounds = 4;
+};
+
+// Uniform in [0, 1); std distributions differ between standard libraries
+inline float erosionRandom(std::mt19937& rng)
+{
+    return (rng() >> 8) * (1.0f / 16777216.0f);
+}
+
+// Runs one droplet from (x, y) inside [minX, maxX) x [minY, maxY). It stops when it would leave
+// that rectangle, so only the samples from (minX, minY) to (maxX, maxY) are touched.
+inline void erodeDroplet(float* heights, int pitch, int minX, int minY, int maxX, int maxY, float x, float y,
+    const ErosionSettings& settings)
+{
+    // Rounding can put a start on the far edge
+    if (x < minX || x >= maxX || y < minY || y >= maxY) {
+        return;
+    }
+
+    float directionX = 0.0f;
+    float directionY = 0.0f;
+    float speed = 1.0f;
+    float water = 1.0f;
+    float sediment = 0.0f;
+
+    for (int lifetime = 0; lifetime < settings.maxLifetime; lifetime++) {
+        // Both are at least minX and minY, never negative, so truncating floors
+        const int cellX = (int) x;
+        const int cellY = (int) y;
+        const float u = x - cellX;
+        const float v = y - cellY;
+
+        float* cell = heights + (size_t) cellY * pitch + cellX;
+        const float h00 = cell[0];
+        const float h10 = cell[1];
+        const float h01 = cell[pitch];
+        const float h11 = cell[pitch + 1];
+
+        const float gradientX = (h10 - h00) * (1 - v) + (h11 - h01) * v;
+        const float gradientY = (h01 - h00) * (1 - u) + (h11 - h10) * u;
+        const float height = (h00 * (1 - u) + h10 * u) * (1 - v) + (h01 * (1 - u) + h11 * u) * v;
+
+        directionX = directionX * settings.inertia - gradientX * (1 - settings.inertia);
+        directionY = directionY * settings.inertia - gradientY * (1 - settings.inertia);
+        const float length = std::sqrt(directionX * directionX + directionY * directionY);
+        if (length == 0.0f) {
+            break;
+        }
+        directionX /= length;
+        directionY /= length;
+
+        const float nextX = x + directionX;
+        const float nextY = y + directionY;
+        if (nextX < minX || nextX >= maxX || nextY < minY || nextY >= maxY) {
+            break;
+        }
+
+        const int nextCellX = (int) nextX;
+        const int nextCellY = (int) nextY;
+        const float nextU = nextX - nextCellX;
+        const float nextV = nextY - nextCellY;
+        const float* next = heights + (size_t) nextCellY * pitch + nextCellX;
+        const float nextHeight = (next[0] * (1 - nextU) + next[1] * nextU) * (1 - nextV)
+            + (next[pitch] * (1 - nextU) + next[pitch + 1] * nextU) * nextV;
+        const float deltaHeight = nextHeight - height;
+
+        // Spread over the four corners of the cell the droplet is leaving, weighted as it sits in it
+        const float w00 = (1 - u) * (1 - v);
+        const float w10 = u * (1 - v);
+        const float w01 = (1 - u) * v;
+        const float w11 = u * v;
+
+        const float capacity = std::max(-deltaHeight * speed * water * settings.sedimentCapacity, settings.minSedimentCapacity);
+        if (sediment > capacity || deltaHeight > 0) {
+            // Uphill it fills the pit behind it, at most up to the next height
+            const float deposit = deltaHeight > 0 ? std::min(deltaHeight, sediment) : (sediment - capacity) * settings.depositSpeed;
+            sediment -= deposit;
+            cell[0] += deposit * w00;
+            cell[1] += deposit * w10;
+            cell[pitch] += deposit * w01;
+            cell[pitch + 1] += deposit * w11;
+        }
+        else {
+            // Never digs below the next height
+            const float erode = std::min((capacity - sediment) * settings.erodeSpeed, -deltaHeight);
+            sediment += erode;
+            cell[0] -= erode * w00;
+            cell[1] -= erode * w10;
+            cell[pitch] -= erode * w01;
+            cell[pitch + 1] -= erode * w11;
+        }
+
+        speed = std::sqrt(std::max(speed * speed - deltaHeight * settings.gravity, 0.0f));
+        water *= 1 - settings.evaporateSpeed;
+        x = nextX;
+        y = nextY;
+    }
+}
+
+// Erodes a width x height heightfield whose rows are pitch floats apart, in place.
+// Returns the number of droplets run.
+inline size_t erodeHeightfield(float* heights, int pitch, int width, int height, const ErosionSettings& settings, ThreadPool& pool)
+{
+    if (settings.dropletsPerSample <= 0.0f || settings.maxLifetime <= 0 || width < 2 || height < 2) {
+        return 0;
+    }
+
+    // Droplets start in their tile's cells and move one sample per step, and each step touches
+    // the corners of one cell
+    const int halo = settings.maxLifetime + 1;
+    const int tileSize = std::max(settings.tileSize, 2 * halo + 1);
+    const int cellsX = width - 1;
+    const int cellsY = height - 1;
+    const int tilesX = (cellsX + tileSize - 1) / tileSize;
+    const int tilesY = (cellsY + tileSize - 1) / tileSize;
+    const int rounds = std::max(settings.rounds, 1);
+
+    std::vector<size_t> droplets((size_t) tilesX * tilesY);
+    std::vector<int> tiles;
+    for (int round = 0; round < rounds; round++) {
+        for (int colour = 0; colour < 4; colour++) {
+            tiles.clear();
+            for (int tileY = colour / 2; tileY < tilesY; tileY += 2) {
+                for (int tileX = colour % 2; tileX < tilesX; tileX += 2) {
+                    tiles.push_back(tileY * tilesX + tileX);
+                }
+            }
+
+            pool.parallelFor(0, (int) tiles.size(), [&](int first, int last) {
+                for (int k = first; k < last; k++) {
+                    const int tile = tiles[k];
+                    const int beginX = tile % tilesX * tileSize;
+                    const int beginY = tile / tilesX * tileSize;
+                    const int endX = std::min(beginX + tileSize, cellsX);
+                    const int endY = std::min(beginY + tileSize, cellsY);
+
+                    const int minX = std::max(beginX - halo, 0);
+                    const int minY = std::max(beginY - halo, 0);
+                    const int maxX = std::min(endX + halo, cellsX);
+                    const int maxY = std::min(endY + halo, cellsY);
+
+                    std::seed_seq sequence{ settings.seed, (unsigned int) tile, (unsigned int) round };
+                    std::mt19937 rng(sequence);
+
+                    const int count = (int) std::lround(settings.dropletsPerSample * (endX - beginX) * (endY - beginY) / rounds);
+                    for (int droplet = 0; droplet < count; droplet++) {
+                        const float x = beginX + erosionRandom(rng) * (endX - beginX);
+                        const float y = beginY + erosionRandom(rng) * (endY - beginY);
+                        erodeDroplet(heights, pitch, minX, minY, maxX, maxY, x, y, settings);
+                    }
+                    droplets[tile] += count;
+                }
+            });
+        }
+    }
+
+    size_t total = 0;
+    for (size_t count : droplets) {
+        total += count;
+    }
+    return total;
+}
@@ -0,0 +1,176 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "glad/glad.h"
+#include "SDL3/SDL.h"
+
+#include "shader.h"
+#include "shape.h"
+#include "terrain.h"
+
+// Run with --gpu-parity to check the procedural heights in terrainShader.vert against the CPU
+// noise. The vertex shader runs alone with transform feedback capturing FragPos for every grid
+// vertex of a few tiles, and each height is compared with terrainVertexHeight.
+
+// GPUs may fuse or reorder the float math, and the domain warp amplifies the rounding. Both
+// sides sample from the same noise anchors, so the rounding is that of positions near the origin
+// for every tile, however far out it is.
+constexpr float GPU_PARITY_TOLERANCE = 1e-3f;
+
+// Vertex shader alone, linked to write FragPos to transform feedback; 0 on failure
+inline unsigned int gpuParityProgram(const char* vertexPath)
+{
+    std::ifstream file(vertexPath);
+    if (!file) {
+        std::cout << "GPU parity: cannot read " << vertexPath << std::endl;
+        return 0;
+    }
+    std::stringstream stream;
+    stream << file.rdbuf();
+    const std::string code = stream.str();
+    const char* source = code.c_str();
+
+    int success;
+    char infoLog[512];
+
+    unsigned int vertex = glCreateShader(GL_VERTEX_SHADER);
+    glShaderSource(vertex, 1, &source, NULL);
+    glCompileShader(vertex);
+    glGetShaderiv(vertex, GL_COMPILE_STATUS, &success);
+    if (!success) {
+        glGetShaderInfoLog(vertex, 512, NULL, infoLog);
+        std::cout << "GPU parity: vertex shader failed to compile\n" << infoLog << std::endl;
+        glDeleteShader(vertex);
+        return 0;
+    }
+
+    unsigned int program = glCreateProgram();
+    glAttachShader(program, vertex);
+    const char* varyings[] = { "FragPos" };
+    glTransformFeedbackVaryings(program, 1, varyings, GL_INTERLEAVED_ATTRIBS);
+    glLinkProgram(program);
+    glDeleteShader(vertex);
+
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    if (!success) {
+        glGetProgramInfoLog(program, 512, NULL, infoLog);
+        std::cout << "GPU parity: program failed to link\n" << infoLog << std::endl;
+        glDeleteProgram(program);
+        return 0;
+    }
+    return program;
+}
+
+// Compares one tile, returning the vertices off by more than the tolerance
+inline size_t gpuParityTile(Shader& shader, const Terrain& terrain, const FastNoiseLite::Sampler& sampler,
+    int tileX, int tileZ, unsigned int feedback, float& maxError)
+{
+    const int pitch = TERRAIN_CHUNK_QUADS + 1;
+    const glm::ivec2 origin(tileX * TERRAIN_CHUNK_QUADS, tileZ * TERRAIN_CHUNK_QUADS);
+    shader.setValue("gridOrigin", origin);
+    terrain.setNoiseAnchors(shader, origin.x, origin.y);
+
+    glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, feedback);
+    glBeginTransformFeedback(GL_POINTS);
+    glDrawArrays(GL_POINTS, 0, pitch * pitch);
+    glEndTransformFeedback();
+
+    std::vector<glm::vec3> positions((size_t) pitch * pitch);
+    glGetBufferSubData(GL_TRANSFORM_FEEDBACK_BUFFER, 0, positions.size() * sizeof(glm::vec3), positions.data());
+
+    size_t failures = 0;
+    for (int j = 0; j < pitch; j++) {
+        for (int i = 0; i < pitch; i++) {
+            const float expected = terrainVertexHeight(sampler, origin.x + i, origin.y + j, terrain.resolution);
+            const float error = std::abs(positions[(size_t) j * pitch + i].y - expected);
+            maxError = std::max(maxError, error);
+            failures += !(error <= GPU_PARITY_TOLERANCE);
+        }
+    }
+    return failures;
+}
+
+// True when every height is within tolerance
+inline bool runGpuParity()
+{
+    if (!SDL_Init(SDL_INIT_VIDEO)) {
+        std::cout << "GPU parity: " << SDL_GetError() << std::endl;
+        return false;
+    }
+    SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
+    SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 3);
+    SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 3);
+
+    SDL_Window* window = SDL_CreateWindow("GPU parity", 64, 64, SDL_WINDOW_OPENGL | SDL_WINDOW_HIDDEN);
+    SDL_GLContext context = window ? SDL_GL_CreateContext(window) : nullptr;
+    if (context == nullptr || gladLoadGL() == 0) {
+        std::cout << "GPU parity: no OpenGL 3.3 context" << std::endl;
+        SDL_Quit();
+        return false;
+    }
+
+    bool passed = false;
+    Shader shader;
+    shader.ID = gpuParityProgram("terrainShader.vert");
+    if (shader.ID != 0) {
+        Terrain terrain;
+        const FastNoiseLite noise = terrainNoise(terrain.resolution);
+        const FastNoiseLite::Sampler sampler = noise.GetSampler();
+
+        shader.use();
+        terrain.setNoiseUniforms(shader);
+        shader.setValue("proceduralHeight", true);
+        shader.setValue("skirt", false);
+        shader.setValue("gridPitch", TERRAIN_CHUNK_QUADS + 1);
+        shader.setValue("resolution", terrain.resolution);
+        shader.setValue("normalEncoding", 0);
+        shader.setValue("view", glm::mat4(1.0f));
+        shader.setValue("projection", glm::mat4(1.0f));
+
+        unsigned int VAO, feedback;
+        glGenVertexArrays(1, &VAO);
+        glBindVertexArray(VAO);
+        glGenBuffers(1, &feedback);
+        glBindBuffer(GL_TRANSFORM_FEEDBACK_BUFFER, feedback);
+        glBufferData(GL_TRANSFORM_FEEDBACK_BUFFER, (size_t) (TERRAIN_CHUNK_QUADS + 1) * (TERRAIN_CHUNK_QUADS + 1) * sizeof(glm::vec3), NULL, GL_STATIC_READ);
+        glEnable(GL_RASTERIZER_DISCARD);
+
+        // Around the origin, where negative coordinates floor differently, and far out
+        const int tiles[][2] = { { 0, 0 }, { -1, -1 }, { 3, -2 }, { -40, 25 }, { 1000, 1000 }, { -100000, 77777 } };
+        size_t failures = 0;
+        size_t vertices = 0;
+        float maxError = 0.0f;
+        for (const auto& tile : tiles) {
+            float tileError = 0.0f;
+            const size_t tileFailures = gpuParityTile(shader, terrain, sampler, tile[0], tile[1], feedback, tileError);
+            std::cout << "  tile " << std::setw(7) << tile[0] << ", " << std::setw(7) << tile[1]
+                << "  max error " << std::scientific << std::setprecision(2) << tileError
+                << "  over tolerance " << tileFailures << "\n";
+            failures += tileFailures;
+            vertices += (size_t) (TERRAIN_CHUNK_QUADS + 1) * (TERRAIN_CHUNK_QUADS + 1);
+            maxError = std::max(maxError, tileError);
+        }
+
+        glDisable(GL_RASTERIZER_DISCARD);
+        glDeleteBuffers(1, &feedback);
+        glDeleteVertexArrays(1, &VAO);
+        glDeleteProgram(shader.ID);
+
+        std::cout << "GPU parity " << (failures == 0 ? "passed" : "FAILED") << ": " << vertices << " vertices, max error "
+            << std::scientific << std::setprecision(2) << maxError << std::endl;
+        passed = failures == 0;
+    }
+
+    SDL_GL_DestroyContext(context);
+    SDL_DestroyWindow(window);
+    SDL_Quit();
+    return passed;
+}
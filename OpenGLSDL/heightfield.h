@@ -0,0 +1,375 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define HEIGHTFIELD_SIMD_AVX2
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define HEIGHTFIELD_SIMD_SSE2
+#endif
+
+#include "threadpool.h"
+
+// One row of normal components; the vector loop uses only IEEE exact operations, so it
+// matches the scalar tail bit for bit.
+inline void heightfieldNormalRow(const float* up, const float* row, const float* down, int width, float spacing,
+    float* nx, float* ny, float* nz)
+{
+    int i = 0;
+
+#if defined(HEIGHTFIELD_SIMD_AVX2)
+    const __m256 twoSpacing8 = _mm256_set1_ps(2.0f * spacing);
+    const __m256 ySquared8 = _mm256_mul_ps(twoSpacing8, twoSpacing8);
+    for (; i + 8 <= width; i += 8) {
+        __m256 x = _mm256_sub_ps(_mm256_loadu_ps(row + i - 1), _mm256_loadu_ps(row + i + 1));
+        __m256 z = _mm256_sub_ps(_mm256_loadu_ps(up + i), _mm256_loadu_ps(down + i));
+        __m256 length = _mm256_sqrt_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(x, x), ySquared8), _mm256_mul_ps(z, z)));
+        _mm256_storeu_ps(nx + i, _mm256_div_ps(x, length));
+        _mm256_storeu_ps(ny + i, _mm256_div_ps(twoSpacing8, length));
+        _mm256_storeu_ps(nz + i, _mm256_div_ps(z, length));
+    }
+#elif defined(HEIGHTFIELD_SIMD_SSE2)
+    const __m128 twoSpacing4 = _mm_set1_ps(2.0f * spacing);
+    const __m128 ySquared4 = _mm_mul_ps(twoSpacing4, twoSpacing4);
+    for (; i + 4 <= width; i += 4) {
+        __m128 x = _mm_sub_ps(_mm_loadu_ps(row + i - 1), _mm_loadu_ps(row + i + 1));
+        __m128 z = _mm_sub_ps(_mm_loadu_ps(up + i), _mm_loadu_ps(down + i));
+        __m128 length = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), ySquared4), _mm_mul_ps(z, z)));
+        _mm_storeu_ps(nx + i, _mm_div_ps(x, length));
+        _mm_storeu_ps(ny + i, _mm_div_ps(twoSpacing4, length));
+        _mm_storeu_ps(nz + i, _mm_div_ps(z, length));
+    }
+#endif
+
+    const float twoSpacing = 2.0f * spacing;
+    const float ySquared = twoSpacing * twoSpacing;
+    for (; i < width; i++) {
+        float x = row[i - 1] - row[i + 1];
+        float z = up[i] - down[i];
+        float length = std::sqrt(x * x + ySquared + z * z);
+        nx[i] = x / length;
+        ny[i] = twoSpacing / length;
+        nz[i] = z / length;
+    }
+}
+
+// Smooth normals of a regular heightfield from central differences.
+// heights points at sample (0, 0) of a grid with a one sample apron on every side, so
+// heights[-pitch - 1] through heights[height * pitch + width] are all readable.
+// normals receives width * height tightly packed xyz triples.
+inline void heightfieldNormals(const float* heights, int pitch, int width, int height, float spacing, float* normals, ThreadPool& pool)
+{
+    pool.parallelFor(0, height, [&](int beginRow, int endRow) {
+        std::vector<float> components((size_t) width * 3);
+        float* nx = components.data();
+        float* ny = nx + width;
+        float* nz = ny + width;
+
+        for (int j = beginRow; j < endRow; j++) {
+            const float* row = heights + (size_t) j * pitch;
+            heightfieldNormalRow(row - pitch, row, row + pitch, width, spacing, nx, ny, nz);
+
+            float* out = normals + (size_t) j * width * 3;
+            for (int i = 0; i < width; i++) {
+                out[i * 3] = nx[i];
+                out[i * 3 + 1] = ny[i];
+                out[i * 3 + 2] = nz[i];
+            }
+        }
+    });
+}
+
+// Raises slope[i] to the slope from row[i] up to sample[i], a horizontal distance of
+// 1 / inverseDistance away. Like heightfieldNormalRow it matches the scalar tail bit for bit.
+inline void heightfieldHorizonRow(const float* row, const float* sample, int width, float inverseDistance, float* slope)
+{
+    int i = 0;
+
+#if defined(HEIGHTFIELD_SIMD_AVX2)
+    const __m256 inverseDistance8 = _mm256_set1_ps(inverseDistance);
+    for (; i + 8 <= width; i += 8) {
+        __m256 rise = _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(sample + i), _mm256_loadu_ps(row + i)), inverseDistance8);
+        _mm256_storeu_ps(slope + i, _mm256_max_ps(_mm256_loadu_ps(slope + i), rise));
+    }
+#elif defined(HEIGHTFIELD_SIMD_SSE2)
+    const __m128 inverseDistance4 = _mm_set1_ps(inverseDistance);
+    for (; i + 4 <= width; i += 4) {
+        __m128 rise = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(sample + i), _mm_loadu_ps(row + i)), inverseDistance4);
+        _mm_storeu_ps(slope + i, _mm_max_ps(_mm_loadu_ps(slope + i), rise));
+    }
+#endif
+
+    for (; i < width; i++) {
+        float rise = (sample[i] - row[i]) * inverseDistance;
+        slope[i] = slope[i] > rise ? slope[i] : rise;
+    }
+}
+
+// Samples a horizon march visits along one direction, nearest first
+struct HorizonStep {
+    int offset;
+    float inverseDistance;
+};
+
+// Marches to distance 1, 2, ... radius, or with geometric spacing about sqrt(2) apart, rounded to
+// whole samples; steps that round to the same sample are dropped
+inline std::vector<HorizonStep> heightfieldHorizonSteps(float dx, float dz, int radius, bool geometric, int pitch, float spacing)
+{
+    std::vector<HorizonStep> steps;
+    int lastX = 0;
+    int lastZ = 0;
+    for (int distance = 1; distance <= radius; distance = geometric ? std::max(distance + 1, (int) std::lround(distance * 1.41421356f)) : distance + 1) {
+        int x = (int) std::lround(dx * distance);
+        int z = (int) std::lround(dz * distance);
+        if ((x == lastX && z == lastZ) || (x == 0 && z == 0)) {
+            continue;
+        }
+        lastX = x;
+        lastZ = z;
+        steps.push_back({ z * pitch + x, 1.0f / (std::sqrt((float) (x * x + z * z)) * spacing) });
+    }
+    return steps;
+}
+
+// Baked horizon lighting of a regular heightfield, two bytes per sample:
+// - ambient occlusion, the cosine weighted share of the sky above the horizons in 8 directions,
+//   found with geometric steps up to radius samples away
+// - sun visibility, from the horizon towards the sun, marched one sample at a time, with a
+//   penumbra a few degrees wide
+// 255 is open sky and full sun. sun points towards the sun, x along rows, z down columns.
+// heights points at sample (0, 0) of a grid with a radius sample apron on every side, so heights
+// further away than that are never seen; out receives width * height pairs.
+// Every step compares whole rows, so the marches run on SIMD lanes.
+inline void heightfieldHorizons(const float* heights, int pitch, int width, int height, float spacing, int radius,
+    const float* sun, unsigned char* out, ThreadPool& pool)
+{
+    const int directions = 8;
+    std::vector<HorizonStep> skySteps[directions];
+    for (int d = 0; d < directions; d++) {
+        const float angle = d * (6.28318531f / directions);
+        skySteps[d] = heightfieldHorizonSteps(std::cos(angle), std::sin(angle), radius, true, pitch, spacing);
+    }
+
+    // A sun straight overhead is never blocked
+    const float sunAcross = std::sqrt(sun[0] * sun[0] + sun[2] * sun[2]);
+    const float sunElevation = std::atan2(sun[1], sunAcross);
+    std::vector<HorizonStep> sunSteps;
+    if (sunAcross > 0.0f) {
+        sunSteps = heightfieldHorizonSteps(sun[0] / sunAcross, sun[2] / sunAcross, radius, false, pitch, spacing);
+    }
+    const float penumbra = 0.05f;
+
+    pool.parallelFor(0, height, [&](int beginRow, int endRow) {
+        std::vector<float> buffers((size_t) width * 3);
+        float* slope = buffers.data();
+        float* sky = slope + width;
+        float* sunSlope = sky + width;
+
+        for (int j = beginRow; j < endRow; j++) {
+            const float* row = heights + (size_t) j * pitch;
+
+            // Horizons below the horizontal count as the horizontal, which also hides a sun
+            // below it
+            std::fill(sky, sky + width, 0.0f);
+            for (int d = 0; d < directions; d++) {
+                std::fill(slope, slope + width, 0.0f);
+                for (const HorizonStep& step : skySteps[d]) {
+                    heightfieldHorizonRow(row, row + step.offset, width, step.inverseDistance, slope);
+                }
+                // 1 - sin^2 of the horizon angle
+                for (int i = 0; i < width; i++) {
+                    sky[i] += 1.0f / (1.0f + slope[i] * slope[i]);
+                }
+            }
+
+            std::fill(sunSlope, sunSlope + width, 0.0f);
+            for (const HorizonStep& step : sunSteps) {
+                heightfieldHorizonRow(row, row + step.offset, width, step.inverseDistance, sunSlope);
+            }
+
+            unsigned char* pairs = out + (size_t) j * width * 2;
+            for (int i = 0; i < width; i++) {
+                const float above = sunElevation - std::atan(sunSlope[i]);
+                const float t = std::min(std::max(above / penumbra + 0.5f, 0.0f), 1.0f);
+                const float visible = t * t * (3.0f - 2.0f * t);
+
+                pairs[i * 2] = (unsigned char) (sky[i] / directions * 255.0f + 0.5f);
+                pairs[i * 2 + 1] = (unsigned char) (visible * 255.0f + 0.5f);
+            }
+        }
+    });
+}
+
+// 16-bit height, 0 at minHeight and 65535 at maxHeight
+inline unsigned short quantizeHeight(float height, float minHeight, float maxHeight)
+{
+    float t = (height - minHeight) / (maxHeight - minHeight);
+    t = t < 0.0f ? 0.0f : (t > 1.0f ? 1.0f : t);
+    return (unsigned short) (t * 65535.0f + 0.5f);
+}
+
+// Octahedral encoding of a unit normal into two bytes in [-127, 127]. The octahedron is folded
+// around +y, so the upward facing normals a heightfield mostly has keep the finest steps.
+inline void octEncodeNormal(const float* normal, signed char* out)
+{
+    float l1 = std::abs(normal[0]) + std::abs(normal[1]) + std::abs(normal[2]);
+    float u = normal[0] / l1;
+    float v = normal[2] / l1;
+
+    if (normal[1] < 0.0f) {
+        float foldedU = (1.0f - std::abs(v)) * (u >= 0.0f ? 1.0f : -1.0f);
+        float foldedV = (1.0f - std::abs(u)) * (v >= 0.0f ? 1.0f : -1.0f);
+        u = foldedU;
+        v = foldedV;
+    }
+
+    out[0] = (signed char) std::lround(u * 127.0f);
+    out[1] = (signed char) std::lround(v * 127.0f);
+}
+
+// The unit normal octEncodeNormal encoded, as octDecode in the shaders computes it
+inline void octDecodeNormal(const signed char* encoded, float* normal)
+{
+    float x = encoded[0] / 127.0f;
+    float z = encoded[1] / 127.0f;
+    const float y = 1.0f - std::abs(x) - std::abs(z);
+
+    if (y < 0.0f) {
+        const float foldedX = (1.0f - std::abs(z)) * (x >= 0.0f ? 1.0f : -1.0f);
+        const float foldedZ = (1.0f - std::abs(x)) * (z >= 0.0f ? 1.0f : -1.0f);
+        x = foldedX;
+        z = foldedZ;
+    }
+
+    const float length = std::sqrt(x * x + y * y + z * z);
+    normal[0] = x / length;
+    normal[1] = y / length;
+    normal[2] = z / length;
+}
+
+// Bilinear height inside a cell with corner heights h[0] at (0, 0), h[1] at (1, 0), h[2] at (0, 1)
+// and h[3] at (1, 1)
+inline float bilinearCell(const float* h, float u, float v)
+{
+    return h[0] + (h[1] - h[0]) * u + (h[2] - h[0]) * v + (h[0] - h[1] - h[2] + h[3]) * u * v;
+}
+
+// Height at (x, z) in grid units, where vertex (i, j) sits at (i, j). corners(column, row, h)
+// fills the four heights of cell (column, row) in bilinearCell order.
+template <typename Corners>
+inline float heightfieldHeight(Corners&& corners, float x, float z)
+{
+    const float column = std::floor(x);
+    const float row = std::floor(z);
+    float h[4];
+    corners((int) column, (int) row, h);
+    return bilinearCell(h, x - column, z - row);
+}
+
+// First t >= 0 where origin + t * direction meets the bilinear surface of heightfieldHeight, or
+// a negative value when there is none up to tMax. xz are in grid units, y in height units.
+// Only the part of the ray between minHeight and maxHeight is walked, cell by cell
+// (Amanatides and Woo), and inside a cell the surface along the ray is a quadratic in t.
+template <typename Corners>
+inline float heightfieldRaycast(Corners&& corners, const float* origin, const float* direction, float tMax,
+    float minHeight, float maxHeight)
+{
+    const float infinity = std::numeric_limits<float>::infinity();
+    float t = 0.0f;
+    float tEnd = tMax;
+
+    if (direction[1] != 0.0f) {
+        float t0 = (minHeight - origin[1]) / direction[1];
+        float t1 = (maxHeight - origin[1]) / direction[1];
+        t = std::max(t, std::min(t0, t1));
+        tEnd = std::min(tEnd, std::max(t0, t1));
+    }
+    else if (origin[1] < minHeight || origin[1] > maxHeight) {
+        return -1.0f;
+    }
+    if (t > tEnd) {
+        return -1.0f;
+    }
+
+    const float dx = direction[0];
+    const float dy = direction[1];
+    const float dz = direction[2];
+    const float startX = origin[0] + dx * t;
+    const float startZ = origin[2] + dz * t;
+    int column = (int) std::floor(startX);
+    int row = (int) std::floor(startZ);
+
+    const int stepX = dx > 0.0f ? 1 : -1;
+    const int stepZ = dz > 0.0f ? 1 : -1;
+    const float deltaX = dx != 0.0f ? std::abs(1.0f / dx) : infinity;
+    const float deltaZ = dz != 0.0f ? std::abs(1.0f / dz) : infinity;
+    float nextX = dx != 0.0f ? t + ((dx > 0.0f ? column + 1 : column) - startX) / dx : infinity;
+    float nextZ = dz != 0.0f ? t + ((dz > 0.0f ? row + 1 : row) - startZ) / dz : infinity;
+
+    float h[4];
+    while (true) {
+        const float tExit = std::min(std::min(nextX, nextZ), tEnd);
+        corners(column, row, h);
+
+        const float yEnter = origin[1] + dy * t;
+        const float yExit = origin[1] + dy * tExit;
+        if (std::min(yEnter, yExit) <= std::max(std::max(h[0], h[1]), std::max(h[2], h[3]))) {
+            // Height above the surface as c0 + c1 s + c2 s^2, with s counted from the cell entry
+            const float u = origin[0] + dx * t - column;
+            const float v = origin[2] + dz * t - row;
+            const float a = h[1] - h[0];
+            const float b = h[2] - h[0];
+            const float c = h[0] - h[1] - h[2] + h[3];
+            const float c0 = yEnter - bilinearCell(h, u, v);
+            const float c1 = dy - (a * dx + b * dz + c * (u * dz + v * dx));
+            const float c2 = -c * dx * dz;
+            const float length = tExit - t;
+
+            if (c0 <= 0.0f) {
+                return t;
+            }
+
+            // Both roots without cancellation; c2 == 0 leaves the linear one in first
+            const float discriminant = c1 * c1 - 4.0f * c2 * c0;
+            if (discriminant >= 0.0f) {
+                const float q = -0.5f * (c1 + (c1 >= 0.0f ? std::sqrt(discriminant) : -std::sqrt(discriminant)));
+                const float first = q != 0.0f ? c0 / q : infinity;
+                const float second = c2 != 0.0f ? q / c2 : infinity;
+                float s = infinity;
+                if (first >= 0.0f && first <= length) {
+                    s = first;
+                }
+                if (second >= 0.0f && second <= length) {
+                    s = std::min(s, second);
+                }
+                if (s != infinity) {
+                    return t + s;
+                }
+            }
+
+            // A crossing lost to rounding right at the exit
+            if (c0 + (c1 + c2 * length) * length <= 0.0f) {
+                return tExit;
+            }
+        }
+
+        if (tExit >= tEnd) {
+            return -1.0f;
+        }
+        if (nextX < nextZ) {
+            column += stepX;
+            t = nextX;
+            nextX += deltaX;
+        }
+        else {
+            row += stepZ;
+            t = nextZ;
+            nextZ += deltaZ;
+        }
+    }
+}
@@ -0,0 +1,239 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#include <direct.h>
+#include <sys/stat.h>
+#else
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Read-only memory mapping of a whole file
+class MappedFile {
+public:
+    MappedFile() {}
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // False if the file is missing, empty or cannot be mapped
+    bool open(const std::string& path);
+    void close();
+
+    const unsigned char* data() const;
+    size_t size() const;
+
+private:
+    const unsigned char* view = nullptr;
+    size_t length = 0;
+#ifdef _WIN32
+    HANDLE file = INVALID_HANDLE_VALUE;
+    HANDLE mapping = nullptr;
+#else
+    int file = -1;
+#endif
+};
+
+inline MappedFile::~MappedFile()
+{
+    close();
+}
+
+inline bool MappedFile::open(const std::string& path)
+{
+    close();
+
+#ifdef _WIN32
+    file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+        close();
+        return false;
+    }
+    length = (size_t) fileSize.QuadPart;
+
+    mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapping == nullptr) {
+        close();
+        return false;
+    }
+
+    view = static_cast<const unsigned char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+#else
+    file = ::open(path.c_str(), O_RDONLY);
+    if (file < 0) {
+        return false;
+    }
+
+    struct stat status;
+    if (fstat(file, &status) != 0 || status.st_size == 0) {
+        close();
+        return false;
+    }
+    length = (size_t) status.st_size;
+
+    void* mapped = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, file, 0);
+    view = mapped == MAP_FAILED ? nullptr : static_cast<const unsigned char*>(mapped);
+#endif
+
+    if (view == nullptr) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+inline void MappedFile::close()
+{
+#ifdef _WIN32
+    if (view != nullptr) {
+        UnmapViewOfFile(view);
+    }
+    if (mapping != nullptr) {
+        CloseHandle(mapping);
+    }
+    if (file != INVALID_HANDLE_VALUE) {
+        CloseHandle(file);
+    }
+    mapping = nullptr;
+    file = INVALID_HANDLE_VALUE;
+#else
+    if (view != nullptr) {
+        munmap(const_cast<unsigned char*>(view), length);
+    }
+    if (file >= 0) {
+        ::close(file);
+    }
+    file = -1;
+#endif
+    view = nullptr;
+    length = 0;
+}
+
+inline const unsigned char* MappedFile::data() const
+{
+    return view;
+}
+
+inline size_t MappedFile::size() const
+{
+    return length;
+}
+
+// Creates one directory level; true if it exists afterwards
+inline bool makeDirectory(const std::string& path)
+{
+#ifdef _WIN32
+    if (_mkdir(path.c_str()) == 0) {
+        return true;
+    }
+    DWORD attributes = GetFileAttributesA(path.c_str());
+    return attributes != INVALID_FILE_ATTRIBUTES && (attributes & FILE_ATTRIBUTE_DIRECTORY);
+#else
+    if (mkdir(path.c_str(), 0755) == 0) {
+        return true;
+    }
+    struct stat status;
+    return stat(path.c_str(), &status) == 0 && S_ISDIR(status.st_mode);
+#endif
+}
+
+// Size and last modification time of a file, enough to notice it was replaced; false if it is missing
+inline bool fileStamp(const std::string& path, unsigned long long& size, long long& modified)
+{
+#ifdef _WIN32
+    struct _stat64 status;
+    if (_stat64(path.c_str(), &status) != 0) {
+        return false;
+    }
+#else
+    struct stat status;
+    if (stat(path.c_str(), &status) != 0) {
+        return false;
+    }
+#endif
+    size = (unsigned long long) status.st_size;
+    modified = (long long) status.st_mtime;
+    return true;
+}
+
+// Names of the files in a directory ending with extension, sorted
+inline std::vector<std::string> listFiles(const std::string& directory, const std::string& extension)
+{
+    std::vector<std::string> names;
+    auto add = [&](const std::string& name) {
+        if (name.size() > extension.size() && name.compare(name.size() - extension.size(), extension.size(), extension) == 0) {
+            names.push_back(name);
+        }
+    };
+
+#ifdef _WIN32
+    WIN32_FIND_DATAA found;
+    HANDLE search = FindFirstFileA((directory + "\\*").c_str(), &found);
+    if (search != INVALID_HANDLE_VALUE) {
+        do {
+            if (!(found.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)) {
+                add(found.cFileName);
+            }
+        } while (FindNextFileA(search, &found));
+        FindClose(search);
+    }
+#else
+    if (DIR* listing = opendir(directory.c_str())) {
+        while (dirent* entry = readdir(listing)) {
+            add(entry->d_name);
+        }
+        closedir(listing);
+    }
+#endif
+
+    std::sort(names.begin(), names.end());
+    return names;
+}
+
+// Writes to a temporary file first and renames it into place, so a reader never maps a half written file
+inline bool writeFileAtomic(const std::string& path, const void* data, size_t size)
+{
+    const std::string temporary = path + ".tmp";
+    {
+        std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+        out.write(static_cast<const char*>(data), (std::streamsize) size);
+        if (!out) {
+            out.close();
+            std::remove(temporary.c_str());
+            return false;
+        }
+    }
+
+#ifdef _WIN32
+    // rename() does not replace existing files on Windows
+    if (!MoveFileExA(temporary.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING)) {
+#else
+    if (std::rename(temporary.c_str(), path.c_str()) != 0) {
+#endif
+        std::remove(temporary.c_str());
+        return false;
+    }
+    return true;
+}
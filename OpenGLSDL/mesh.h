@@ -2,12 +2,16 @@
 
 #include <glad/glad.h>
 #include <glm/glm.hpp>
+#include <glm/gtc/packing.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
+#include <algorithm>
+#include <cmath>
 #include <string>
 #include <vector>
 
 #include <assimp/scene.h>
+#include "heightfield.h"
 #include "shader.h"
 
 struct Vertex {
@@ -16,6 +20,43 @@ struct Vertex {
 	glm::vec2 TexCoords;
 };
 
+// Vertex layouts a Mesh can upload. Quantized vertices are decoded in shader.vert and
+// instanceShader.vert with the uniforms Mesh::prepareMaterial sets.
+enum MeshVertexFormat {
+	MESH_VERTEX_FLOAT,      // Vertex: 32 bytes
+	MESH_VERTEX_QUANTIZED   // QuantizedVertex: 12 bytes
+};
+
+// 16-bit position within the mesh bounds, oct-encoded 2 x 8-bit normal, half float texture coordinates
+struct QuantizedVertex {
+	unsigned short Position[3];
+	signed char Normal[2];
+	unsigned short TexCoords[2];
+};
+static_assert(sizeof(QuantizedVertex) == 12, "QuantizedVertex must stay tightly packed");
+
+// Packs vertices whose positions lie within [boundsMin, boundsMax]
+void quantizeVertices(const Vertex* vertices, size_t count, glm::vec3 boundsMin, glm::vec3 boundsMax, QuantizedVertex* out);
+
+// A run of triangles of detail level 0 over few vertices, with the bounds that let the CPU skip it
+struct Meshlet {
+	unsigned int firstIndex;
+	unsigned int indexCount;
+	glm::vec3 centre;
+	float radius;
+	// Every triangle faces away from the axis by less than a right angle minus asin(coneCutoff);
+	// a cutoff of 1 or more means the normals spread too far to ever cull the meshlet
+	glm::vec3 coneAxis;
+	float coneCutoff;
+};
+
+// The planes of the frustum of a projection * view (* model) matrix, pointing inwards and
+// normalized (Gribb and Hartmann), in the space the matrix maps from
+void frustumPlanes(const glm::mat4& matrix, glm::vec4 planes[6]);
+// False when the meshlet lies outside the frustum, or when every triangle in it faces away from
+// the camera and cones is set; everything in the space of the meshlet
+bool meshletVisible(const Meshlet& meshlet, glm::vec3 cameraPosition, const glm::vec4 planes[6], bool cones);
+
 struct Texture {
 	unsigned int id{};
 	std::string type;
@@ -30,22 +71,57 @@ struct Color {
 
 class Mesh {
 public:
-	// Mesh data
+	// Mesh data; vertices and indices stay empty for meshes uploaded straight from the mesh cache
 	std::vector<Vertex> vertices;
 	std::vector<unsigned int> indices;
 	std::vector<Texture> textures;
 	Color color;
+	// Every detail level together
+	GLsizei indexCount = 0;
+	// Index range of every detail level in the index buffer, finest first; a single level
+	// covering every index unless setLods splits them
+	std::vector<GLsizei> lodFirstIndex;
+	std::vector<GLsizei> lodIndexCount;
+	// Split of detail level 0 for cullMeshlets, in index order; empty unless setMeshlets was called
+	std::vector<Meshlet> meshlets;
+	// GL_UNSIGNED_SHORT whenever every index fits in 16 bits
+	GLenum indexType = GL_UNSIGNED_INT;
+	// Bytes in the vertex and index buffers
+	size_t bufferBytes = 0;
+	// Of the uploaded vertices; quantized meshes are decoded against them
+	glm::vec3 boundsMin = glm::vec3(0.0f);
+	glm::vec3 boundsMax = glm::vec3(0.0f);
+	MeshVertexFormat vertexFormat = MESH_VERTEX_FLOAT;
 
 	Mesh(std::vector<Vertex> vertices, std::vector<unsigned int> indices, std::vector<Texture> textures);
 	Mesh(std::vector<Vertex> vertices, std::vector<unsigned int> indices, std::vector<Texture> textures, Color);
+	// Uploads the vertices and indices without keeping a copy, quantized if format asks for it
+	Mesh(const Vertex* vertices, size_t vertexCount, const unsigned int* indices, size_t indexCount, std::vector<Texture> textures, Color,
+		MeshVertexFormat format = MESH_VERTEX_FLOAT);
+	// Splits the indices into levels of the given counts, stored back to back; no levels keeps one
+	void setLods(const unsigned int* indexCounts, size_t levels);
+	void setMeshlets(const Meshlet* meshlets, size_t count);
+	// Keeps the meshlets inside the frustum planes, and with cones set the ones not facing away
+	// from the camera, for drawMeshlets; returns how many it kept
+	size_t cullMeshlets(glm::vec3 cameraPosition, const glm::vec4 planes[6], bool cones);
 	void prepareMaterial(Shader& shader);
 	void Draw(Shader& shader);
 	void Draw(Shader& shader, int);
+	// Draws one detail level with the prepared material, or the coarsest the mesh has; instanced
+	// unless instances is 0
+	void drawLod(int lod, int instances);
+	// Draws detail level 0 with the prepared material in one glMultiDrawElements, only the
+	// meshlets the last cullMeshlets kept; all of level 0 for a mesh without meshlets
+	void drawMeshlets();
 	glm::vec3 getColor();
 	unsigned int VAO, VBO, EBO;
 private:
+	// Index ranges drawMeshlets draws, neighbouring meshlets merged
+	std::vector<GLsizei> visibleCounts;
+	std::vector<const void*> visibleOffsets;
+
 	// Render data
-	void setupMesh();
+	void setupMesh(const Vertex* vertices, size_t vertexCount, const unsigned int* indices, size_t indexCount);
 };
 
 Mesh::Mesh(std::vector<Vertex> vertices, std::vector<unsigned int> indices, std::vector<Texture> textures)
@@ -54,7 +130,7 @@ Mesh::Mesh(std::vector<Vertex> vertices, std::vector<unsigned int> indices, std:
 	this->indices = indices;
 	this->textures = textures;
 
-	setupMesh();
+	setupMesh(this->vertices.data(), this->vertices.size(), this->indices.data(), this->indices.size());
 }
 
 Mesh::Mesh(std::vector<Vertex> vertices, std::vector<unsigned int> indices, std::vector<Texture> textures, Color color)
@@ -64,11 +140,24 @@ Mesh::Mesh(std::vector<Vertex> vertices, std::vector<unsigned int> indices, std:
 	this->textures = textures;
 	this->color = color;
 
-	setupMesh();
+	setupMesh(this->vertices.data(), this->vertices.size(), this->indices.data(), this->indices.size());
+}
+
+Mesh::Mesh(const Vertex* vertices, size_t vertexCount, const unsigned int* indices, size_t indexCount, std::vector<Texture> textures, Color color,
+	MeshVertexFormat format)
+{
+	this->textures = textures;
+	this->color = color;
+	this->vertexFormat = format;
+
+	setupMesh(vertices, vertexCount, indices, indexCount);
 }
 
-void Mesh::setupMesh()
+void Mesh::setupMesh(const Vertex* vertices, size_t vertexCount, const unsigned int* indices, size_t indexCount)
 {
+	this->indexCount = (GLsizei)indexCount;
+	setLods(nullptr, 0);
+
 	glGenVertexArrays(1, &VAO);
 	glGenBuffers(1, &VBO);
 	glGenBuffers(1, &EBO);
@@ -76,24 +165,156 @@ void Mesh::setupMesh()
 	glBindVertexArray(VAO);
 	glBindBuffer(GL_ARRAY_BUFFER, VBO);
 
-	glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW);
+	boundsMin = boundsMax = vertexCount > 0 ? vertices[0].Position : glm::vec3(0.0f);
+	for (size_t i = 0; i < vertexCount; i++) {
+		boundsMin = glm::min(boundsMin, vertices[i].Position);
+		boundsMax = glm::max(boundsMax, vertices[i].Position);
+	}
+
+	if (vertexFormat == MESH_VERTEX_QUANTIZED) {
+		std::vector<QuantizedVertex> quantized(vertexCount);
+		quantizeVertices(vertices, vertexCount, boundsMin, boundsMax, quantized.data());
+		glBufferData(GL_ARRAY_BUFFER, vertexCount * sizeof(QuantizedVertex), quantized.data(), GL_STATIC_DRAW);
+	}
+	else {
+		glBufferData(GL_ARRAY_BUFFER, vertexCount * sizeof(Vertex), vertices, GL_STATIC_DRAW);
+	}
+
+	const size_t vertexSize = vertexFormat == MESH_VERTEX_QUANTIZED ? sizeof(QuantizedVertex) : sizeof(Vertex);
 
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
+	if (vertexCount <= 65536) {
+		std::vector<unsigned short> shortIndices(indices, indices + indexCount);
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexCount * sizeof(unsigned short), shortIndices.data(), GL_STATIC_DRAW);
+		indexType = GL_UNSIGNED_SHORT;
+		bufferBytes = vertexCount * vertexSize + indexCount * sizeof(unsigned short);
+	}
+	else {
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexCount * sizeof(unsigned int), indices, GL_STATIC_DRAW);
+		indexType = GL_UNSIGNED_INT;
+		bufferBytes = vertexCount * vertexSize + indexCount * sizeof(unsigned int);
+	}
 
-	// Vertex positions
 	glEnableVertexAttribArray(0);
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
-
 	glEnableVertexAttribArray(1);
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Normal));
-
 	glEnableVertexAttribArray(2);
-	glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, TexCoords));
+
+	if (vertexFormat == MESH_VERTEX_QUANTIZED) {
+		// The normal bytes are read unnormalized, GL 3.3 would map them asymmetrically
+		glVertexAttribPointer(0, 3, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(QuantizedVertex), (void*)0);
+		glVertexAttribPointer(1, 2, GL_BYTE, GL_FALSE, sizeof(QuantizedVertex), (void*)offsetof(QuantizedVertex, Normal));
+		glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, sizeof(QuantizedVertex), (void*)offsetof(QuantizedVertex, TexCoords));
+	}
+	else {
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
+		glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Normal));
+		glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, TexCoords));
+	}
 
 	glBindVertexArray(0);
 }
 
+void quantizeVertices(const Vertex* vertices, size_t count, glm::vec3 boundsMin, glm::vec3 boundsMax, QuantizedVertex* out)
+{
+	const glm::vec3 extent = boundsMax - boundsMin;
+	for (size_t i = 0; i < count; i++) {
+		const Vertex& vertex = vertices[i];
+
+		for (int axis = 0; axis < 3; axis++) {
+			float t = extent[axis] > 0.0f ? (vertex.Position[axis] - boundsMin[axis]) / extent[axis] : 0.0f;
+			t = t < 0.0f ? 0.0f : (t > 1.0f ? 1.0f : t);
+			out[i].Position[axis] = (unsigned short)(t * 65535.0f + 0.5f);
+		}
+
+		// Some exporters leave degenerate normals, which have no octahedral encoding
+		const float l1 = std::abs(vertex.Normal.x) + std::abs(vertex.Normal.y) + std::abs(vertex.Normal.z);
+		const glm::vec3 normal = l1 > 0.0f ? vertex.Normal : glm::vec3(0.0f, 1.0f, 0.0f);
+		octEncodeNormal(glm::value_ptr(normal), out[i].Normal);
+
+		out[i].TexCoords[0] = glm::packHalf1x16(vertex.TexCoords.x);
+		out[i].TexCoords[1] = glm::packHalf1x16(vertex.TexCoords.y);
+	}
+}
+
+void Mesh::setLods(const unsigned int* indexCounts, size_t levels)
+{
+	lodFirstIndex.assign(1, 0);
+	lodIndexCount.assign(1, indexCount);
+	if (levels == 0) {
+		return;
+	}
+
+	lodIndexCount[0] = (GLsizei)indexCounts[0];
+	for (size_t level = 1; level < levels; level++) {
+		lodFirstIndex.push_back(lodFirstIndex.back() + lodIndexCount.back());
+		lodIndexCount.push_back((GLsizei)indexCounts[level]);
+	}
+}
+
+void Mesh::setMeshlets(const Meshlet* meshlets, size_t count)
+{
+	this->meshlets.assign(meshlets, meshlets + count);
+	cullMeshlets(glm::vec3(0.0f), nullptr, false);
+}
+
+size_t Mesh::cullMeshlets(glm::vec3 cameraPosition, const glm::vec4 planes[6], bool cones)
+{
+	const size_t indexSize = indexType == GL_UNSIGNED_SHORT ? sizeof(unsigned short) : sizeof(unsigned int);
+	visibleCounts.clear();
+	visibleOffsets.clear();
+
+	size_t kept = 0;
+	size_t end = 0;
+	for (const Meshlet& meshlet : meshlets) {
+		if (planes != nullptr && !meshletVisible(meshlet, cameraPosition, planes, cones)) {
+			continue;
+		}
+		kept++;
+		if (!visibleCounts.empty() && end == meshlet.firstIndex) {
+			visibleCounts.back() += (GLsizei)meshlet.indexCount;
+		}
+		else {
+			visibleCounts.push_back((GLsizei)meshlet.indexCount);
+			visibleOffsets.push_back((const void*)(meshlet.firstIndex * indexSize));
+		}
+		end = meshlet.firstIndex + meshlet.indexCount;
+	}
+	return kept;
+}
+
+void frustumPlanes(const glm::mat4& matrix, glm::vec4 planes[6])
+{
+	const glm::vec4 row0(matrix[0][0], matrix[1][0], matrix[2][0], matrix[3][0]);
+	const glm::vec4 row1(matrix[0][1], matrix[1][1], matrix[2][1], matrix[3][1]);
+	const glm::vec4 row2(matrix[0][2], matrix[1][2], matrix[2][2], matrix[3][2]);
+	const glm::vec4 row3(matrix[0][3], matrix[1][3], matrix[2][3], matrix[3][3]);
+	planes[0] = row3 + row0;
+	planes[1] = row3 - row0;
+	planes[2] = row3 + row1;
+	planes[3] = row3 - row1;
+	planes[4] = row3 + row2;
+	planes[5] = row3 - row2;
+	for (int i = 0; i < 6; i++) {
+		planes[i] /= glm::length(glm::vec3(planes[i]));
+	}
+}
+
+bool meshletVisible(const Meshlet& meshlet, glm::vec3 cameraPosition, const glm::vec4 planes[6], bool cones)
+{
+	for (int i = 0; i < 6; i++) {
+		if (glm::dot(glm::vec3(planes[i]), meshlet.centre) + planes[i].w < -meshlet.radius) {
+			return false;
+		}
+	}
+	if (!cones || meshlet.coneCutoff >= 1.0f) {
+		return true;
+	}
+
+	// Every point of the bounding sphere has to see the whole cone from behind
+	const glm::vec3 toCentre = meshlet.centre - cameraPosition;
+	return glm::dot(toCentre, meshlet.coneAxis) < meshlet.coneCutoff * glm::length(toCentre) + meshlet.radius * (1.0f + meshlet.coneCutoff);
+}
+
 inline glm::vec3 Mesh::getColor()
 {
 	return { this->color.color.r, this->color.color.g, this->color.color.b };
@@ -122,6 +343,12 @@ void Mesh::prepareMaterial(Shader& shader)
 	}
 	glActiveTexture(GL_TEXTURE0);
 
+	// Float vertices pass through the decode unchanged
+	const bool quantized = vertexFormat == MESH_VERTEX_QUANTIZED;
+	shader.setValue("positionOffset", quantized ? boundsMin : glm::vec3(0.0f));
+	shader.setValue("positionScale", quantized ? boundsMax - boundsMin : glm::vec3(1.0f));
+	shader.setValue("octNormals", quantized);
+
 	if (!color.type.empty()) {
 		std::string name = color.type; // TODO: Generalize this
 		glm::vec3 color = getColor();
@@ -133,19 +360,42 @@ void Mesh::prepareMaterial(Shader& shader)
 void Mesh::Draw(Shader& shader)
 {
 	prepareMaterial(shader);
+	drawLod(0, 0);
+}
+
+void Mesh::Draw(Shader& shader, int instanceNo)
+{
+	prepareMaterial(shader);
+	drawLod(0, instanceNo);
+}
+
+void Mesh::drawLod(int lod, int instances)
+{
+	lod = std::min(lod, (int)lodIndexCount.size() - 1);
+	const size_t indexSize = indexType == GL_UNSIGNED_SHORT ? sizeof(unsigned short) : sizeof(unsigned int);
+	const void* offset = (const void*)(lodFirstIndex[lod] * indexSize);
 
-	// Draw mesh
 	glBindVertexArray(VAO);
-	glDrawElements(GL_TRIANGLES, (GLsizei)indices.size(), GL_UNSIGNED_INT, 0);
+	if (instances > 0) {
+		glDrawElementsInstanced(GL_TRIANGLES, lodIndexCount[lod], indexType, offset, instances);
+	}
+	else {
+		glDrawElements(GL_TRIANGLES, lodIndexCount[lod], indexType, offset);
+	}
 	glBindVertexArray(0);
 }
 
-void Mesh::Draw(Shader& shader, int instanceNo)
+void Mesh::drawMeshlets()
 {
-	prepareMaterial(shader);
+	if (meshlets.empty()) {
+		drawLod(0, 0);
+		return;
+	}
+	if (visibleCounts.empty()) {
+		return;
+	}
 
-	// Draw mesh
 	glBindVertexArray(VAO);
-	glDrawElementsInstanced(GL_TRIANGLES, (GLsizei)indices.size(), GL_UNSIGNED_INT, 0, instanceNo);
+	glMultiDrawElements(GL_TRIANGLES, visibleCounts.data(), indexType, visibleOffsets.data(), (GLsizei)visibleCounts.size());
 	glBindVertexArray(0);
 }
\ No newline at end of file
@@ -0,0 +1,326 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "mappedfile.h"
+#include "mesh.h"
+
+// Imported models are written to cacheDirectory as one binary file each, which later runs map and
+// hand straight to glBufferData, so a warm start never runs Assimp. A file holds:
+// - MeshCacheHeader
+// - one MeshCacheMesh per mesh, then one MeshCacheTexture per texture reference
+// - the vertices of every mesh, then their indices, every detail level of a mesh back to back
+// - the meshlets of every mesh
+// - the texture paths and type names, referenced by offset and length
+// The header's source key covers the model file and its material library, so replacing either
+// imports the model again.
+
+// Bump whenever MeshData, the import or the file layout changes
+constexpr unsigned int MESH_CACHE_VERSION = 5;
+constexpr unsigned int MESH_CACHE_MAGIC = 0x4853454d; // "MESH"
+// Detail levels a mesh can have, the full mesh included
+constexpr int MESH_LOD_LEVELS = 4;
+
+struct MeshTextureRef {
+    std::string type;
+    std::string path;
+};
+
+// One imported mesh, before it has any GL objects
+struct MeshData {
+    std::vector<Vertex> vertices;
+    std::vector<unsigned int> indices;
+    std::vector<MeshTextureRef> textures;
+    Color color;
+    glm::vec3 boundsMin = glm::vec3(0.0f);
+    glm::vec3 boundsMax = glm::vec3(0.0f);
+    // Vertices Assimp returned, before welding
+    unsigned int importedVertexCount = 0;
+    // Index counts of the detail levels stored back to back in indices, finest first; empty
+    // when indices is a single level
+    std::vector<unsigned int> lodIndexCounts;
+    // Split of detail level 0, empty unless optimizeMesh builds meshlets
+    std::vector<Meshlet> meshlets;
+};
+
+struct MeshCacheHeader {
+    unsigned int magic;
+    unsigned int version;
+    unsigned long long sourceKey;
+    unsigned int meshCount;
+    unsigned int textureCount;
+    unsigned int vertexCount;
+    unsigned int indexCount;
+    unsigned int stringBytes;
+    unsigned int meshletCount;
+};
+
+struct MeshCacheString {
+    unsigned int offset;
+    unsigned int length;
+};
+
+struct MeshCacheMesh {
+    unsigned int firstVertex;
+    unsigned int vertexCount;
+    unsigned int firstIndex;
+    unsigned int indexCount;
+    unsigned int firstTexture;
+    unsigned int textureCount;
+    // An empty type means the material has no colour
+    MeshCacheString colorType;
+    unsigned int colorId;
+    float color[3];
+    float boundsMin[3];
+    float boundsMax[3];
+    unsigned int importedVertexCount;
+    // 0 for a single level
+    unsigned int lodCount;
+    unsigned int lodIndexCount[MESH_LOD_LEVELS];
+    unsigned int firstMeshlet;
+    unsigned int meshletCount;
+};
+
+struct MeshCacheTexture {
+    MeshCacheString type;
+    MeshCacheString path;
+};
+
+// Pointers into a mapped cache file, valid while the file stays open
+struct MeshCacheView {
+    const MeshCacheHeader* header = nullptr;
+    const MeshCacheMesh* meshes = nullptr;
+    const MeshCacheTexture* textures = nullptr;
+    const Vertex* vertices = nullptr;
+    const unsigned int* indices = nullptr;
+    const Meshlet* meshlets = nullptr;
+    const char* strings = nullptr;
+
+    std::string string(MeshCacheString reference) const
+    {
+        return std::string(strings + reference.offset, reference.length);
+    }
+};
+
+// Pixels decoded off the GL thread, waiting for glTexImage2D; no pixels if decoding failed
+struct TextureImage {
+    std::string path;
+    int width = 0;
+    int height = 0;
+    int channels = 0;
+    std::vector<unsigned char> pixels;
+};
+
+// A model read on some thread and waiting for its GL objects: the meshes of a fresh import, or a
+// mapped cache file, and optionally its decoded textures
+struct ModelSource {
+    std::string path;
+    std::vector<MeshData> imported;
+    std::unique_ptr<MappedFile> cacheFile;
+    MeshCacheView cached;
+    std::vector<TextureImage> images;
+};
+
+// Axis aligned bounds of the vertices, zero when there are none
+inline void meshBounds(const std::vector<Vertex>& vertices, glm::vec3& boundsMin, glm::vec3& boundsMax)
+{
+    boundsMin = boundsMax = vertices.empty() ? glm::vec3(0.0f) : vertices[0].Position;
+    for (const Vertex& vertex : vertices) {
+        boundsMin = glm::min(boundsMin, vertex.Position);
+        boundsMax = glm::max(boundsMax, vertex.Position);
+    }
+}
+
+// FNV-1a over the cache version, the import and optimization settings and the stamps of the
+// source files. A material library next to the model with the same name (tree.obj, tree.mtl) is
+// stamped too.
+inline unsigned long long meshSourceKey(const std::string& path, unsigned int importFlags, unsigned int optimizeFlags)
+{
+    unsigned long long hash = 14695981039346656037ull;
+    auto mix = [&hash](const void* data, size_t size) {
+        const unsigned char* bytes = static_cast<const unsigned char*>(data);
+        for (size_t i = 0; i < size; i++) {
+            hash = (hash ^ bytes[i]) * 1099511628211ull;
+        }
+    };
+
+    const unsigned int settings[] = { MESH_CACHE_VERSION, importFlags, optimizeFlags, (unsigned int) sizeof(Vertex) };
+    mix(settings, sizeof(settings));
+    mix(path.data(), path.size());
+
+    const std::string material = path.substr(0, path.find_last_of('.')) + ".mtl";
+    for (const std::string& source : { path, material }) {
+        unsigned long long size = 0;
+        long long modified = 0;
+        fileStamp(source, size, modified);
+        mix(&size, sizeof(size));
+        mix(&modified, sizeof(modified));
+    }
+    return hash;
+}
+
+// One file per model path, so a changed model overwrites its stale entry
+inline std::string meshCachePath(const std::string& cacheDirectory, const std::string& path)
+{
+    unsigned long long hash = 14695981039346656037ull;
+    for (char c : path) {
+        hash = (hash ^ (unsigned char) c) * 1099511628211ull;
+    }
+
+    char name[40];
+    std::snprintf(name, sizeof(name), "/model_%016llx.bin", hash);
+    return cacheDirectory + name;
+}
+
+inline bool writeMeshCache(const std::string& path, unsigned long long sourceKey, const std::vector<MeshData>& meshes)
+{
+    std::vector<MeshCacheMesh> records;
+    std::vector<MeshCacheTexture> textures;
+    std::string strings;
+    auto addString = [&strings](const std::string& value) {
+        MeshCacheString reference = { (unsigned int) strings.size(), (unsigned int) value.size() };
+        strings += value;
+        return reference;
+    };
+
+    MeshCacheHeader header = {};
+    header.magic = MESH_CACHE_MAGIC;
+    header.version = MESH_CACHE_VERSION;
+    header.sourceKey = sourceKey;
+    header.meshCount = (unsigned int) meshes.size();
+
+    for (const MeshData& mesh : meshes) {
+        MeshCacheMesh record = {};
+        record.firstVertex = header.vertexCount;
+        record.vertexCount = (unsigned int) mesh.vertices.size();
+        record.firstIndex = header.indexCount;
+        record.indexCount = (unsigned int) mesh.indices.size();
+        record.firstTexture = (unsigned int) textures.size();
+        record.textureCount = (unsigned int) mesh.textures.size();
+        record.colorType = addString(mesh.color.type);
+        record.colorId = mesh.color.id;
+        record.color[0] = mesh.color.color.r;
+        record.color[1] = mesh.color.color.g;
+        record.color[2] = mesh.color.color.b;
+        std::memcpy(record.boundsMin, &mesh.boundsMin[0], sizeof(record.boundsMin));
+        std::memcpy(record.boundsMax, &mesh.boundsMax[0], sizeof(record.boundsMax));
+        record.importedVertexCount = mesh.importedVertexCount;
+        record.lodCount = (unsigned int) std::min(mesh.lodIndexCounts.size(), (size_t) MESH_LOD_LEVELS);
+        std::copy(mesh.lodIndexCounts.begin(), mesh.lodIndexCounts.begin() + record.lodCount, record.lodIndexCount);
+        record.firstMeshlet = header.meshletCount;
+        record.meshletCount = (unsigned int) mesh.meshlets.size();
+        records.push_back(record);
+
+        for (const MeshTextureRef& texture : mesh.textures) {
+            MeshCacheTexture reference;
+            reference.type = addString(texture.type);
+            reference.path = addString(texture.path);
+            textures.push_back(reference);
+        }
+        header.vertexCount += record.vertexCount;
+        header.indexCount += record.indexCount;
+        header.meshletCount += record.meshletCount;
+    }
+    header.textureCount = (unsigned int) textures.size();
+    header.stringBytes = (unsigned int) strings.size();
+
+    std::vector<unsigned char> file(sizeof(header) + records.size() * sizeof(MeshCacheMesh) + textures.size() * sizeof(MeshCacheTexture)
+        + (size_t) header.vertexCount * sizeof(Vertex) + (size_t) header.indexCount * sizeof(unsigned int)
+        + (size_t) header.meshletCount * sizeof(Meshlet) + strings.size());
+    unsigned char* out = file.data();
+    auto write = [&out](const void* data, size_t size) {
+        if (size > 0) {
+            std::memcpy(out, data, size);
+        }
+        out += size;
+    };
+
+    write(&header, sizeof(header));
+    write(records.data(), records.size() * sizeof(MeshCacheMesh));
+    write(textures.data(), textures.size() * sizeof(MeshCacheTexture));
+    for (const MeshData& mesh : meshes) {
+        write(mesh.vertices.data(), mesh.vertices.size() * sizeof(Vertex));
+    }
+    for (const MeshData& mesh : meshes) {
+        write(mesh.indices.data(), mesh.indices.size() * sizeof(unsigned int));
+    }
+    for (const MeshData& mesh : meshes) {
+        write(mesh.meshlets.data(), mesh.meshlets.size() * sizeof(Meshlet));
+    }
+    write(strings.data(), strings.size());
+
+    return writeFileAtomic(path, file.data(), file.size());
+}
+
+// Checks the layout of a mapped cache file; false if it is stale, truncated or not one
+inline bool openMeshCache(const MappedFile& file, unsigned long long sourceKey, MeshCacheView& view)
+{
+    if (file.data() == nullptr || file.size() < sizeof(MeshCacheHeader)) {
+        return false;
+    }
+
+    const MeshCacheHeader* header = reinterpret_cast<const MeshCacheHeader*>(file.data());
+    if (header->magic != MESH_CACHE_MAGIC || header->version != MESH_CACHE_VERSION || header->sourceKey != sourceKey) {
+        return false;
+    }
+
+    const size_t meshBytes = (size_t) header->meshCount * sizeof(MeshCacheMesh);
+    const size_t textureBytes = (size_t) header->textureCount * sizeof(MeshCacheTexture);
+    const size_t vertexBytes = (size_t) header->vertexCount * sizeof(Vertex);
+    const size_t indexBytes = (size_t) header->indexCount * sizeof(unsigned int);
+    const size_t meshletBytes = (size_t) header->meshletCount * sizeof(Meshlet);
+    if (file.size() != sizeof(MeshCacheHeader) + meshBytes + textureBytes + vertexBytes + indexBytes + meshletBytes + header->stringBytes) {
+        return false;
+    }
+
+    const unsigned char* data = file.data() + sizeof(MeshCacheHeader);
+    view.header = header;
+    view.meshes = reinterpret_cast<const MeshCacheMesh*>(data);
+    view.textures = reinterpret_cast<const MeshCacheTexture*>(data += meshBytes);
+    view.vertices = reinterpret_cast<const Vertex*>(data += textureBytes);
+    view.indices = reinterpret_cast<const unsigned int*>(data += vertexBytes);
+    view.meshlets = reinterpret_cast<const Meshlet*>(data += indexBytes);
+    view.strings = reinterpret_cast<const char*>(data += meshletBytes);
+
+    auto validString = [header](MeshCacheString reference) {
+        return reference.offset <= header->stringBytes && reference.length <= header->stringBytes - reference.offset;
+    };
+    for (unsigned int i = 0; i < header->meshCount; i++) {
+        const MeshCacheMesh& mesh = view.meshes[i];
+        if (mesh.firstVertex > header->vertexCount || mesh.vertexCount > header->vertexCount - mesh.firstVertex
+            || mesh.firstIndex > header->indexCount || mesh.indexCount > header->indexCount - mesh.firstIndex
+            || mesh.firstTexture > header->textureCount || mesh.textureCount > header->textureCount - mesh.firstTexture
+            || !validString(mesh.colorType) || mesh.lodCount > (unsigned int) MESH_LOD_LEVELS
+            || mesh.firstMeshlet > header->meshletCount || mesh.meshletCount > header->meshletCount - mesh.firstMeshlet) {
+            return false;
+        }
+        size_t lodIndices = 0;
+        for (unsigned int level = 0; level < mesh.lodCount; level++) {
+            lodIndices += mesh.lodIndexCount[level];
+        }
+        if (mesh.lodCount > 0 && lodIndices != mesh.indexCount) {
+            return false;
+        }
+        // Meshlets split detail level 0 only, so they must stay inside its indices
+        const unsigned int levelIndices = mesh.lodCount > 0 ? mesh.lodIndexCount[0] : mesh.indexCount;
+        for (unsigned int m = mesh.firstMeshlet; m < mesh.firstMeshlet + mesh.meshletCount; m++) {
+            const Meshlet& meshlet = view.meshlets[m];
+            if (meshlet.firstIndex > levelIndices || meshlet.indexCount > levelIndices - meshlet.firstIndex) {
+                return false;
+            }
+        }
+    }
+    for (unsigned int i = 0; i < header->textureCount; i++) {
+        if (!validString(view.textures[i].type) || !validString(view.textures[i].path)) {
+            return false;
+        }
+    }
+    return true;
+}
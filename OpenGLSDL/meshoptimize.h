@@ -0,0 +1,788 @@
+#pragma once
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <queue>
+#include <numeric>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "meshcache.h"
+
+// Import time reordering of triangle lists, so the GPU transforms fewer vertices and fetches
+// them from fewer cache lines:
+// - weld: vertices with identical bytes are merged, which Assimp leaves to
+//   aiProcess_JoinIdenticalVertices and the import does not ask for
+// - vertex cache: Tipsify (Sander, Nehab and Barczak, "Fast Triangle Reordering for Vertex
+//   Locality and Reduced Overdraw") fans around vertices that are still in a FIFO cache
+// - overdraw: the clusters Tipsify leaves behind at dead ends are sorted so ones facing away from
+//   the mesh centre, likely occluders, draw first
+// - detail levels: quadric edge collapses (Garland and Heckbert, "Surface Simplification Using
+//   Quadric Error Metrics") build coarser index lists over the same vertices
+// - vertex fetch: vertices are renumbered in the order the triangles first use them
+// - meshlets: level 0 is cut into runs of triangles over at most MESH_MESHLET_VERTICES vertices,
+//   each with a bounding sphere and a cone around its normals, so the CPU can skip runs that are
+//   outside the frustum or face away from the camera
+// The post-transform cache is modelled as a FIFO of MESH_VERTEX_CACHE_SIZE entries.
+
+constexpr int MESH_VERTEX_CACHE_SIZE = 16;
+// Every detail level aims for this share of the triangles of the level before it
+constexpr float MESH_LOD_REDUCTION = 0.5f;
+// A level stops simplifying once a collapse would move the surface further than this, relative
+// to the diagonal of the mesh bounds; the limit doubles with every level
+constexpr float MESH_LOD_ERROR = 0.02f;
+// Limits of a meshlet, the sizes mesh shading hardware is tuned for
+constexpr int MESH_MESHLET_VERTICES = 64;
+constexpr int MESH_MESHLET_TRIANGLES = 124;
+
+enum MeshOptimizeFlags {
+    MESH_OPTIMIZE_VERTEX_CACHE = 1,
+    MESH_OPTIMIZE_OVERDRAW = 2,
+    MESH_OPTIMIZE_VERTEX_FETCH = 4,
+    MESH_OPTIMIZE_WELD = 8,
+    MESH_OPTIMIZE_LOD = 16,
+    MESH_OPTIMIZE_MESHLETS = 32
+};
+
+struct MeshCacheStats {
+    // Vertices transformed per triangle, 0.5 at best for large regular meshes and 3 at worst
+    float acmr = 0.0f;
+    // Vertices transformed per vertex used, 1 at best
+    float atvr = 0.0f;
+};
+
+// Replays the indices through a FIFO cache of cacheSize entries
+inline MeshCacheStats meshCacheStats(const std::vector<unsigned int>& indices, size_t vertexCount, int cacheSize = MESH_VERTEX_CACHE_SIZE)
+{
+    MeshCacheStats stats;
+    if (indices.empty()) {
+        return stats;
+    }
+
+    // A vertex is cached while fewer than cacheSize misses happened since its own
+    std::vector<size_t> missedAt(vertexCount, 0);
+    std::vector<bool> used(vertexCount, false);
+    size_t misses = 0;
+    size_t unique = 0;
+    for (unsigned int index : indices) {
+        if (!used[index] || misses - missedAt[index] >= (size_t) cacheSize) {
+            unique += !used[index];
+            used[index] = true;
+            missedAt[index] = ++misses;
+        }
+    }
+
+    stats.acmr = (float) misses / (indices.size() / 3);
+    stats.atvr = (float) misses / unique;
+    return stats;
+}
+
+// Keeps the first of every run of vertices with identical bytes and points the indices at it.
+// Returns the number of vertices removed.
+inline size_t weldVertices(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices)
+{
+    // Open addressing over vertex numbers, at most half full
+    size_t buckets = 1;
+    while (buckets < vertices.size() * 2) {
+        buckets *= 2;
+    }
+    const unsigned int empty = ~0u;
+    std::vector<unsigned int> table(buckets, empty);
+    std::vector<unsigned int> remap(vertices.size());
+    std::vector<Vertex> welded;
+    welded.reserve(vertices.size());
+
+    for (size_t i = 0; i < vertices.size(); i++) {
+        unsigned long long hash = 14695981039346656037ull;
+        const unsigned char* bytes = reinterpret_cast<const unsigned char*>(&vertices[i]);
+        for (size_t k = 0; k < sizeof(Vertex); k++) {
+            hash = (hash ^ bytes[k]) * 1099511628211ull;
+        }
+
+        size_t bucket = (size_t) (hash ^ (hash >> 32)) & (buckets - 1);
+        while (table[bucket] != empty && std::memcmp(&welded[table[bucket]], &vertices[i], sizeof(Vertex)) != 0) {
+            bucket = (bucket + 1) & (buckets - 1);
+        }
+        if (table[bucket] == empty) {
+            table[bucket] = (unsigned int) welded.size();
+            welded.push_back(vertices[i]);
+        }
+        remap[i] = table[bucket];
+    }
+
+    for (unsigned int& index : indices) {
+        index = remap[index];
+    }
+    const size_t removed = vertices.size() - welded.size();
+    vertices = std::move(welded);
+    return removed;
+}
+
+// Sum of squared distances to a set of planes, as a symmetric 4x4 matrix. It is never below the
+// squared distance to the farthest plane, which bounds how far a collapse moves the surface.
+struct MeshQuadric {
+    double a2 = 0, ab = 0, ac = 0, ad = 0, b2 = 0, bc = 0, bd = 0, c2 = 0, cd = 0, d2 = 0;
+
+    void addPlane(const glm::dvec3& normal, double distance)
+    {
+        a2 += normal.x * normal.x;
+        ab += normal.x * normal.y;
+        ac += normal.x * normal.z;
+        ad += normal.x * distance;
+        b2 += normal.y * normal.y;
+        bc += normal.y * normal.z;
+        bd += normal.y * distance;
+        c2 += normal.z * normal.z;
+        cd += normal.z * distance;
+        d2 += distance * distance;
+    }
+
+    MeshQuadric& operator+=(const MeshQuadric& other)
+    {
+        a2 += other.a2; ab += other.ab; ac += other.ac; ad += other.ad;
+        b2 += other.b2; bc += other.bc; bd += other.bd;
+        c2 += other.c2; cd += other.cd; d2 += other.d2;
+        return *this;
+    }
+
+    double error(const glm::dvec3& p) const
+    {
+        const double sum = a2 * p.x * p.x + b2 * p.y * p.y + c2 * p.z * p.z + d2
+            + 2 * (ab * p.x * p.y + ac * p.x * p.z + bc * p.y * p.z + ad * p.x + bd * p.y + cd * p.z);
+        return std::max(sum, 0.0);
+    }
+};
+
+// Collapses edges of the triangle list into one of their ends, cheapest first by quadric error,
+// until at most targetIndexCount indices are left or the next collapse would move the surface
+// more than maxError. Vertices at one position are collapsed together; a moved corner takes the
+// vertex at its new position whose normal and texture coordinates are closest to its own, so
+// flat shading and texture seams survive. Open borders only collapse along themselves.
+// Returns indices into the same vertices.
+inline std::vector<unsigned int> simplifyIndices(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices,
+    size_t targetIndexCount, float maxError)
+{
+    const size_t triangleCount = indices.size() / 3;
+
+    // Positions, and the vertices at each one as a linked list
+    std::vector<unsigned int> positionOf(vertices.size());
+    std::vector<unsigned int> positionVertex;
+    std::vector<unsigned int> nextAtPosition(vertices.size(), ~0u);
+    {
+        size_t buckets = 1;
+        while (buckets < vertices.size() * 2) {
+            buckets *= 2;
+        }
+        std::vector<unsigned int> table(buckets, ~0u);
+        for (size_t i = 0; i < vertices.size(); i++) {
+            unsigned long long hash = 14695981039346656037ull;
+            const unsigned char* bytes = reinterpret_cast<const unsigned char*>(&vertices[i].Position);
+            for (size_t k = 0; k < sizeof(glm::vec3); k++) {
+                hash = (hash ^ bytes[k]) * 1099511628211ull;
+            }
+            size_t bucket = (size_t) (hash ^ (hash >> 32)) & (buckets - 1);
+            while (table[bucket] != ~0u && std::memcmp(&vertices[positionVertex[table[bucket]]].Position, &vertices[i].Position, sizeof(glm::vec3)) != 0) {
+                bucket = (bucket + 1) & (buckets - 1);
+            }
+            if (table[bucket] == ~0u) {
+                table[bucket] = (unsigned int) positionVertex.size();
+                positionVertex.push_back((unsigned int) i);
+            }
+            else {
+                const unsigned int first = positionVertex[table[bucket]];
+                nextAtPosition[i] = nextAtPosition[first];
+                nextAtPosition[first] = (unsigned int) i;
+            }
+            positionOf[i] = table[bucket];
+        }
+    }
+    const size_t positionCount = positionVertex.size();
+    auto point = [&](unsigned int position) { return glm::dvec3(vertices[positionVertex[position]].Position); };
+
+    std::vector<unsigned int> corners(indices.begin(), indices.begin() + triangleCount * 3);
+    std::vector<unsigned int> cornerPosition(corners.size());
+    for (size_t i = 0; i < corners.size(); i++) {
+        cornerPosition[i] = positionOf[corners[i]];
+    }
+    auto faceNormal = [&](size_t t) {
+        const unsigned int* p = &cornerPosition[t * 3];
+        return glm::cross(point(p[1]) - point(p[0]), point(p[2]) - point(p[0]));
+    };
+
+    // Triangles without area are dropped up front, or the slivers some exporters leave along
+    // outlines would hide them from the border search below
+    std::vector<bool> alive(triangleCount, true);
+    std::vector<std::vector<unsigned int>> adjacent(positionCount);
+    size_t liveTriangles = 0;
+    for (size_t t = 0; t < triangleCount; t++) {
+        const unsigned int* p = &cornerPosition[t * 3];
+        const double sides = glm::length(point(p[1]) - point(p[0])) * glm::length(point(p[2]) - point(p[0]));
+        if (p[0] == p[1] || p[1] == p[2] || p[0] == p[2] || glm::length(faceNormal(t)) <= 1e-6 * sides) {
+            alive[t] = false;
+            continue;
+        }
+        liveTriangles++;
+        for (int k = 0; k < 3; k++) {
+            adjacent[p[k]].push_back((unsigned int) t);
+        }
+    }
+
+    // Edges used by other than two triangles are borders, and so are edges where the surface
+    // folds back onto itself, like the outline of a leaf made of a front and a back face
+    std::vector<std::pair<std::pair<unsigned int, unsigned int>, unsigned int>> edges;
+    for (size_t t = 0; t < triangleCount; t++) {
+        for (int k = 0; alive[t] && k < 3; k++) {
+            const unsigned int a = cornerPosition[t * 3 + k];
+            const unsigned int b = cornerPosition[t * 3 + (k + 1) % 3];
+            edges.push_back(std::make_pair(std::make_pair(std::min(a, b), std::max(a, b)), (unsigned int) t));
+        }
+    }
+    std::sort(edges.begin(), edges.end());
+    std::vector<std::pair<unsigned int, unsigned int>> borderEdges;
+    for (size_t i = 0; i < edges.size();) {
+        size_t j = i;
+        while (j < edges.size() && edges[j].first == edges[i].first) {
+            j++;
+        }
+        if (j - i != 2) {
+            borderEdges.push_back(edges[i].first);
+        }
+        else {
+            const glm::dvec3 first = faceNormal(edges[i].second);
+            const glm::dvec3 second = faceNormal(edges[i + 1].second);
+            if (glm::dot(first, second) < -0.5 * glm::length(first) * glm::length(second)) {
+                borderEdges.push_back(edges[i].first);
+            }
+        }
+        i = j;
+    }
+    auto isBorderEdge = [&borderEdges](unsigned int a, unsigned int b) {
+        return std::binary_search(borderEdges.begin(), borderEdges.end(), std::make_pair(std::min(a, b), std::max(a, b)));
+    };
+    std::vector<bool> border(positionCount, false);
+    for (const auto& edge : borderEdges) {
+        border[edge.first] = border[edge.second] = true;
+    }
+
+    // Triangle planes, and planes through border edges at right angles to them
+    std::vector<MeshQuadric> quadrics(positionCount);
+    for (size_t t = 0; t < triangleCount; t++) {
+        if (!alive[t]) {
+            continue;
+        }
+        const unsigned int* p = &cornerPosition[t * 3];
+        const glm::dvec3 cross = faceNormal(t);
+        const double area = glm::length(cross);
+        if (area <= 0) {
+            continue;
+        }
+        const glm::dvec3 normal = cross / area;
+        MeshQuadric plane;
+        plane.addPlane(normal, -glm::dot(normal, point(p[0])));
+        for (int k = 0; k < 3; k++) {
+            quadrics[p[k]] += plane;
+
+            const unsigned int a = p[k];
+            const unsigned int b = p[(k + 1) % 3];
+            if (isBorderEdge(a, b)) {
+                const glm::dvec3 edge = point(b) - point(a);
+                const double length = glm::length(edge);
+                if (length > 0) {
+                    const glm::dvec3 side = glm::normalize(glm::cross(edge, normal));
+                    MeshQuadric borderPlane;
+                    borderPlane.addPlane(side, -glm::dot(side, point(a)));
+                    quadrics[a] += borderPlane;
+                    quadrics[b] += borderPlane;
+                }
+            }
+        }
+    }
+
+    // Collapses from one position into another, cheapest first. An entry is stale once either
+    // end has changed since it was pushed.
+    struct Collapse {
+        double cost;
+        unsigned int from;
+        unsigned int to;
+        unsigned int fromVersion;
+        unsigned int toVersion;
+        bool operator<(const Collapse& other) const { return cost > other.cost; }
+    };
+    std::vector<unsigned int> version(positionCount, 0);
+    std::vector<bool> removed(positionCount, false);
+    std::priority_queue<Collapse> queue;
+    auto pushEdges = [&](unsigned int position) {
+        for (unsigned int t : adjacent[position]) {
+            if (!alive[t]) {
+                continue;
+            }
+            for (int k = 0; k < 3; k++) {
+                const unsigned int other = cornerPosition[t * 3 + k];
+                if (other == position) {
+                    continue;
+                }
+                for (int direction = 0; direction < 2; direction++) {
+                    const unsigned int from = direction == 0 ? position : other;
+                    const unsigned int to = direction == 0 ? other : position;
+                    MeshQuadric sum = quadrics[from];
+                    sum += quadrics[to];
+                    queue.push({ sum.error(point(to)), from, to, version[from], version[to] });
+                }
+            }
+        }
+    };
+    for (unsigned int position = 0; position < positionCount; position++) {
+        pushEdges(position);
+    }
+
+    const double maxCost = (double) maxError * maxError;
+    std::vector<unsigned int> fromNeighbours;
+    std::vector<unsigned int> toNeighbours;
+    while (liveTriangles * 3 > targetIndexCount && !queue.empty()) {
+        const Collapse collapse = queue.top();
+        queue.pop();
+        if (collapse.cost > maxCost) {
+            break;
+        }
+        const unsigned int from = collapse.from;
+        const unsigned int to = collapse.to;
+        if (removed[from] || removed[to] || version[from] != collapse.fromVersion || version[to] != collapse.toVersion) {
+            continue;
+        }
+        if (border[from] && !isBorderEdge(from, to)) {
+            continue;
+        }
+
+        // No triangle around from may flip or degenerate, and the two ends may only share the
+        // neighbours across the triangles on their edge, or the surface would pinch
+        bool valid = true;
+        size_t shared = 0;
+        fromNeighbours.clear();
+        toNeighbours.clear();
+        for (unsigned int t : adjacent[from]) {
+            if (!alive[t]) {
+                continue;
+            }
+            const unsigned int* p = &cornerPosition[t * 3];
+            const bool hasTo = p[0] == to || p[1] == to || p[2] == to;
+            shared += hasTo;
+            for (int k = 0; k < 3; k++) {
+                if (p[k] != from && p[k] != to) {
+                    fromNeighbours.push_back(p[k]);
+                }
+            }
+            if (hasTo) {
+                continue;
+            }
+            glm::dvec3 corner[3];
+            for (int k = 0; k < 3; k++) {
+                corner[k] = point(p[k]);
+            }
+            const glm::dvec3 before = glm::cross(corner[1] - corner[0], corner[2] - corner[0]);
+            for (int k = 0; k < 3; k++) {
+                if (p[k] == from) {
+                    corner[k] = point(to);
+                }
+            }
+            const glm::dvec3 after = glm::cross(corner[1] - corner[0], corner[2] - corner[0]);
+            if (glm::dot(before, after) <= 0.25 * glm::length(before) * glm::length(after) || glm::length(after) == 0) {
+                valid = false;
+                break;
+            }
+        }
+        if (!valid || shared == 0) {
+            continue;
+        }
+        for (unsigned int t : adjacent[to]) {
+            const unsigned int* p = &cornerPosition[t * 3];
+            for (int k = 0; alive[t] && k < 3; k++) {
+                if (p[k] != from && p[k] != to) {
+                    toNeighbours.push_back(p[k]);
+                }
+            }
+        }
+        std::sort(fromNeighbours.begin(), fromNeighbours.end());
+        fromNeighbours.erase(std::unique(fromNeighbours.begin(), fromNeighbours.end()), fromNeighbours.end());
+        std::sort(toNeighbours.begin(), toNeighbours.end());
+        toNeighbours.erase(std::unique(toNeighbours.begin(), toNeighbours.end()), toNeighbours.end());
+        size_t common = 0;
+        for (unsigned int position : fromNeighbours) {
+            common += std::binary_search(toNeighbours.begin(), toNeighbours.end(), position);
+        }
+        if (common > shared) {
+            continue;
+        }
+
+        for (unsigned int t : adjacent[from]) {
+            if (!alive[t]) {
+                continue;
+            }
+            unsigned int* p = &cornerPosition[t * 3];
+            if (p[0] == to || p[1] == to || p[2] == to) {
+                alive[t] = false;
+                liveTriangles--;
+                continue;
+            }
+            for (int k = 0; k < 3; k++) {
+                if (p[k] != from) {
+                    continue;
+                }
+                // The vertex at the new position that looks most like the corner's own
+                const Vertex& own = vertices[corners[t * 3 + k]];
+                float best = std::numeric_limits<float>::max();
+                for (unsigned int v = positionVertex[to]; v != ~0u; v = nextAtPosition[v]) {
+                    const glm::vec3 normal = vertices[v].Normal - own.Normal;
+                    const glm::vec2 texCoords = vertices[v].TexCoords - own.TexCoords;
+                    const float difference = glm::dot(normal, normal) + glm::dot(texCoords, texCoords);
+                    if (difference < best) {
+                        best = difference;
+                        corners[t * 3 + k] = v;
+                    }
+                }
+                p[k] = to;
+            }
+            adjacent[to].push_back(t);
+        }
+
+        quadrics[to] += quadrics[from];
+        removed[from] = true;
+        adjacent[from].clear();
+        version[to]++;
+        pushEdges(to);
+    }
+
+    std::vector<unsigned int> result;
+    result.reserve(liveTriangles * 3);
+    for (size_t t = 0; t < triangleCount; t++) {
+        if (alive[t]) {
+            result.insert(result.end(), corners.begin() + t * 3, corners.begin() + t * 3 + 3);
+        }
+    }
+    return result;
+}
+
+// Simplifies the mesh into up to MESH_LOD_LEVELS levels stored back to back in its indices.
+// Stops early once a level would not lose a tenth of the triangles of the one before.
+inline void buildMeshLods(MeshData& mesh)
+{
+    glm::vec3 boundsMin;
+    glm::vec3 boundsMax;
+    meshBounds(mesh.vertices, boundsMin, boundsMax);
+    const float diagonal = glm::length(boundsMax - boundsMin);
+
+    std::vector<unsigned int> level = mesh.indices;
+    mesh.lodIndexCounts.assign(1, (unsigned int) mesh.indices.size());
+    float maxError = MESH_LOD_ERROR * diagonal;
+    for (int lod = 1; lod < MESH_LOD_LEVELS; lod++, maxError *= 2) {
+        const size_t target = (size_t) (level.size() / 3 * MESH_LOD_REDUCTION) * 3;
+        std::vector<unsigned int> coarser = simplifyIndices(mesh.vertices, level, target, maxError);
+        if (coarser.empty() || coarser.size() * 10 > level.size() * 9) {
+            break;
+        }
+        mesh.indices.insert(mesh.indices.end(), coarser.begin(), coarser.end());
+        mesh.lodIndexCounts.push_back((unsigned int) coarser.size());
+        level = std::move(coarser);
+    }
+    if (mesh.lodIndexCounts.size() == 1) {
+        mesh.lodIndexCounts.clear();
+    }
+}
+
+// Tipsify. Returns the reordered indices; clusterStarts receives the first triangle of every run
+// that began at a dead end.
+inline std::vector<unsigned int> optimizeVertexCache(const std::vector<unsigned int>& indices, size_t vertexCount,
+    std::vector<size_t>& clusterStarts, int cacheSize = MESH_VERTEX_CACHE_SIZE)
+{
+    const size_t triangleCount = indices.size() / 3;
+
+    // Triangles around every vertex, as offsets into one array
+    std::vector<unsigned int> live(vertexCount, 0);
+    for (size_t i = 0; i < triangleCount * 3; i++) {
+        live[indices[i]]++;
+    }
+    std::vector<size_t> firstAdjacent(vertexCount + 1, 0);
+    for (size_t v = 0; v < vertexCount; v++) {
+        firstAdjacent[v + 1] = firstAdjacent[v] + live[v];
+    }
+    std::vector<unsigned int> adjacent(firstAdjacent[vertexCount]);
+    {
+        std::vector<size_t> fill(firstAdjacent.begin(), firstAdjacent.end() - 1);
+        for (size_t i = 0; i < triangleCount * 3; i++) {
+            adjacent[fill[indices[i]]++] = (unsigned int) (i / 3);
+        }
+    }
+
+    std::vector<int> cacheTime(vertexCount, 0);
+    std::vector<bool> emitted(triangleCount, false);
+    std::vector<unsigned int> deadEnd;
+    std::vector<unsigned int> candidates;
+    std::vector<unsigned int> result;
+    result.reserve(triangleCount * 3);
+    clusterStarts.clear();
+
+    int time = cacheSize + 1;
+    size_t cursor = 0;
+    long long fan = vertexCount > 0 ? 0 : -1;
+    bool deadEndJump = true;
+
+    while (fan >= 0) {
+        if (deadEndJump && (clusterStarts.empty() || clusterStarts.back() != result.size() / 3)) {
+            clusterStarts.push_back(result.size() / 3);
+        }
+
+        candidates.clear();
+        for (size_t a = firstAdjacent[fan]; a < firstAdjacent[fan + 1]; a++) {
+            const unsigned int triangle = adjacent[a];
+            if (emitted[triangle]) {
+                continue;
+            }
+            for (int k = 0; k < 3; k++) {
+                const unsigned int v = indices[triangle * 3 + k];
+                result.push_back(v);
+                deadEnd.push_back(v);
+                candidates.push_back(v);
+                live[v]--;
+                if (time - cacheTime[v] > cacheSize) {
+                    cacheTime[v] = time++;
+                }
+            }
+            emitted[triangle] = true;
+        }
+
+        // The candidate that stays in the cache after its remaining triangles are fanned,
+        // oldest first
+        long long next = -1;
+        int best = -1;
+        for (unsigned int v : candidates) {
+            if (live[v] == 0) {
+                continue;
+            }
+            int priority = 0;
+            if (time - cacheTime[v] + 2 * (int) live[v] <= cacheSize) {
+                priority = time - cacheTime[v];
+            }
+            if (priority > best) {
+                best = priority;
+                next = v;
+            }
+        }
+
+        deadEndJump = next < 0;
+        if (next < 0) {
+            // Recently used vertices first, then the input order
+            while (!deadEnd.empty() && next < 0) {
+                const unsigned int v = deadEnd.back();
+                deadEnd.pop_back();
+                if (live[v] > 0) {
+                    next = v;
+                }
+            }
+            while (next < 0 && cursor < vertexCount) {
+                if (live[cursor] > 0) {
+                    next = (long long) cursor;
+                }
+                cursor++;
+            }
+        }
+        fan = next;
+    }
+    return result;
+}
+
+// Orders whole clusters from optimizeVertexCache so those facing away from the mesh centre come
+// first; within a cluster the vertex cache order stays
+inline std::vector<unsigned int> optimizeOverdraw(const std::vector<unsigned int>& indices, const std::vector<Vertex>& vertices,
+    const std::vector<size_t>& clusterStarts)
+{
+    const size_t triangleCount = indices.size() / 3;
+    if (clusterStarts.size() < 2) {
+        return indices;
+    }
+
+    glm::vec3 meshCentre(0.0f);
+    float meshArea = 0.0f;
+    std::vector<glm::vec3> clusterCentre(clusterStarts.size(), glm::vec3(0.0f));
+    std::vector<glm::vec3> clusterNormal(clusterStarts.size(), glm::vec3(0.0f));
+    std::vector<float> clusterArea(clusterStarts.size(), 0.0f);
+
+    for (size_t c = 0; c < clusterStarts.size(); c++) {
+        const size_t end = c + 1 < clusterStarts.size() ? clusterStarts[c + 1] : triangleCount;
+        for (size_t t = clusterStarts[c]; t < end; t++) {
+            const glm::vec3& a = vertices[indices[t * 3]].Position;
+            const glm::vec3& b = vertices[indices[t * 3 + 1]].Position;
+            const glm::vec3& d = vertices[indices[t * 3 + 2]].Position;
+            // Twice the area, in the direction of the face normal
+            const glm::vec3 normal = glm::cross(b - a, d - a);
+            const float area = glm::length(normal);
+            const glm::vec3 centre = (a + b + d) / 3.0f;
+
+            clusterCentre[c] += centre * area;
+            clusterNormal[c] += normal;
+            clusterArea[c] += area;
+            meshCentre += centre * area;
+            meshArea += area;
+        }
+    }
+    if (meshArea > 0.0f) {
+        meshCentre /= meshArea;
+    }
+
+    std::vector<float> occlusion(clusterStarts.size(), 0.0f);
+    for (size_t c = 0; c < clusterStarts.size(); c++) {
+        if (clusterArea[c] > 0.0f && glm::length(clusterNormal[c]) > 0.0f) {
+            occlusion[c] = glm::dot(clusterCentre[c] / clusterArea[c] - meshCentre, glm::normalize(clusterNormal[c]));
+        }
+    }
+
+    std::vector<size_t> order(clusterStarts.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&occlusion](size_t a, size_t b) { return occlusion[a] > occlusion[b]; });
+
+    std::vector<unsigned int> result;
+    result.reserve(indices.size());
+    for (size_t c : order) {
+        const size_t end = c + 1 < clusterStarts.size() ? clusterStarts[c + 1] : triangleCount;
+        result.insert(result.end(), indices.begin() + clusterStarts[c] * 3, indices.begin() + end * 3);
+    }
+    return result;
+}
+
+// Renumbers vertices in first use order and drops unused ones
+inline void optimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices)
+{
+    const unsigned int unassigned = ~0u;
+    std::vector<unsigned int> remap(vertices.size(), unassigned);
+    std::vector<Vertex> reordered;
+    reordered.reserve(vertices.size());
+
+    for (unsigned int& index : indices) {
+        if (remap[index] == unassigned) {
+            remap[index] = (unsigned int) reordered.size();
+            reordered.push_back(vertices[index]);
+        }
+        index = remap[index];
+    }
+    vertices = std::move(reordered);
+}
+
+// Bounding sphere and normal cone of the triangles of a meshlet
+inline void meshletBounds(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices, Meshlet& meshlet)
+{
+    const unsigned int end = meshlet.firstIndex + meshlet.indexCount;
+    glm::vec3 boundsMin = vertices[indices[meshlet.firstIndex]].Position;
+    glm::vec3 boundsMax = boundsMin;
+    glm::vec3 normalSum(0.0f);
+    for (unsigned int i = meshlet.firstIndex; i < end; i += 3) {
+        const glm::vec3& a = vertices[indices[i]].Position;
+        const glm::vec3& b = vertices[indices[i + 1]].Position;
+        const glm::vec3& c = vertices[indices[i + 2]].Position;
+        boundsMin = glm::min(boundsMin, glm::min(a, glm::min(b, c)));
+        boundsMax = glm::max(boundsMax, glm::max(a, glm::max(b, c)));
+
+        const glm::vec3 normal = glm::cross(b - a, c - a);
+        const float length = glm::length(normal);
+        if (length > 0.0f) {
+            normalSum += normal / length;
+        }
+    }
+
+    meshlet.centre = (boundsMin + boundsMax) * 0.5f;
+    meshlet.radius = 0.0f;
+    for (unsigned int i = meshlet.firstIndex; i < end; i++) {
+        meshlet.radius = std::max(meshlet.radius, glm::length(vertices[indices[i]].Position - meshlet.centre));
+    }
+
+    // The cone has to hold the normal furthest from the mean one
+    const float sumLength = glm::length(normalSum);
+    meshlet.coneAxis = sumLength > 0.0f ? normalSum / sumLength : glm::vec3(0.0f, 1.0f, 0.0f);
+    float minCos = sumLength > 0.0f ? 1.0f : -1.0f;
+    for (unsigned int i = meshlet.firstIndex; i < end && minCos > 0.0f; i += 3) {
+        const glm::vec3& a = vertices[indices[i]].Position;
+        const glm::vec3 normal = glm::cross(vertices[indices[i + 1]].Position - a, vertices[indices[i + 2]].Position - a);
+        const float length = glm::length(normal);
+        if (length > 0.0f) {
+            minCos = std::min(minCos, glm::dot(normal / length, meshlet.coneAxis));
+        }
+    }
+    meshlet.coneCutoff = minCos > 0.0f ? std::sqrt(std::max(1.0f - minCos * minCos, 0.0f)) : 1.0f;
+}
+
+// Cuts the first indexCount indices into meshlets in the order they are drawn, which the vertex
+// cache pass has already made local; a meshlet ends once the next triangle would take it over
+// either limit
+inline std::vector<Meshlet> buildMeshlets(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices, size_t indexCount)
+{
+    std::vector<Meshlet> meshlets;
+    // Meshlet number + 1 of the last meshlet to use a vertex
+    std::vector<unsigned int> usedBy(vertices.size(), 0);
+    auto newVertices = [&usedBy, &meshlets](const unsigned int* triangle) {
+        const unsigned int stamp = (unsigned int) meshlets.size() + 1;
+        return (usedBy[triangle[0]] != stamp) + (usedBy[triangle[1]] != stamp && triangle[1] != triangle[0])
+            + (usedBy[triangle[2]] != stamp && triangle[2] != triangle[0] && triangle[2] != triangle[1]);
+    };
+
+    Meshlet meshlet = {};
+    int meshletVertices = 0;
+    for (size_t i = 0; i + 2 < indexCount; i += 3) {
+        const unsigned int* triangle = &indices[i];
+        if (meshlet.indexCount > 0 && (meshletVertices + newVertices(triangle) > MESH_MESHLET_VERTICES
+            || (int) meshlet.indexCount == MESH_MESHLET_TRIANGLES * 3)) {
+            meshletBounds(vertices, indices, meshlet);
+            meshlets.push_back(meshlet);
+            meshlet = {};
+            meshlet.firstIndex = (unsigned int) i;
+            meshletVertices = 0;
+        }
+
+        meshletVertices += newVertices(triangle);
+        for (int k = 0; k < 3; k++) {
+            usedBy[triangle[k]] = (unsigned int) meshlets.size() + 1;
+        }
+        meshlet.indexCount += 3;
+    }
+    if (meshlet.indexCount > 0) {
+        meshletBounds(vertices, indices, meshlet);
+        meshlets.push_back(meshlet);
+    }
+    return meshlets;
+}
+
+inline void optimizeMesh(MeshData& mesh, unsigned int flags)
+{
+    if (mesh.indices.size() < 3) {
+        return;
+    }
+
+    if (flags & MESH_OPTIMIZE_WELD) {
+        weldVertices(mesh.vertices, mesh.indices);
+    }
+    if (flags & MESH_OPTIMIZE_LOD) {
+        buildMeshLods(mesh);
+    }
+    if (flags & (MESH_OPTIMIZE_VERTEX_CACHE | MESH_OPTIMIZE_OVERDRAW)) {
+        // Every detail level is drawn on its own
+        std::vector<unsigned int> levels = mesh.lodIndexCounts;
+        if (levels.empty()) {
+            levels.push_back((unsigned int) mesh.indices.size());
+        }
+        size_t first = 0;
+        for (unsigned int count : levels) {
+            std::vector<unsigned int> level(mesh.indices.begin() + first, mesh.indices.begin() + first + count);
+            std::vector<size_t> clusterStarts;
+            level = optimizeVertexCache(level, mesh.vertices.size(), clusterStarts);
+            if (flags & MESH_OPTIMIZE_OVERDRAW) {
+                level = optimizeOverdraw(level, mesh.vertices, clusterStarts);
+            }
+            std::copy(level.begin(), level.end(), mesh.indices.begin() + first);
+            first += count;
+        }
+    }
+    if (flags & MESH_OPTIMIZE_VERTEX_FETCH) {
+        optimizeVertexFetch(mesh.vertices, mesh.indices);
+    }
+    if (flags & MESH_OPTIMIZE_MESHLETS) {
+        mesh.meshlets = buildMeshlets(mesh.vertices, mesh.indices, mesh.lodIndexCounts.empty() ? mesh.indices.size() : mesh.lodIndexCounts[0]);
+    }
+}
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <algorithm>
 #include <vector>
 #include <iostream>
 
@@ -11,19 +12,74 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
+#include "mappedfile.h"
 #include "mesh.h"
+#include "meshcache.h"
+#include "meshoptimize.h"
 #include "object.h"
 
+// Part of the mesh cache key, so changing the import invalidates cached models
+constexpr unsigned int MODEL_IMPORT_FLAGS = aiProcess_Triangulate;
+constexpr unsigned int MODEL_OPTIMIZE_FLAGS = MESH_OPTIMIZE_WELD | MESH_OPTIMIZE_LOD | MESH_OPTIMIZE_VERTEX_CACHE | MESH_OPTIMIZE_OVERDRAW
+	| MESH_OPTIMIZE_VERTEX_FETCH | MESH_OPTIMIZE_MESHLETS;
+
 unsigned int TextureFromFile(const char* filePath, const std::string& directory);
+unsigned int TextureFromImage(const TextureImage& image);
+bool decodeTexture(const std::string& filename, TextureImage& image);
 
 class Model : public Object {
 public:
 	Model() {};
-	Model(const char* path)
+	// Loads from the mesh cache in cacheDirectory when it is current, otherwise imports with
+	// Assimp and writes the cache; an empty cacheDirectory always imports
+	Model(const char* path, const std::string& cacheDirectory = "cache")
 	{
-		loadModel(path);
+		loadModel(path, cacheDirectory);
 	}
 	void Draw(Shader& shader) override;
+
+	// Layout of the meshes created from now on
+	MeshVertexFormat vertexFormat = MESH_VERTEX_QUANTIZED;
+	// Detail level 1 is drawn once the model's bounding sphere covers less than this share of the
+	// screen height, and every level after that below half the size of the one before
+	float lodScreenSize = 0.125f;
+	// A model or instance keeps its level until its size passes the threshold by this share, so
+	// one sitting near a threshold does not swap levels (and rewrite the instance buffer) every frame
+	float lodHysteresis = 0.15f;
+	// Vertex and index bytes of the created meshes as Assimp returned them, 32-bit indices and
+	// all, and what their GL buffers hold after welding, quantizing and 16-bit indices
+	size_t importedBytes = 0;
+	size_t bufferBytes = 0;
+
+	// The two halves of loading a model. readModel maps the current mesh cache entry or imports
+	// and writes one, without any GL calls, so it can run on any thread; false if the file cannot
+	// be read. createMeshes then uploads the source and must run on the GL thread.
+	static bool readModel(Assimp::Importer& importer, const std::string& path, const std::string& cacheDirectory, ModelSource& source);
+	void createMeshes(const ModelSource& source);
+	// Decodes the source's textures into source.images, so uploading them is all createMeshes
+	// has left to do; no GL calls
+	static void decodeTextures(ModelSource& source);
+
+	// createMeshes one mesh at a time, for uploads spread over frames. addMeshes hands the
+	// created meshes over together, so a model never draws half loaded.
+	static size_t meshCount(const ModelSource& source);
+	static size_t meshBytes(const ModelSource& source, size_t index);
+	Mesh createMesh(const ModelSource& source, size_t index);
+	void addMeshes(std::vector<Mesh> created);
+
+	// Draws every mesh once per location, for instanceShader, in one instanced draw per detail
+	// level. Meshes added later get the locations too.
+	void setInstances(const std::vector<glm::mat4>& locations);
+	// Picks the level of the model and of every instance from the projected size of its bounding
+	// sphere, and sorts the instances by level
+	void selectLod(glm::vec3 cameraPosition, const glm::mat4& projection) override;
+	// Keeps the meshlets of location that are in view and face the camera, when the model is
+	// drawn at level 0; instances always draw whole meshes
+	void cull(glm::vec3 cameraPosition, const glm::mat4& viewProjection) override;
+
+	// Assimp import and optimizeMesh without any GL calls; false if the file cannot be read
+	static bool importMeshes(Assimp::Importer& importer, const std::string& path, std::vector<MeshData>& meshes,
+		unsigned int optimizeFlags = MODEL_OPTIMIZE_FLAGS);
 	
 	std::vector<Mesh> meshes;
 	std::vector<Texture> textures_loaded;
@@ -31,39 +87,344 @@ public:
 private:
 	// model data
 	std::string directory;
-
-	void loadModel(std::string path);
-	void processNode(aiNode* node, const aiScene* scene);
-	Mesh processMesh(aiMesh* mesh, const aiScene* scene);
-	std::vector<Texture> loadMaterialTextures(aiMaterial* mat, aiTextureType type, std::string typeName);
+	unsigned int instanceBuffer = 0;
+	// Around every mesh, in model space
+	glm::vec3 sphereCentre = glm::vec3(0.0f);
+	float sphereRadius = 0.0f;
+	// Of location, and of the instances: their levels, and their locations in the instance
+	// buffer, sorted by level
+	int lod = 0;
+	std::vector<unsigned char> instanceLods;
+	std::vector<glm::mat4> sortedLocations;
+	GLsizei lodInstanceCounts[MESH_LOD_LEVELS] = {};
+
+	void loadModel(std::string path, const std::string& cacheDirectory);
+	Texture loadTexture(const std::string& type, const std::string& path, const ModelSource& source);
+	// Points the instance matrix attributes at the instance buffer from firstInstance on
+	void setupInstanceAttributes(Mesh& mesh, size_t firstInstance = 0);
+	int lodFor(const glm::mat4& transform, glm::vec3 cameraPosition, float projectionScale, int current) const;
+	int lodForSize(float size) const;
+	static void processNode(aiNode* node, const aiScene* scene, std::vector<MeshData>& meshes);
+	static MeshData processMesh(aiMesh* mesh, const aiScene* scene);
+	static std::vector<MeshTextureRef> materialTextures(aiMaterial* mat, aiTextureType type, std::string typeName);
 };
 
 void Model::Draw(Shader& shader)
 {
 	if (this->locations.size() > 0) {
-		for (unsigned int i = 0; i < meshes.size(); i++) {
-			meshes[i].Draw(shader, locations.size());
+		for (Mesh& mesh : meshes) {
+			mesh.prepareMaterial(shader);
+			// The instances of one level are a single run of the instance buffer
+			size_t first = 0;
+			for (int level = 0; level < MESH_LOD_LEVELS; level++) {
+				if (lodInstanceCounts[level] > 0) {
+					setupInstanceAttributes(mesh, first);
+					mesh.drawLod(level, lodInstanceCounts[level]);
+					first += lodInstanceCounts[level];
+				}
+			}
 		}
 	}
-	for (unsigned int i = 0; i < meshes.size(); i++) {
-		meshes[i].Draw(shader);
+	for (Mesh& mesh : meshes) {
+		mesh.prepareMaterial(shader);
+		if (lod == 0) {
+			mesh.drawMeshlets();
+		}
+		else {
+			mesh.drawLod(lod, 0);
+		}
 	}
 }
 
-void Model::loadModel(std::string path)
+void Model::loadModel(std::string path, const std::string& cacheDirectory)
 {
 	Assimp::Importer import;
-	const aiScene* scene = import.ReadFile(path, aiProcess_Triangulate);
+	ModelSource source;
+	if (readModel(import, path, cacheDirectory, source)) {
+		createMeshes(source);
+	}
+}
+
+bool Model::readModel(Assimp::Importer& importer, const std::string& path, const std::string& cacheDirectory, ModelSource& source)
+{
+	source.path = path;
+
+	const std::string cachePath = cacheDirectory.empty() ? std::string() : meshCachePath(cacheDirectory, path);
+	const unsigned long long sourceKey = meshSourceKey(path, MODEL_IMPORT_FLAGS, MODEL_OPTIMIZE_FLAGS);
+	if (!cachePath.empty()) {
+		source.cacheFile = std::make_unique<MappedFile>();
+		if (source.cacheFile->open(cachePath) && openMeshCache(*source.cacheFile, sourceKey, source.cached)) {
+			return true;
+		}
+		source.cacheFile.reset();
+	}
+
+	if (!importMeshes(importer, path, source.imported)) {
+		return false;
+	}
+
+	if (!cachePath.empty()) {
+		makeDirectory(cacheDirectory);
+		if (!writeMeshCache(cachePath, sourceKey, source.imported)) {
+			std::cout << "Failed to write mesh cache " << cachePath << std::endl;
+		}
+	}
+	return true;
+}
+
+void Model::createMeshes(const ModelSource& source)
+{
+	std::vector<Mesh> created;
+	for (size_t i = 0; i < meshCount(source); i++) {
+		created.push_back(createMesh(source, i));
+	}
+	addMeshes(std::move(created));
+}
+
+void Model::decodeTextures(ModelSource& source)
+{
+	std::vector<std::string> paths;
+	for (const MeshData& data : source.imported) {
+		for (const MeshTextureRef& texture : data.textures) {
+			paths.push_back(texture.path);
+		}
+	}
+	if (source.cacheFile) {
+		for (unsigned int t = 0; t < source.cached.header->textureCount; t++) {
+			paths.push_back(source.cached.string(source.cached.textures[t].path));
+		}
+	}
+	std::sort(paths.begin(), paths.end());
+	paths.erase(std::unique(paths.begin(), paths.end()), paths.end());
+
+	const std::string directory = source.path.substr(0, source.path.find_last_of('\\'));
+	for (const std::string& path : paths) {
+		TextureImage image;
+		image.path = path;
+		decodeTexture(directory + '\\' + path, image);
+		source.images.push_back(std::move(image));
+	}
+}
+
+size_t Model::meshCount(const ModelSource& source)
+{
+	return source.imported.size() + (source.cacheFile ? source.cached.header->meshCount : 0);
+}
+
+size_t Model::meshBytes(const ModelSource& source, size_t index)
+{
+	if (index < source.imported.size()) {
+		const MeshData& data = source.imported[index];
+		return data.vertices.size() * sizeof(Vertex) + data.indices.size() * sizeof(unsigned int);
+	}
+	const MeshCacheMesh& record = source.cached.meshes[index - source.imported.size()];
+	return (size_t) record.vertexCount * sizeof(Vertex) + (size_t) record.indexCount * sizeof(unsigned int);
+}
+
+Mesh Model::createMesh(const ModelSource& source, size_t index)
+{
+	directory = source.path.substr(0, source.path.find_last_of('\\'));
+
+	if (index < source.imported.size()) {
+		const MeshData& data = source.imported[index];
+		std::vector<Texture> textures;
+		for (const MeshTextureRef& texture : data.textures) {
+			textures.push_back(loadTexture(texture.type, texture.path, source));
+		}
+		Mesh mesh(data.vertices.data(), data.vertices.size(), data.indices.data(), data.indices.size(), textures, data.color, vertexFormat);
+		mesh.setLods(data.lodIndexCounts.data(), data.lodIndexCounts.size());
+		mesh.setMeshlets(data.meshlets.data(), data.meshlets.size());
+		importedBytes += (size_t)data.importedVertexCount * sizeof(Vertex) + (size_t)mesh.lodIndexCount[0] * sizeof(unsigned int);
+		bufferBytes += mesh.bufferBytes;
+		return mesh;
+	}
+
+	const MeshCacheView& view = source.cached;
+	const MeshCacheMesh& record = view.meshes[index - source.imported.size()];
+
+	std::vector<Texture> textures;
+	for (unsigned int t = record.firstTexture; t < record.firstTexture + record.textureCount; t++) {
+		textures.push_back(loadTexture(view.string(view.textures[t].type), view.string(view.textures[t].path), source));
+	}
+
+	Color color;
+	color.id = record.colorId;
+	color.type = view.string(record.colorType);
+	color.color = aiColor3D(record.color[0], record.color[1], record.color[2]);
+
+	Mesh mesh(view.vertices + record.firstVertex, record.vertexCount, view.indices + record.firstIndex, record.indexCount, textures, color,
+		vertexFormat);
+	mesh.setLods(record.lodIndexCount, record.lodCount);
+	mesh.setMeshlets(view.meshlets + record.firstMeshlet, record.meshletCount);
+	importedBytes += (size_t)record.importedVertexCount * sizeof(Vertex) + (size_t)mesh.lodIndexCount[0] * sizeof(unsigned int);
+	bufferBytes += mesh.bufferBytes;
+	return mesh;
+}
+
+void Model::addMeshes(std::vector<Mesh> created)
+{
+	for (Mesh& mesh : created) {
+		if (instanceBuffer != 0) {
+			setupInstanceAttributes(mesh);
+		}
+		meshes.push_back(mesh);
+	}
+
+	if (meshes.empty()) {
+		return;
+	}
+	glm::vec3 boundsMin = meshes[0].boundsMin;
+	glm::vec3 boundsMax = meshes[0].boundsMax;
+	for (const Mesh& mesh : meshes) {
+		boundsMin = glm::min(boundsMin, mesh.boundsMin);
+		boundsMax = glm::max(boundsMax, mesh.boundsMax);
+	}
+	sphereCentre = (boundsMin + boundsMax) * 0.5f;
+	sphereRadius = glm::length(boundsMax - boundsMin) * 0.5f;
+}
+
+void Model::setInstances(const std::vector<glm::mat4>& locations)
+{
+	this->locations = locations;
+
+	if (instanceBuffer == 0) {
+		glGenBuffers(1, &instanceBuffer);
+	}
+	glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+	// Rewritten in level order by selectLod whenever an instance changes level
+	glBufferData(GL_ARRAY_BUFFER, locations.size() * sizeof(glm::mat4), locations.data(), GL_DYNAMIC_DRAW);
+	sortedLocations = locations;
+	instanceLods.assign(locations.size(), 0);
+	std::fill(std::begin(lodInstanceCounts), std::end(lodInstanceCounts), 0);
+	lodInstanceCounts[0] = (GLsizei)locations.size();
+
+	for (Mesh& mesh : meshes) {
+		setupInstanceAttributes(mesh);
+	}
+}
+
+void Model::selectLod(glm::vec3 cameraPosition, const glm::mat4& projection)
+{
+	lod = lodFor(location, cameraPosition, projection[1][1], lod);
+	if (locations.empty() || instanceBuffer == 0) {
+		return;
+	}
+
+	bool changed = false;
+	GLsizei counts[MESH_LOD_LEVELS] = {};
+	for (size_t i = 0; i < locations.size(); i++) {
+		const unsigned char level = (unsigned char)lodFor(locations[i], cameraPosition, projection[1][1], instanceLods[i]);
+		changed |= level != instanceLods[i];
+		instanceLods[i] = level;
+		counts[level]++;
+	}
+	if (!changed) {
+		return;
+	}
+
+	// Counting sort by level
+	size_t next[MESH_LOD_LEVELS];
+	size_t first = 0;
+	for (int level = 0; level < MESH_LOD_LEVELS; level++) {
+		next[level] = first;
+		first += counts[level];
+		lodInstanceCounts[level] = counts[level];
+	}
+	for (size_t i = 0; i < locations.size(); i++) {
+		sortedLocations[next[instanceLods[i]]++] = locations[i];
+	}
+	glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+	glBufferSubData(GL_ARRAY_BUFFER, 0, sortedLocations.size() * sizeof(glm::mat4), sortedLocations.data());
+}
+
+void Model::cull(glm::vec3 cameraPosition, const glm::mat4& viewProjection)
+{
+	// A location that flattens the model leaves nothing to cull
+	const float determinant = glm::determinant(glm::mat3(location));
+	if (lod != 0 || determinant == 0.0f) {
+		return;
+	}
+
+	// Both tests are exact in model space, which saves transforming every meshlet
+	glm::vec4 planes[6];
+	frustumPlanes(viewProjection * location, planes);
+	const glm::vec3 modelCamera = glm::vec3(glm::inverse(location) * glm::vec4(cameraPosition, 1.0f));
+	// A mirroring location turns the winding over, and GL culls the other faces
+	const bool cones = determinant > 0.0f;
+	for (Mesh& mesh : meshes) {
+		mesh.cullMeshlets(modelCamera, planes, cones);
+	}
+}
+
+int Model::lodFor(const glm::mat4& transform, glm::vec3 cameraPosition, float projectionScale, int current) const
+{
+	const glm::vec3 centre = glm::vec3(transform * glm::vec4(sphereCentre, 1.0f));
+	const float scale = std::max(std::max(glm::length(glm::vec3(transform[0])), glm::length(glm::vec3(transform[1]))),
+		glm::length(glm::vec3(transform[2])));
+	const float radius = sphereRadius * scale;
+	const float distance = glm::distance(cameraPosition, centre);
+	if (distance <= radius) {
+		return 0;
+	}
+
+	// Share of the screen height the sphere covers. Inside the band around a threshold the
+	// current level stays.
+	const float size = radius * projectionScale / distance;
+	const int finest = lodForSize(size * (1.0f + lodHysteresis));
+	const int coarsest = lodForSize(size * (1.0f - lodHysteresis));
+	return std::min(std::max(current, finest), coarsest);
+}
+
+int Model::lodForSize(float size) const
+{
+	int level = 0;
+	for (float threshold = lodScreenSize; level + 1 < MESH_LOD_LEVELS && size < threshold; threshold *= 0.5f) {
+		level++;
+	}
+	return level;
+}
+
+void Model::setupInstanceAttributes(Mesh& mesh, size_t firstInstance)
+{
+	const size_t offset = firstInstance * sizeof(glm::mat4);
+	glBindVertexArray(mesh.VAO);
+	glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+	// set attribute pointers for matrix (4 times vec4)
+	glEnableVertexAttribArray(3);
+	glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void*)offset);
+	glEnableVertexAttribArray(4);
+	glVertexAttribPointer(4, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void*)(offset + sizeof(glm::vec4)));
+	glEnableVertexAttribArray(5);
+	glVertexAttribPointer(5, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void*)(offset + 2 * sizeof(glm::vec4)));
+	glEnableVertexAttribArray(6);
+	glVertexAttribPointer(6, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void*)(offset + 3 * sizeof(glm::vec4)));
+
+	glVertexAttribDivisor(3, 1);
+	glVertexAttribDivisor(4, 1);
+	glVertexAttribDivisor(5, 1);
+	glVertexAttribDivisor(6, 1);
+
+	glBindVertexArray(0);
+}
+
+bool Model::importMeshes(Assimp::Importer& importer, const std::string& path, std::vector<MeshData>& meshes, unsigned int optimizeFlags)
+{
+	const aiScene* scene = importer.ReadFile(path, MODEL_IMPORT_FLAGS);
 
 	if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) {
-		std::cout << "ERROR::ASSIMP::" << import.GetErrorString() << std::endl;
+		std::cout << "ERROR::ASSIMP::" << importer.GetErrorString() << std::endl;
+		return false;
 	}
-	directory = path.substr(0, path.find_last_of('\\'));
 
-	processNode(scene->mRootNode, scene);
+	processNode(scene->mRootNode, scene, meshes);
+	importer.FreeScene();
+	for (MeshData& mesh : meshes) {
+		optimizeMesh(mesh, optimizeFlags);
+	}
+	return true;
 }
 
-void Model::processNode(aiNode* node, const aiScene* scene)
+void Model::processNode(aiNode* node, const aiScene* scene, std::vector<MeshData>& meshes)
 {
 	for (unsigned int i = 0; i < node->mNumMeshes; i++) {
 		aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
@@ -71,15 +432,15 @@ void Model::processNode(aiNode* node, const aiScene* scene)
 	}
 
 	for (unsigned int i = 0; i < node->mNumChildren; i++) {
-		processNode(node->mChildren[i], scene);
+		processNode(node->mChildren[i], scene, meshes);
 	}
 }
 
-Mesh Model::processMesh(aiMesh* mesh, const aiScene* scene)
+MeshData Model::processMesh(aiMesh* mesh, const aiScene* scene)
 {
 	std::vector<Vertex> vertices;
 	std::vector<unsigned int> indices;
-	std::vector<Texture> textures;
+	std::vector<MeshTextureRef> textures;
 
 	// process vertices
 	for (unsigned int i = 0; i < mesh->mNumVertices; i++) {
@@ -122,9 +483,9 @@ Mesh Model::processMesh(aiMesh* mesh, const aiScene* scene)
 	// process material
 	if (mesh->mMaterialIndex >= 0) {
 		aiMaterial* material = scene->mMaterials[mesh->mMaterialIndex];
-		std::vector<Texture> diffuseMaps = loadMaterialTextures(material, aiTextureType_DIFFUSE, "texture_diffuse");
+		std::vector<MeshTextureRef> diffuseMaps = materialTextures(material, aiTextureType_DIFFUSE, "texture_diffuse");
 		textures.insert(textures.end(), diffuseMaps.begin(), diffuseMaps.end());
-		std::vector<Texture> specularMaps = loadMaterialTextures(material, aiTextureType_SPECULAR, "texture_specular");
+		std::vector<MeshTextureRef> specularMaps = materialTextures(material, aiTextureType_SPECULAR, "texture_specular");
 		textures.insert(textures.end(), specularMaps.begin(), specularMaps.end());
 
 		aiColor3D color(0.f, 0.f, 0.f);
@@ -141,36 +502,43 @@ Mesh Model::processMesh(aiMesh* mesh, const aiScene* scene)
 		//}
 	}
 
-	return Mesh(vertices, indices, textures, colors_loaded);
+	MeshData data;
+	data.vertices = std::move(vertices);
+	data.indices = std::move(indices);
+	data.textures = std::move(textures);
+	data.color = colors_loaded;
+	data.importedVertexCount = (unsigned int)data.vertices.size();
+	meshBounds(data.vertices, data.boundsMin, data.boundsMax);
+	return data;
 }
 
-std::vector<Texture> Model::loadMaterialTextures(aiMaterial* mat, aiTextureType type, std::string typeName)
+std::vector<MeshTextureRef> Model::materialTextures(aiMaterial* mat, aiTextureType type, std::string typeName)
 {
-	std::vector<Texture> textures;
+	std::vector<MeshTextureRef> textures;
 	//std::cout << mat->GetTextureCount(type) << "\n";
 	for (unsigned int i = 0; i < mat->GetTextureCount(type); i++) {
 		aiString str;
 		mat->GetTexture(type, i, &str);
+		textures.push_back({ typeName, str.C_Str() });
+	}
+	return textures;
+}
 
-		bool skip = false;
-		for (unsigned int j = 0; j < textures_loaded.size(); j++) {
-			if (std::strcmp(textures_loaded[j].path.data(), str.C_Str()) == 0) {
-				textures.push_back(textures_loaded[j]);
-				skip = true;
-				break;
-			}
-		}
-
-		if (!skip) {
-			Texture texture;
-			texture.id = TextureFromFile(str.C_Str(), directory);
-			texture.type = typeName;
-			texture.path = str.C_Str();
-			textures.push_back(texture);
-			textures_loaded.push_back(texture);  // store it as texture loaded for entire model, to ensure we won't unnecessary load duplicate textures.
+Texture Model::loadTexture(const std::string& type, const std::string& path, const ModelSource& source)
+{
+	for (unsigned int j = 0; j < textures_loaded.size(); j++) {
+		if (textures_loaded[j].path == path) {
+			return textures_loaded[j];
 		}
 	}
-	return textures;
+
+	Texture texture;
+	auto image = std::find_if(source.images.begin(), source.images.end(), [&path](const TextureImage& image) { return image.path == path; });
+	texture.id = image != source.images.end() ? TextureFromImage(*image) : TextureFromFile(path.c_str(), directory);
+	texture.type = type;
+	texture.path = path;
+	textures_loaded.push_back(texture);  // store it as texture loaded for entire model, to ensure we won't unnecessary load duplicate textures.
+	return texture;
 }
 
 unsigned int TextureFromFile(const char* filePath, const std::string& directory)
@@ -179,7 +547,24 @@ unsigned int TextureFromFile(const char* filePath, const std::string& directory)
 	filename = directory + '\\' + filename;
 	std::cout << filename << "\n";
 
-	int width, height, nrChannels;
+	TextureImage image;
+	decodeTexture(filename, image);
+	return TextureFromImage(image);
+}
+
+bool decodeTexture(const std::string& filename, TextureImage& image)
+{
+	//stbi_set_flip_vertically_on_load(true);
+	unsigned char* data = stbi_load(filename.c_str(), &image.width, &image.height, &image.channels, 0);
+	if (data) {
+		image.pixels.assign(data, data + (size_t)image.width * image.height * image.channels);
+	}
+	stbi_image_free(data);
+	return !image.pixels.empty();
+}
+
+unsigned int TextureFromImage(const TextureImage& image)
+{
 	unsigned int textureID;
 	glGenTextures(1, &textureID);
 	glBindTexture(GL_TEXTURE_2D, textureID);
@@ -190,11 +575,9 @@ unsigned int TextureFromFile(const char* filePath, const std::string& directory)
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
 
-	//stbi_set_flip_vertically_on_load(true);
-	unsigned char* data = stbi_load(filename.c_str(), &width, &height, &nrChannels, 0);
-	if (data) {
+	if (!image.pixels.empty()) {
 		GLenum format = GL_RGB;
-		switch (nrChannels) {
+		switch (image.channels) {
 		case 1:
 			format = GL_RED;
 			break;
@@ -209,14 +592,12 @@ unsigned int TextureFromFile(const char* filePath, const std::string& directory)
 			break;
 		}
 
-		glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
+		glTexImage2D(GL_TEXTURE_2D, 0, format, image.width, image.height, 0, format, GL_UNSIGNED_BYTE, image.pixels.data());
 		glGenerateMipmap(GL_TEXTURE_2D);
-		stbi_image_free(data);
 	}
 	else {
 		std::cout << "Failed to load texture" << std::endl;
-		stbi_image_free(data);
 	}
 
 	return textureID;
-}
\ No newline at end of file
+}
@@ -0,0 +1,261 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <assimp/Importer.hpp>
+
+#include "mappedfile.h"
+#include "meshcache.h"
+#include "model.h"
+#include "threadpool.h"
+
+// Loads models on a thread pool. Every model is read and its textures decoded on the pool, each
+// worker with its own Assimp::Importer, and finished reads queue up for the GL thread, which
+// creates their GL objects. GL calls never leave that thread, and it must not be one of the pool's.
+// loadAll blocks until everything is uploaded; loadAsync returns at once and update uploads a
+// little every frame.
+class ModelLoader {
+public:
+    explicit ModelLoader(ThreadPool& pool = ThreadPool::shared(), const std::string& cacheDirectory = "cache");
+    // Waits for reads still running on the pool
+    ~ModelLoader();
+
+    // Vertex, index and texture bytes update uploads per call; it always uploads at least one mesh
+    size_t uploadBytesPerFrame = 4u * 1024 * 1024;
+
+    ModelLoader(const ModelLoader&) = delete;
+    ModelLoader& operator=(const ModelLoader&) = delete;
+
+    // Models in the same order as paths; a model that failed to load has no meshes
+    std::vector<std::unique_ptr<Model>> loadAll(const std::vector<std::string>& paths);
+
+    // Reads every path on the pool and calls ready on this thread for each finished source, in
+    // the order they finish. Returns the number that could not be read.
+    size_t readAll(const std::vector<std::string>& paths, const std::function<void(size_t index, ModelSource& source)>& ready);
+
+    // Every file in directory ending with extension, for loadAll
+    static std::vector<std::string> directoryPaths(const std::string& directory, const std::string& extension);
+
+    // A model with no meshes, which draws nothing until update has uploaded all of them.
+    // It stays empty if the file cannot be read.
+    std::shared_ptr<Model> loadAsync(const std::string& path);
+    // Uploads finished loadAsync reads within uploadBytesPerFrame; call once per frame
+    void update();
+    // loadAsync models that are not drawable yet
+    size_t loading() const;
+
+private:
+    struct Finished {
+        size_t index;
+        bool read;
+        std::unique_ptr<ModelSource> source;
+    };
+
+    struct AsyncLoad {
+        std::shared_ptr<Model> model;
+        bool read;
+        std::unique_ptr<ModelSource> source;
+        size_t nextMesh = 0;
+        std::vector<Mesh> created;
+    };
+
+    ThreadPool& pool;
+    std::string cacheDirectory;
+
+    std::mutex mutex;
+    std::condition_variable finishedCondition;
+    std::queue<Finished> finished;
+    std::queue<AsyncLoad> arrived;
+    // Tasks submitted and not yet finished
+    size_t reading = 0;
+
+    // Only touched on the GL thread
+    std::deque<AsyncLoad> uploading;
+    size_t asyncLoads = 0;
+
+    bool readSource(const std::string& path, ModelSource& source);
+    static Assimp::Importer& workerImporter();
+    // Prints how much smaller the model's buffers are than the meshes as imported
+    static void reportMemory(const std::string& path, const Model& model);
+};
+
+inline ModelLoader::ModelLoader(ThreadPool& pool, const std::string& cacheDirectory)
+    : pool(pool), cacheDirectory(cacheDirectory)
+{
+}
+
+inline ModelLoader::~ModelLoader()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    finishedCondition.wait(lock, [this]() { return reading == 0; });
+}
+
+inline std::vector<std::unique_ptr<Model>> ModelLoader::loadAll(const std::vector<std::string>& paths)
+{
+    std::vector<std::unique_ptr<Model>> models(paths.size());
+    readAll(paths, [&models](size_t index, ModelSource& source) {
+        models[index] = std::make_unique<Model>();
+        models[index]->createMeshes(source);
+        reportMemory(source.path, *models[index]);
+    });
+
+    for (auto& model : models) {
+        if (!model) {
+            model = std::make_unique<Model>();
+        }
+    }
+    return models;
+}
+
+inline size_t ModelLoader::readAll(const std::vector<std::string>& paths, const std::function<void(size_t index, ModelSource& source)>& ready)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        reading += paths.size();
+    }
+    for (size_t i = 0; i < paths.size(); i++) {
+        const std::string path = paths[i];
+        pool.submit([this, i, path]() {
+            Finished result;
+            result.index = i;
+            result.source = std::make_unique<ModelSource>();
+            result.read = readSource(path, *result.source);
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                finished.push(std::move(result));
+                reading--;
+            }
+            finishedCondition.notify_all();
+        });
+    }
+
+    size_t failures = 0;
+    for (size_t done = 0; done < paths.size(); done++) {
+        Finished result;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            finishedCondition.wait(lock, [this]() { return !finished.empty(); });
+            result = std::move(finished.front());
+            finished.pop();
+        }
+
+        if (result.read) {
+            ready(result.index, *result.source);
+        }
+        else {
+            failures++;
+        }
+    }
+    return failures;
+}
+
+inline std::shared_ptr<Model> ModelLoader::loadAsync(const std::string& path)
+{
+    std::shared_ptr<Model> model = std::make_shared<Model>();
+    asyncLoads++;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        reading++;
+    }
+
+    pool.submit([this, model, path]() {
+        AsyncLoad result;
+        result.model = model;
+        result.source = std::make_unique<ModelSource>();
+        result.read = readSource(path, *result.source);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            arrived.push(std::move(result));
+            reading--;
+        }
+        finishedCondition.notify_all();
+    });
+    return model;
+}
+
+inline void ModelLoader::update()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        while (!arrived.empty()) {
+            uploading.push_back(std::move(arrived.front()));
+            arrived.pop();
+        }
+    }
+
+    // Oldest first, one mesh at a time, so one big model cannot hold back the frame
+    size_t uploaded = 0;
+    while (!uploading.empty() && (uploaded == 0 || uploaded < uploadBytesPerFrame)) {
+        AsyncLoad& load = uploading.front();
+        const size_t meshes = load.read ? Model::meshCount(*load.source) : 0;
+
+        if (load.nextMesh < meshes) {
+            // The textures go up with the first mesh, which is the first to need them
+            if (load.nextMesh == 0) {
+                for (const TextureImage& image : load.source->images) {
+                    uploaded += image.pixels.size();
+                }
+            }
+            uploaded += Model::meshBytes(*load.source, load.nextMesh);
+            load.created.push_back(load.model->createMesh(*load.source, load.nextMesh++));
+        }
+
+        if (load.nextMesh == meshes) {
+            load.model->addMeshes(std::move(load.created));
+            if (load.read) {
+                reportMemory(load.source->path, *load.model);
+            }
+            uploading.pop_front();
+            asyncLoads--;
+        }
+    }
+}
+
+inline size_t ModelLoader::loading() const
+{
+    return asyncLoads;
+}
+
+inline bool ModelLoader::readSource(const std::string& path, ModelSource& source)
+{
+    if (!Model::readModel(workerImporter(), path, cacheDirectory, source)) {
+        return false;
+    }
+    Model::decodeTextures(source);
+    return true;
+}
+
+inline std::vector<std::string> ModelLoader::directoryPaths(const std::string& directory, const std::string& extension)
+{
+    std::vector<std::string> paths;
+    for (const std::string& name : listFiles(directory, extension)) {
+        paths.push_back(directory + '\\' + name);
+    }
+    return paths;
+}
+
+inline void ModelLoader::reportMemory(const std::string& path, const Model& model)
+{
+    if (model.importedBytes == 0) {
+        return;
+    }
+    std::cout << "Loaded " << path << ": " << model.bufferBytes / 1024 << " KB of buffers, "
+        << model.importedBytes / 1024 << " KB as imported, saved "
+        << 100 - (int) (100 * model.bufferBytes / model.importedBytes) << "%" << std::endl;
+}
+
+inline Assimp::Importer& ModelLoader::workerImporter()
+{
+    // An importer keeps its last scene and is not thread safe, so every thread gets one
+    thread_local Assimp::Importer importer;
+    return importer;
+}
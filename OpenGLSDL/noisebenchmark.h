@@ -0,0 +1,368 @@
+#pragma once
+
+#include <chrono>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "FastNoiseLite.h"
+#include "threadpool.h"
+
+// Run with --noise-benchmark [file] to write FastNoiseLite throughput as JSON instead of opening
+// the window; without a file it goes to stdout. Every case fills the same grid of samples, one
+// row per work item, so the scalar, sampler and grid paths and the thread counts compare directly.
+
+constexpr int NOISE_BENCHMARK_SIDE_2D = 512;
+constexpr int NOISE_BENCHMARK_SIDE_3D = 64;
+
+struct NoiseBenchmarkResult {
+    std::string kind;
+    std::string noiseType;
+    std::string fractalType;
+    std::string domainWarpType;
+    int dimensions;
+    std::string precision;
+    std::string path;
+    unsigned int threads;
+    size_t samples;
+    double seconds;
+};
+
+class NoiseBenchmark {
+public:
+    NoiseBenchmark();
+
+    void run();
+    void writeJson(std::ostream& out) const;
+
+private:
+    std::vector<NoiseBenchmarkResult> results;
+    std::unique_ptr<ThreadPool> pool;
+    std::vector<float> output;
+
+    void noiseCases(FastNoiseLite noise, const char* noiseName, const char* fractalName);
+    void warpCases(FastNoiseLite noise, const char* warpName, const char* fractalName);
+    template <typename FNfloat>
+    void noisePaths(const FastNoiseLite& noise, const NoiseBenchmarkResult& labels);
+    template <typename FNfloat>
+    void warpPaths(const FastNoiseLite& noise, const NoiseBenchmarkResult& labels);
+    // Times row(first, last) over every row, once on this thread and once on the pool
+    void measure(NoiseBenchmarkResult labels, int rows, int samplesPerRow, const std::function<void(int, int)>& row);
+
+    static const char* precisionName(float) { return "float"; }
+    static const char* precisionName(double) { return "double"; }
+};
+
+inline NoiseBenchmark::NoiseBenchmark()
+{
+    // A single hardware thread has nothing to compare against
+    if (std::thread::hardware_concurrency() > 1) {
+        pool.reset(new ThreadPool());
+    }
+    output.resize((size_t) NOISE_BENCHMARK_SIDE_2D * NOISE_BENCHMARK_SIDE_2D);
+}
+
+inline void NoiseBenchmark::run()
+{
+    const struct { FastNoiseLite::NoiseType type; const char* name; } noiseTypes[] = {
+        { FastNoiseLite::NoiseType_OpenSimplex2, "OpenSimplex2" },
+        { FastNoiseLite::NoiseType_OpenSimplex2S, "OpenSimplex2S" },
+        { FastNoiseLite::NoiseType_Cellular, "Cellular" },
+        { FastNoiseLite::NoiseType_Perlin, "Perlin" },
+        { FastNoiseLite::NoiseType_ValueCubic, "ValueCubic" },
+        { FastNoiseLite::NoiseType_Value, "Value" },
+    };
+    // The domain warp fractal types only change DomainWarp, so they are measured with the warps
+    const struct { FastNoiseLite::FractalType type; const char* name; } fractalTypes[] = {
+        { FastNoiseLite::FractalType_None, "None" },
+        { FastNoiseLite::FractalType_FBm, "FBm" },
+        { FastNoiseLite::FractalType_Ridged, "Ridged" },
+        { FastNoiseLite::FractalType_PingPong, "PingPong" },
+    };
+    const struct { FastNoiseLite::DomainWarpType type; const char* name; } warpTypes[] = {
+        { FastNoiseLite::DomainWarpType_OpenSimplex2, "OpenSimplex2" },
+        { FastNoiseLite::DomainWarpType_OpenSimplex2Reduced, "OpenSimplex2Reduced" },
+        { FastNoiseLite::DomainWarpType_BasicGrid, "BasicGrid" },
+    };
+    const struct { FastNoiseLite::FractalType type; const char* name; } warpFractalTypes[] = {
+        { FastNoiseLite::FractalType_None, "None" },
+        { FastNoiseLite::FractalType_DomainWarpProgressive, "DomainWarpProgressive" },
+        { FastNoiseLite::FractalType_DomainWarpIndependent, "DomainWarpIndependent" },
+    };
+
+    for (const auto& noiseType : noiseTypes) {
+        for (const auto& fractalType : fractalTypes) {
+            FastNoiseLite noise;
+            noise.SetNoiseType(noiseType.type);
+            noise.SetFractalType(fractalType.type);
+            noise.SetFractalOctaves(5);
+            noiseCases(noise, noiseType.name, fractalType.name);
+        }
+    }
+
+    for (const auto& warpType : warpTypes) {
+        for (const auto& fractalType : warpFractalTypes) {
+            FastNoiseLite noise;
+            noise.SetNoiseType(FastNoiseLite::NoiseType_Value);
+            noise.SetFractalType(fractalType.type);
+            noise.SetFractalOctaves(5);
+            noise.SetDomainWarpType(warpType.type);
+            noise.SetDomainWarpAmp(30.0f);
+            warpCases(noise, warpType.name, fractalType.name);
+        }
+    }
+}
+
+inline void NoiseBenchmark::noiseCases(FastNoiseLite noise, const char* noiseName, const char* fractalName)
+{
+    NoiseBenchmarkResult labels{ "noise", noiseName, fractalName, "", 0, "", "", 0, 0, 0.0 };
+
+    for (int dimensions = 2; dimensions <= 3; dimensions++) {
+        labels.dimensions = dimensions;
+        noisePaths<float>(noise, labels);
+        noisePaths<double>(noise, labels);
+    }
+}
+
+inline void NoiseBenchmark::warpCases(FastNoiseLite noise, const char* warpName, const char* fractalName)
+{
+    // Domain warp fractal types leave GetNoise unfractalled, so the warped noise rows use Value noise as is
+    NoiseBenchmarkResult labels{ "domainWarp", "Value", fractalName, warpName, 0, "", "", 0, 0, 0.0 };
+
+    for (int dimensions = 2; dimensions <= 3; dimensions++) {
+        labels.dimensions = dimensions;
+        warpPaths<float>(noise, labels);
+        warpPaths<double>(noise, labels);
+    }
+}
+
+template <typename FNfloat>
+void NoiseBenchmark::noisePaths(const FastNoiseLite& noise, const NoiseBenchmarkResult& labels)
+{
+    NoiseBenchmarkResult result = labels;
+    result.precision = precisionName(FNfloat());
+    float* out = output.data();
+
+    if (labels.dimensions == 2) {
+        const int side = NOISE_BENCHMARK_SIDE_2D;
+
+        result.path = "scalar";
+        measure(result, side, side, [&](int first, int last) {
+            for (int j = first; j < last; j++) {
+                for (int i = 0; i < side; i++) {
+                    out[j * side + i] = noise.GetNoise((FNfloat) i, (FNfloat) j);
+                }
+            }
+        });
+
+        result.path = "grid";
+        measure(result, side, side, [&](int first, int last) {
+            noise.GetNoiseGrid2D(out + first * side, side, last - first, (FNfloat) 0, (FNfloat) 0, (FNfloat) 1, (FNfloat) 1, 1, side, 0, first);
+        });
+
+        if (std::is_same<FNfloat, float>::value) {
+            const FastNoiseLite::Sampler sampler = noise.GetSampler();
+
+            result.path = "sampler";
+            measure(result, side, side, [&](int first, int last) {
+                for (int j = first; j < last; j++) {
+                    for (int i = 0; i < side; i++) {
+                        out[j * side + i] = sampler.GetNoise((float) i, (float) j);
+                    }
+                }
+            });
+
+            result.path = "samplerGrid";
+            measure(result, side, side, [&](int first, int last) {
+                sampler.GetNoiseGrid2D(out + first * side, side, last - first, 0.0f, 0.0f, 1.0f, 1.0f, 1, side, 0, first);
+            });
+        }
+    }
+    else {
+        // Rows run along x, one per (y, z)
+        const int side = NOISE_BENCHMARK_SIDE_3D;
+
+        result.path = "scalar";
+        measure(result, side * side, side, [&](int first, int last) {
+            for (int row = first; row < last; row++) {
+                for (int i = 0; i < side; i++) {
+                    out[row * side + i] = noise.GetNoise((FNfloat) i, (FNfloat) (row % side), (FNfloat) (row / side));
+                }
+            }
+        });
+
+        result.path = "grid";
+        measure(result, side * side, side, [&](int first, int last) {
+            for (int row = first; row < last; row++) {
+                noise.GetNoiseGrid3D(out + row * side, side, 1, 1, (FNfloat) 0, (FNfloat) 0, (FNfloat) 0, (FNfloat) 1, (FNfloat) 1, (FNfloat) 1,
+                    1, 0, 0, 0, row % side, row / side);
+            }
+        });
+
+        if (std::is_same<FNfloat, float>::value) {
+            const FastNoiseLite::Sampler sampler = noise.GetSampler();
+
+            result.path = "sampler";
+            measure(result, side * side, side, [&](int first, int last) {
+                for (int row = first; row < last; row++) {
+                    for (int i = 0; i < side; i++) {
+                        out[row * side + i] = sampler.GetNoise((float) i, (float) (row % side), (float) (row / side));
+                    }
+                }
+            });
+
+            result.path = "samplerGrid";
+            measure(result, side * side, side, [&](int first, int last) {
+                for (int row = first; row < last; row++) {
+                    sampler.GetNoiseGrid3D(out + row * side, side, 1, 1, 0.0f, 0.0f, 0.0f, 1.0f, 1.0f, 1.0f,
+                        1, 0, 0, 0, row % side, row / side);
+                }
+            });
+        }
+    }
+}
+
+template <typename FNfloat>
+void NoiseBenchmark::warpPaths(const FastNoiseLite& noise, const NoiseBenchmarkResult& labels)
+{
+    NoiseBenchmarkResult result = labels;
+    result.precision = precisionName(FNfloat());
+    float* out = output.data();
+
+    if (labels.dimensions == 2) {
+        const int side = NOISE_BENCHMARK_SIDE_2D;
+
+        result.path = "scalar";
+        measure(result, side, side, [&](int first, int last) {
+            for (int j = first; j < last; j++) {
+                for (int i = 0; i < side; i++) {
+                    FNfloat x = (FNfloat) i;
+                    FNfloat y = (FNfloat) j;
+                    noise.DomainWarp(x, y);
+                    out[j * side + i] = (float) (x + y);
+                }
+            }
+        });
+
+        // Warp followed by the noise, against the fused grid
+        result.kind = "warpedNoise";
+        result.path = "scalar";
+        measure(result, side, side, [&](int first, int last) {
+            for (int j = first; j < last; j++) {
+                for (int i = 0; i < side; i++) {
+                    out[j * side + i] = noise.GetWarpedNoise((FNfloat) i, (FNfloat) j);
+                }
+            }
+        });
+
+        result.path = "grid";
+        measure(result, side, side, [&](int first, int last) {
+            noise.GetWarpedNoiseGrid2D(out + first * side, side, last - first, (FNfloat) 0, (FNfloat) 0, (FNfloat) 1, (FNfloat) 1, 1, side, 0, first);
+        });
+    }
+    else {
+        const int side = NOISE_BENCHMARK_SIDE_3D;
+
+        result.path = "scalar";
+        measure(result, side * side, side, [&](int first, int last) {
+            for (int row = first; row < last; row++) {
+                for (int i = 0; i < side; i++) {
+                    FNfloat x = (FNfloat) i;
+                    FNfloat y = (FNfloat) (row % side);
+                    FNfloat z = (FNfloat) (row / side);
+                    noise.DomainWarp(x, y, z);
+                    out[row * side + i] = (float) (x + y + z);
+                }
+            }
+        });
+    }
+}
+
+inline void NoiseBenchmark::measure(NoiseBenchmarkResult labels, int rows, int samplesPerRow, const std::function<void(int, int)>& row)
+{
+    labels.samples = (size_t) rows * samplesPerRow;
+
+    // Warm up the lookup tables and the output buffer
+    row(0, 1);
+
+    auto start = std::chrono::steady_clock::now();
+    row(0, rows);
+    labels.threads = 1;
+    labels.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    results.push_back(labels);
+
+    if (pool) {
+        start = std::chrono::steady_clock::now();
+        pool->parallelFor(0, rows, row);
+        labels.threads = pool->size();
+        labels.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        results.push_back(labels);
+    }
+}
+
+inline void NoiseBenchmark::writeJson(std::ostream& out) const
+{
+#if defined(FASTNOISELITE_SIMD_AVX2)
+    const char* simd = "avx2";
+#elif defined(FASTNOISELITE_SIMD_SSE41)
+    const char* simd = "sse4.1";
+#else
+    const char* simd = "none";
+#endif
+
+    out << "{\n"
+        << "  \"benchmark\": \"FastNoiseLite\",\n"
+        << "  \"simd\": \"" << simd << "\",\n"
+        << "  \"hardwareThreads\": " << std::thread::hardware_concurrency() << ",\n"
+        << "  \"results\": [\n";
+
+    for (size_t i = 0; i < results.size(); i++) {
+        const NoiseBenchmarkResult& result = results[i];
+        const double samplesPerSecond = result.seconds > 0.0 ? result.samples / result.seconds : 0.0;
+
+        out << "    { \"kind\": \"" << result.kind << "\""
+            << ", \"noiseType\": \"" << result.noiseType << "\""
+            << ", \"fractalType\": \"" << result.fractalType << "\"";
+        if (!result.domainWarpType.empty()) {
+            out << ", \"domainWarpType\": \"" << result.domainWarpType << "\"";
+        }
+        out << ", \"dimensions\": " << result.dimensions
+            << ", \"precision\": \"" << result.precision << "\""
+            << ", \"path\": \"" << result.path << "\""
+            << ", \"threads\": " << result.threads
+            << ", \"samples\": " << result.samples
+            << std::fixed << std::setprecision(1)
+            << ", \"samplesPerSecond\": " << samplesPerSecond
+            << std::setprecision(3)
+            << ", \"nsPerSample\": " << result.seconds * 1e9 / result.samples
+            << std::defaultfloat << " }" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+
+    out << "  ]\n}\n";
+}
+
+// path empty writes to stdout
+inline bool runNoiseBenchmark(const std::string& path)
+{
+    NoiseBenchmark benchmark;
+    benchmark.run();
+
+    if (path.empty()) {
+        benchmark.writeJson(std::cout);
+        return true;
+    }
+
+    std::ofstream file(path);
+    benchmark.writeJson(file);
+    if (!file) {
+        std::cout << "Failed to write " << path << std::endl;
+        return false;
+    }
+    return true;
+}
@@ -12,4 +12,8 @@ public:
 	int instanceNo;
 
 	virtual void Draw(Shader&) = 0;
+	// Picks the detail level Draw uses from where the camera is; most objects only have one
+	virtual void selectLod(glm::vec3 cameraPosition, const glm::mat4& projection) {}
+	// Drops what Draw would not see from the camera; most objects draw everything
+	virtual void cull(glm::vec3 cameraPosition, const glm::mat4& viewProjection) {}
 };
\ No newline at end of file
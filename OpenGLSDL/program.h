@@ -15,9 +15,11 @@
 #include "shader.h"
 #include "camera.h"
 #include "model.h"
+#include "modelloader.h"
 #include "world.h"
 #include "shape.h"
 #include "skybox.h"
+#include "terrain.h"
 #include <random>
 
 constexpr int WINDOW_WIDTH = 800;
@@ -45,6 +47,7 @@ private:
     Shader shaderLight{};
     Shader skyboxShader{};
     Shader instanceShader{};
+    Shader terrainShader{};
 
     Camera camera;
 
@@ -52,9 +55,11 @@ private:
     uint64_t lastFrame = 0;
 
     Skybox skybox;
+    Terrain terrain;
     World world;
     World instancedWorld;
     Model tree;
+    ModelLoader modelLoader;
 };
 
 inline int Program::init()
@@ -77,30 +82,29 @@ inline int Program::init()
     shaderProgram = Shader("shader.vert", "shader.frag");
     skyboxShader = Shader("skyboxShader.vert", "skyboxShader.frag");
     instanceShader = Shader("instanceShader.vert", "instanceShader.frag");
+    terrainShader = Shader("terrainShader.vert", "shader.frag");
 
-    auto plane = std::make_unique<Shape>();
-    glm::mat4 planeLocation = glm::mat4(1.0f);
-    //planeLocation = glm::translate(planeLocation, glm::vec3(-250.0f, -2.0f, -250.0f));
-
-
-    int planeWidth = 100;
-    int planeHeight = 100;
-    plane->generatePlane(100, 100, 0.1f);
-
-    auto tree = std::make_unique<Model>("asset\\tree\\tree_oak.obj");
+    // Terrain tiles stream in from Program::loop, so nothing is generated up front
+    // Loads in the background; the trees appear once it is uploaded
+    auto tree = modelLoader.loadAsync("asset\\tree\\tree_oak.obj");
 
+    // The first randomPoint waits for the terrain erosion, so the trees stand on the eroded ground
     std::vector<glm::mat4> treeLocations;
     for (int i = 0; i < 1000; i++) {
         glm::mat4 treeLocation = glm::mat4(1.0f);
-        glm::vec3 randPoint = plane->randomPoint();
+        glm::vec3 randPoint = terrain.randomPoint(100.0f, 100.0f);
         treeLocation = glm::translate(treeLocation, randPoint);
         treeLocations.push_back(treeLocation);
     }
 
+    // Drawn on its own rather than instanced, so its meshlets are culled every frame
+    auto planet = modelLoader.loadAsync("asset\\planet\\planet.obj");
+    glm::mat4 planetLocation = glm::translate(glm::mat4(1.0f), glm::vec3(50.0f, terrain.heightAt(50.0f, 50.0f) + 10.0f, 50.0f));
+
     skybox = Skybox();
     skybox.generateSkybox();
-    world.addObject(std::move(plane), planeLocation);
     
+    world.addObject(std::move(planet), planetLocation);
     instancedWorld.addObject(std::move(tree), treeLocations);
 
     return 1;
@@ -149,6 +153,15 @@ inline void Program::handleKey()
     if (keystates[SDL_SCANCODE_SPACE]) {
         camera.processKeyboard(UP, deltaTime);
     }
+
+    // Terrain brushes below the camera
+    const glm::vec2 brushCenter(camera.Position.x, camera.Position.z);
+    if (keystates[SDL_SCANCODE_R]) {
+        terrain.raise(brushCenter, 2.0f, 0.002f * deltaTime);
+    }
+    if (keystates[SDL_SCANCODE_F]) {
+        terrain.lower(brushCenter, 2.0f, 0.002f * deltaTime);
+    }
 }
 
 inline void Program::handleMouse(float xrel, float yrel)
@@ -164,7 +177,7 @@ inline void Program::handleMouse(float y)
 void lightHelper(Shader& shaderProgram)
 {
     // directional light
-    shaderProgram.setValue("dirLight.direction", -0.2f, -1.0f, -0.3f);
+    shaderProgram.setValue("dirLight.direction", SUN_DIRECTION);
     shaderProgram.setValue("dirLight.ambient", 0.05f, 0.05f, 0.05f);
     shaderProgram.setValue("dirLight.diffuse", 0.4f, 0.4f, 0.4f);
     shaderProgram.setValue("dirLight.specular", 0.5f, 0.5f, 0.5f);
@@ -175,6 +188,11 @@ inline void Program::loop()
     // Handle player input
     handleKey();
 
+    modelLoader.update();
+
+    // Keep the camera above the ground
+    camera.Position.y = std::max(camera.Position.y, terrain.heightAt(camera.Position.x, camera.Position.z) + 0.2f);
+
     // Background clear
     glClearColor(0.9f, 0.5f, 0.5f, 1.0f);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
@@ -192,6 +210,11 @@ inline void Program::loop()
     skybox.Draw(skyboxShader);
 
 
+    world.selectLod(camera.Position, projection);
+    instancedWorld.selectLod(camera.Position, projection);
+    world.cull(camera.Position, projection * view);
+    instancedWorld.cull(camera.Position, projection * view);
+
     shaderProgram.use();
     lightHelper(shaderProgram);
 
@@ -202,6 +225,16 @@ inline void Program::loop()
     // draw main
     world.Draw(shaderProgram);
 
+    // draw terrain
+    terrainShader.use();
+    lightHelper(terrainShader);
+
+    terrainShader.setValue("view", view);
+    terrainShader.setValue("projection", projection);
+
+    terrain.update(camera.Position);
+    terrain.Draw(terrainShader);
+
     // draw meteorites
     instanceShader.use();
     lightHelper(instanceShader);
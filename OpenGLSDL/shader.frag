@@ -55,25 +55,28 @@ out vec4 FragColor;
 in vec3 Normal;
 in vec3 FragPos;
 in vec2 TexCoords;
+// Ambient occlusion and sun visibility, 1 where nothing is baked
+in vec2 Lighting;
 
 vec3 CalcDirLight(DirLight light, vec3 normal, vec3 viewDir);
-vec3 CalcDirLightSolid(DirLight light, vec3 normal, vec3 viewDir);
+vec3 CalcDirLightSolid(DirLight light, vec3 normal, vec3 viewDir, vec2 lighting);
 vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir);
 vec3 CalcSpotLight(SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir);
 
 void main()
 {
     // properties 
-    vec3 norm = normalize(Normal);
+    // Terrain stored without normals leaves Normal at zero; light each triangle flat instead
+    vec3 norm = dot(Normal, Normal) > 0.0 ? normalize(Normal) : normalize(cross(dFdx(FragPos), dFdy(FragPos)));
     vec3 viewDir = normalize(viewPos - FragPos);
 
     // phase 1: Directional lighting
-    vec3 result = CalcDirLightSolid(dirLight, norm, viewDir);
+    vec3 result = CalcDirLightSolid(dirLight, norm, viewDir, Lighting);
     
     FragColor = vec4(result, 1.0);
 }
 
-vec3 CalcDirLightSolid(DirLight light, vec3 normal, vec3 viewDir)
+vec3 CalcDirLightSolid(DirLight light, vec3 normal, vec3 viewDir, vec2 lighting)
 {
     vec3 lightDir = normalize(-light.direction);
     // diffuse shading
@@ -82,9 +85,9 @@ vec3 CalcDirLightSolid(DirLight light, vec3 normal, vec3 viewDir)
     vec3 reflectDir = reflect(-lightDir, normal);
     float spec = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
     // combine results
-    vec3 ambient  = light.ambient  * material.color_diffuse;
-    vec3 diffuse  = light.diffuse  * diff * material.color_diffuse;
-    vec3 specular = light.specular * spec * material.color_specular;
+    vec3 ambient  = light.ambient  * material.color_diffuse * lighting.x;
+    vec3 diffuse  = light.diffuse  * diff * material.color_diffuse * lighting.y;
+    vec3 specular = light.specular * spec * material.color_specular * lighting.y;
     return (ambient + diffuse + specular);
 }  
 
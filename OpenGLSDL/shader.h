@@ -28,6 +28,9 @@ public:
     void setValue(const std::string& name, glm::mat4 value) const;
     void setValue(const std::string& name, glm::vec3 vec3) const;
     void setValue(const std::string& name, glm::vec2 vec2) const;
+    void setValue(const std::string& name, glm::ivec2 ivec2) const;
+    void setValue(const std::string& name, const glm::vec2* values, int count) const;
+    void setValue(const std::string& name, const glm::ivec2* values, int count) const;
     void setValue(const std::string& name, float v1, float v2, float v3) const;
 
 };
@@ -148,6 +151,21 @@ void Shader::setValue(const std::string& name, glm::vec2 vec2) const
     glUniform2fv(glGetUniformLocation(this->ID, name.c_str()), 1, vector2);
 }
 
+void Shader::setValue(const std::string& name, glm::ivec2 ivec2) const
+{
+    glUniform2i(glGetUniformLocation(this->ID, name.c_str()), ivec2.x, ivec2.y);
+}
+
+void Shader::setValue(const std::string& name, const glm::vec2* values, int count) const
+{
+    glUniform2fv(glGetUniformLocation(this->ID, name.c_str()), count, glm::value_ptr(values[0]));
+}
+
+void Shader::setValue(const std::string& name, const glm::ivec2* values, int count) const
+{
+    glUniform2iv(glGetUniformLocation(this->ID, name.c_str()), count, glm::value_ptr(values[0]));
+}
+
 void Shader::setValue(const std::string& name, float v1, float v2, float v3) const
 {
     float vector3[3] = { v1, v2, v3 };
@@ -8,14 +8,36 @@ uniform mat4 model;
 uniform mat4 view;
 uniform mat4 projection;
 
+// Quantized meshes: aPos is a fraction of the mesh bounds and aNormal.xy an oct-encoded normal,
+// see QuantizedVertex. Float meshes set a zero offset, a unit scale and no octNormals.
+uniform vec3 positionOffset;
+uniform vec3 positionScale;
+uniform bool octNormals;
+
 out vec3 Normal;
 out vec3 FragPos;
 out vec2 TexCoords;
+out vec2 Lighting;
+
+// Octahedron folded around +y, matching octEncodeNormal
+vec3 octDecode(vec2 e)
+{
+    vec3 n = vec3(e.x, 1.0 - abs(e.x) - abs(e.y), e.y);
+    if (n.y < 0.0) {
+        vec2 signs = vec2(n.x >= 0.0 ? 1.0 : -1.0, n.z >= 0.0 ? 1.0 : -1.0);
+        n.xz = (1.0 - abs(n.zx)) * signs;
+    }
+    return normalize(n);
+}
 
 void main()
 {
-    gl_Position = projection * view * model * vec4(aPos, 1.0);
-    FragPos = vec3(model * vec4(aPos, 1.0));
-    Normal = mat3(transpose(inverse(model))) * aNormal;  
+    vec3 position = positionOffset + aPos * positionScale;
+    vec3 normal = octNormals ? octDecode(aNormal.xy / 127.0) : aNormal;
+
+    gl_Position = projection * view * model * vec4(position, 1.0);
+    FragPos = vec3(model * vec4(position, 1.0));
+    Normal = mat3(transpose(inverse(model))) * normal;
     TexCoords = aTexCoords;
+    Lighting = vec2(1.0);
 } 
\ No newline at end of file
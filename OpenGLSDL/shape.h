@@ -3,26 +3,72 @@
 #include "glad/glad.h"
 #include "object.h"
 #include "FastNoiseLite.h"
+#include "erosion.h"
+#include "heightfield.h"
+#include "threadpool.h"
 
+#include <algorithm>
 #include <random>
 
 class Shape : public Object {
 public:
     
     unsigned int VAO{};
+    unsigned int VBO{};
+    unsigned int EBO{};
     unsigned int size{};
+    GLenum indexType = GL_UNSIGNED_INT;
+
+    int vertsPerRow{};
+    int vertsPerCol{};
+    float resolution{};
+    // Global grid index of vertex (0, 0); vertex (i, j) sits at ((firstColumn + i), (firstRow + j)) * resolution
+    int firstColumn{};
+    int firstRow{};
 
     std::vector<float> vertices;
     std::vector<unsigned int> indices;
+    // Row-major world heights, vertsPerRow * vertsPerCol
+    std::vector<float> heights;
+    // Applied by buildPlane. Terrain tiles are built with buildGrid alone, from heights Terrain
+    // erodes once for a whole region: eroding each tile on its own would tear the seams.
+    ErosionSettings erosion;
 
     std::mt19937 rng;
 
     Shape() : rng(std::random_device{}()) {}
     glm::vec3 randomPoint();
 	void generatePlane(int, int, float);
+    void generatePlane(int, int, float, ThreadPool&);
+    // CPU half of generatePlane, safe to call without a GL context
+    void buildPlane(int, int, float, ThreadPool&);
+    // Vertices of a window of the global vertex grid, used for terrain tiles. The heights are
+    // eroded with erosionSettings, if given, before the normals are computed.
+    void buildGrid(int vertsPerRow, int vertsPerCol, float resolution, ThreadPool&, int firstColumn = 0, int firstRow = 0,
+        const ErosionSettings* erosionSettings = nullptr);
+    // The same from heights already sampled: apronHeights points at vertex (0, 0) of rows pitch
+    // floats apart, with at least a one vertex apron on every side for the normals
+    void buildGrid(int vertsPerRow, int vertsPerCol, float resolution, ThreadPool&, int firstColumn, int firstRow,
+        const float* apronHeights, int pitch);
+    void buildIndices(ThreadPool&);
+    void setupPlane();
+    void deletePlane();
     void Draw(Shader& shader) override;
 };
 
+constexpr float TERRAIN_NOISE_SCALING = 0.12f;
+constexpr float TERRAIN_HEIGHT_SCALE = 7.5f;
+// Warp the terrain noise with the domain warp set up in noiseGen. Off by default: at its
+// amplitude the warp squeezes the finest octaves the grid keeps past its Nyquist limit in places,
+// where the central difference normals and the coarser LOD strides no longer follow the surface.
+constexpr bool TERRAIN_DOMAIN_WARP = false;
+// The noise is sampled from anchors this many vertices apart on each axis, so positions far from
+// the origin keep their precision; see FastNoiseLite::AxisAnchor
+constexpr int TERRAIN_NOISE_ANCHOR_SPACING = 256;
+// Noise stays within [-1, 1], so every terrain height lies in this range
+constexpr float TERRAIN_MIN_HEIGHT = (-1.0f + 0.5f) * TERRAIN_HEIGHT_SCALE;
+constexpr float TERRAIN_MAX_HEIGHT = (1.0f + 0.5f) * TERRAIN_HEIGHT_SCALE;
+
 FastNoiseLite noiseGen()
 {
     FastNoiseLite noise;
@@ -53,6 +99,92 @@ FastNoiseLite noiseGen()
     return noise;
 }
 
+// Terrain noise for a vertex grid with this resolution. Octaves finer than the vertex
+// spacing would only alias, so they are skipped and the last one kept is faded in.
+inline FastNoiseLite terrainNoise(float resolution)
+{
+    FastNoiseLite noise = noiseGen();
+    noise.SetFractalOctaveLimit(noise.GetFractalOctavesForSpacing(resolution * TERRAIN_NOISE_SCALING));
+    return noise;
+}
+
+// Anchor a global vertex index is sampled from, rounding down
+inline int terrainNoiseAnchorIndex(int index)
+{
+    return index >= 0 ? index / TERRAIN_NOISE_ANCHOR_SPACING : -((-index - 1) / TERRAIN_NOISE_ANCHOR_SPACING) - 1;
+}
+
+// Anchor of either noise axis at global vertex anchor * TERRAIN_NOISE_ANCHOR_SPACING
+template <typename Noise>
+inline FastNoiseLite::AxisAnchor terrainNoiseAnchor(const Noise& noise, int anchor, float resolution)
+{
+    const float noiseStep = resolution * TERRAIN_NOISE_SCALING;
+    return noise.GetAxisAnchor((double) anchor * TERRAIN_NOISE_ANCHOR_SPACING * noiseStep);
+}
+
+// Height of global grid vertex (column, row), exactly as Shape::buildGrid computes it.
+// Noise is a FastNoiseLite or one of its samplers, which give the same heights.
+template <typename Noise>
+inline float terrainVertexHeight(const Noise& noise, int column, int row, float resolution)
+{
+    const float noiseStep = resolution * TERRAIN_NOISE_SCALING;
+    const int rowAnchor = terrainNoiseAnchorIndex(row);
+    const int columnAnchor = terrainNoiseAnchorIndex(column);
+    const FastNoiseLite::AxisAnchor xAnchor = terrainNoiseAnchor(noise, rowAnchor, resolution);
+    const FastNoiseLite::AxisAnchor yAnchor = terrainNoiseAnchor(noise, columnAnchor, resolution);
+    const float x = (row - rowAnchor * TERRAIN_NOISE_ANCHOR_SPACING) * noiseStep;
+    const float y = (column - columnAnchor * TERRAIN_NOISE_ANCHOR_SPACING) * noiseStep;
+    return ((TERRAIN_DOMAIN_WARP ? noise.GetWarpedNoise(xAnchor, yAnchor, x, y) : noise.GetNoise(xAnchor, yAnchor, x, y)) + 0.5f)
+        * TERRAIN_HEIGHT_SCALE;
+}
+
+// Heights of the width x height global grid vertices from (firstColumn, firstRow), rows pitch
+// floats apart, identical to terrainVertexHeight
+inline void terrainHeights(const FastNoiseLite::Sampler& sampler, float resolution, int firstColumn, int firstRow,
+    int width, int height, int pitch, float* out, ThreadPool& pool)
+{
+    const float noiseStep = resolution * TERRAIN_NOISE_SCALING;
+
+    // The column anchors are shared by every row
+    const int firstAnchor = terrainNoiseAnchorIndex(firstColumn);
+    std::vector<FastNoiseLite::AxisAnchor> columnAnchors;
+    for (int anchor = firstAnchor; anchor <= terrainNoiseAnchorIndex(firstColumn + width - 1); anchor++) {
+        columnAnchors.push_back(terrainNoiseAnchor(sampler, anchor, resolution));
+    }
+
+    // Every row is filled on its own, so bands of rows can run on any thread
+    pool.parallelFor(0, height, [&](int beginRow, int endRow) {
+        for (int j = beginRow; j < endRow; ++j) {
+            float* row = out + (size_t) j * pitch;
+            const int rowAnchor = terrainNoiseAnchorIndex(firstRow + j);
+            const FastNoiseLite::AxisAnchor xAnchor = terrainNoiseAnchor(sampler, rowAnchor, resolution);
+            const int localRow = firstRow + j - rowAnchor * TERRAIN_NOISE_ANCHOR_SPACING;
+
+            // Noise is sampled as (z, x) from the anchors of global grid indices, so the coordinates
+            // do not depend on how rows are split into bands or how the world is split into tiles.
+            for (int column = firstColumn; column < firstColumn + width;) {
+                const int anchor = terrainNoiseAnchorIndex(column);
+                const int end = std::min(firstColumn + width, (anchor + 1) * TERRAIN_NOISE_ANCHOR_SPACING);
+                const FastNoiseLite::AxisAnchor& yAnchor = columnAnchors[anchor - firstAnchor];
+                const int localColumn = column - anchor * TERRAIN_NOISE_ANCHOR_SPACING;
+                if (TERRAIN_DOMAIN_WARP) {
+                    sampler.GetWarpedNoiseGrid2D(row + (column - firstColumn), 1, end - column, xAnchor, yAnchor, noiseStep, noiseStep, pitch, 1,
+                        localRow, localColumn);
+                }
+                else {
+                    sampler.GetNoiseGrid2D(row + (column - firstColumn), 1, end - column, xAnchor, yAnchor, noiseStep, noiseStep, pitch, 1,
+                        localRow, localColumn);
+                }
+                column = end;
+            }
+
+            for (int i = 0; i < width; ++i) {
+                row[i] = (row[i] + 0.5f) * TERRAIN_HEIGHT_SCALE;
+            }
+        }
+    });
+}
+
 inline glm::vec3 Shape::randomPoint()
 {
     const size_t numVertices = (size_t) indices.back() + 1;
@@ -66,6 +198,17 @@ inline glm::vec3 Shape::randomPoint()
 }
 
 inline void Shape::generatePlane(int width, int height, float resolution)
+{
+    generatePlane(width, height, resolution, ThreadPool::shared());
+}
+
+inline void Shape::generatePlane(int width, int height, float resolution, ThreadPool& pool)
+{
+    buildPlane(width, height, resolution, pool);
+    setupPlane();
+}
+
+inline void Shape::buildPlane(int width, int height, float resolution, ThreadPool& pool)
 {
     
     if (resolution <= 0.0f) {
@@ -74,101 +217,130 @@ inline void Shape::generatePlane(int width, int height, float resolution)
 
     // Calculate the number of vertices needed along each axis.
     // We use integer math for robustness. Add 1 because a line of N segments has N+1 points.
-    const int vertsPerRow = static_cast<int>(width / resolution) + 1;
-    const int vertsPerCol = static_cast<int>(height / resolution) + 1;
-
-    
-
-    vertices.reserve(vertsPerRow * vertsPerCol * 3);
-
-    FastNoiseLite noise = noiseGen();
-
-    float scaling = 0.12f;
+    buildGrid(static_cast<int>(width / resolution) + 1, static_cast<int>(height / resolution) + 1, resolution, pool, 0, 0, &erosion);
+    buildIndices(pool);
+}
 
-    for (int j = 0; j < vertsPerCol; ++j) {
-        for (int i = 0; i < vertsPerRow; ++i) {
-            // Calculate the actual world position for the vertex.
-            float x = i * resolution;
-            float z = j * resolution;
+inline void Shape::buildGrid(int vertsPerRow, int vertsPerCol, float resolution, ThreadPool& pool, int firstColumn, int firstRow,
+    const ErosionSettings* erosionSettings)
+{
+    const FastNoiseLite noise = terrainNoise(resolution);
+    const FastNoiseLite::Sampler sampler = noise.GetSampler();
+
+    // Heights with a one vertex apron, so the normals along the border see the same
+    // neighbours the adjacent tile has and shade seamlessly across it.
+    const int apronPitch = vertsPerRow + 2;
+    std::vector<float> apron((size_t) apronPitch * (vertsPerCol + 2));
+    terrainHeights(sampler, resolution, firstColumn - 1, firstRow - 1, apronPitch, vertsPerCol + 2, apronPitch, apron.data(), pool);
+
+    // The apron is eroded too, so the border normals see the eroded neighbours
+    if (erosionSettings != nullptr) {
+        erodeHeightfield(apron.data(), apronPitch, apronPitch, vertsPerCol + 2, *erosionSettings, pool);
+    }
 
-            // Get the noise value for this position to determine the height (y).
-            float y = (noise.GetNoise(z * scaling, x * scaling) + 0.5f) * 7.5f;
+    buildGrid(vertsPerRow, vertsPerCol, resolution, pool, firstColumn, firstRow, apron.data() + apronPitch + 1, apronPitch);
+}
 
-            vertices.push_back(x);
-            vertices.push_back(y);
-            vertices.push_back(z);
+inline void Shape::buildGrid(int vertsPerRow, int vertsPerCol, float resolution, ThreadPool& pool, int firstColumn, int firstRow,
+    const float* apronHeights, int pitch)
+{
+    this->vertsPerRow = vertsPerRow;
+    this->vertsPerCol = vertsPerCol;
+    this->resolution = resolution;
+    this->firstColumn = firstColumn;
+    this->firstRow = firstRow;
+
+    // Positions first, then normals, as two tightly packed blocks
+    const size_t numVertices = (size_t) vertsPerRow * vertsPerCol;
+    vertices.assign(numVertices * 6, 0.0f);
+    float* positions = vertices.data();
+    float* normals = vertices.data() + numVertices * 3;
+
+    heights.assign(numVertices, 0.0f);
+
+    // Every pass below works on whole rows, so bands of rows can run on any thread
+    // and write disjoint parts of the output.
+    pool.parallelFor(0, vertsPerCol, [&](int beginRow, int endRow) {
+        for (int j = beginRow; j < endRow; ++j) {
+            const float* row = apronHeights + (size_t) j * pitch;
+            std::copy(row, row + vertsPerRow, heights.begin() + (size_t) j * vertsPerRow);
+
+            for (int i = 0; i < vertsPerRow; ++i) {
+                // Calculate the actual world position for the vertex.
+                float* position = positions + ((size_t) j * vertsPerRow + i) * 3;
+                position[0] = (firstColumn + i) * resolution;
+                position[1] = row[i];
+                position[2] = (firstRow + j) * resolution;
+            }
         }
-        //std::cout << "Generation: " << j << "/" << vertsPerCol << "\r";
-    }
+    });
 
-    unsigned int size = (unsigned int) vertices.size();
+    // --- Normal Generation ---
+    heightfieldNormals(apronHeights, pitch, vertsPerRow, vertsPerCol, resolution, normals, pool);
+}
 
+inline void Shape::buildIndices(ThreadPool& pool)
+{
     // --- Index Generation ---
     // A grid of WxH quads has (W*H*6) indices.
     const int numQuadsX = vertsPerRow - 1;
     const int numQuadsZ = vertsPerCol - 1;
-    indices.reserve(numQuadsX * numQuadsZ * 6);
+    indices.assign((size_t) numQuadsX * numQuadsZ * 6, 0);
 
     // Loop through the quads, not the vertices.
-    for (int z_idx = 0; z_idx < numQuadsZ; ++z_idx) {
-        for (int x_idx = 0; x_idx < numQuadsX; ++x_idx) {
-            // Calculate the indices of the four corners of the current quad.
-            int topLeft = (z_idx * vertsPerRow) + x_idx;
-            int topRight = topLeft + 1;
-            int bottomLeft = ((z_idx + 1) * vertsPerRow) + x_idx;
-            int bottomRight = bottomLeft + 1;
-
-            // Create the first triangle of the quad.
-            indices.push_back(topLeft);
-            indices.push_back(bottomLeft);
-            indices.push_back(topRight);
-
-            // Create the second triangle of the quad.
-            indices.push_back(topRight);
-            indices.push_back(bottomLeft);
-            indices.push_back(bottomRight);
-
-            
+    pool.parallelFor(0, numQuadsZ, [&](int beginRow, int endRow) {
+        for (int z_idx = beginRow; z_idx < endRow; ++z_idx) {
+            unsigned int* quad = indices.data() + (size_t) z_idx * numQuadsX * 6;
+            for (int x_idx = 0; x_idx < numQuadsX; ++x_idx, quad += 6) {
+                // Calculate the indices of the four corners of the current quad.
+                unsigned int topLeft = (z_idx * vertsPerRow) + x_idx;
+                unsigned int topRight = topLeft + 1;
+                unsigned int bottomLeft = ((z_idx + 1) * vertsPerRow) + x_idx;
+                unsigned int bottomRight = bottomLeft + 1;
+
+                // Create the first triangle of the quad.
+                quad[0] = topLeft;
+                quad[1] = bottomLeft;
+                quad[2] = topRight;
+
+                // Create the second triangle of the quad.
+                quad[3] = topRight;
+                quad[4] = bottomLeft;
+                quad[5] = bottomRight;
+            }
         }
-    }
-
-    std::vector<glm::vec3> normals(vertsPerRow * vertsPerCol, glm::vec3(0.0f, 0.0f, 0.0f));
-
-    for (int i = 0; i < indices.size(); i += 3) {
-        int i1 = indices[i];
-        int i2 = indices[i + 1];
-        int i3 = indices[i + 2];
-
-        glm::vec3 v1{ vertices[i1 * 3], vertices[i1 * 3 + 1], vertices[i1 * 3 + 2] };
-        glm::vec3 v2{ vertices[i2 * 3], vertices[i2 * 3 + 1], vertices[i2 * 3 + 2] };
-        glm::vec3 v3{ vertices[i3 * 3], vertices[i3 * 3 + 1], vertices[i3 * 3 + 2] };
-
-        glm::vec3 normal = glm::cross(v2 - v1, v3 - v1);
-        
-        normals[i1] += normal;
-        normals[i2] += normal;
-        normals[i3] += normal;
-    }
+    });
+}
 
-    for (int i = 0; i < normals.size(); i++) {
-        normals[i] = glm::normalize(normals[i]);
-        vertices.push_back(normals[i].x);
-        vertices.push_back(normals[i].y);
-        vertices.push_back(normals[i].z);
-    }
+inline void Shape::setupPlane()
+{
+    const size_t size = vertices.size() / 2;
 
-    unsigned int VBO, VAO, EBO;
+    unsigned int VBO, VAO, EBO = 0;
     glGenVertexArrays(1, &VAO);
     glGenBuffers(1, &VBO);
-    glGenBuffers(1, &EBO);
     // bind the Vertex Array Object first, then bind and set vertex buffer(s), and then configure vertex attributes(s).
     glBindVertexArray(VAO);
 
     glBindBuffer(GL_ARRAY_BUFFER, VBO);
     glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), vertices.data(), GL_STATIC_DRAW);
 
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), indices.data(), GL_STATIC_DRAW);
+    // Planes without indices are drawn through index buffers bound by their owner
+    if (!indices.empty()) {
+        glGenBuffers(1, &EBO);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+
+        // Up to 65536 vertices fit 16-bit indices, which halves the index buffer
+        if (size / 3 <= 65536) {
+            std::vector<unsigned short> narrow(indices.begin(), indices.end());
+            indexType = GL_UNSIGNED_SHORT;
+            glBufferData(GL_ELEMENT_ARRAY_BUFFER, narrow.size() * sizeof(unsigned short), narrow.data(), GL_STATIC_DRAW);
+        }
+        else {
+            indexType = GL_UNSIGNED_INT;
+            glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), indices.data(), GL_STATIC_DRAW);
+        }
+    }
 
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, (void*)0);
     glEnableVertexAttribArray(0);
@@ -177,13 +349,28 @@ inline void Shape::generatePlane(int width, int height, float resolution)
     glEnableVertexAttribArray(1);
 
     this->VAO = VAO;
+    this->VBO = VBO;
+    this->EBO = EBO;
     this->size = static_cast<unsigned int>(indices.size());
 }
 
+inline void Shape::deletePlane()
+{
+    glDeleteVertexArrays(1, &VAO);
+    glDeleteBuffers(1, &VBO);
+    glDeleteBuffers(1, &EBO);
+    VAO = VBO = EBO = 0;
+    size = 0;
+}
+
 inline void Shape::Draw(Shader& shader)
 {
     glm::vec3 color = { 1.0f, 1.0f, 1.0f };
     shader.setValue("material.color_diffuse", color);
+    // Shapes share shader.vert with meshes, which may have left a quantized decode set
+    shader.setValue("positionOffset", glm::vec3(0.0f));
+    shader.setValue("positionScale", glm::vec3(1.0f));
+    shader.setValue("octNormals", false);
     glBindVertexArray(this->VAO);
-    glDrawElements(GL_TRIANGLES, size, GL_UNSIGNED_INT, 0);
+    glDrawElements(GL_TRIANGLES, size, indexType, 0);
 }
\ No newline at end of file
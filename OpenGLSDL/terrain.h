@@ -0,0 +1,1729 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <future>
+#include <limits>
+#include <map>
+#include <memory>
+#include <random>
+#include <shared_mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "erosion.h"
+#include "heightfield.h"
+#include "mappedfile.h"
+#include "shape.h"
+#include "threadpool.h"
+
+// Every tile is a quadtree of LOD nodes. A node always draws TERRAIN_NODE_QUADS x TERRAIN_NODE_QUADS
+// quads, so the root covers the tile at the coarsest stride and the deepest level is full resolution.
+constexpr int TERRAIN_NODE_QUADS = 32;
+constexpr int TERRAIN_LOD_LEVELS = 4;
+constexpr int TERRAIN_CHUNK_QUADS = TERRAIN_NODE_QUADS << (TERRAIN_LOD_LEVELS - 1);
+constexpr int TERRAIN_CHUNK_NODES = ((1 << (2 * TERRAIN_LOD_LEVELS)) - 1) / 3;
+// Finest nodes along a tile side; node edges run along every TERRAIN_NODE_QUADS-th row and column
+constexpr int TERRAIN_CHUNK_SEGMENTS = TERRAIN_CHUNK_QUADS / TERRAIN_NODE_QUADS;
+constexpr int TERRAIN_NODE_INDICES = TERRAIN_NODE_QUADS * TERRAIN_NODE_QUADS * 6;
+// Skirt strip around a node: top and bottom vertex for each perimeter point, back to the start
+constexpr int TERRAIN_SKIRT_VERTICES = 2 * (4 * TERRAIN_NODE_QUADS + 1);
+// Bump whenever the tile layout, the cache file layout or the way heights are sampled changes
+constexpr unsigned int TERRAIN_CACHE_VERSION = 4;
+// Baked lighting looks this many vertices out from every vertex, so tiles sample their heights
+// this far past their edges
+constexpr int TERRAIN_HORIZON_RADIUS = 64;
+
+// The direction sunlight travels. lightHelper lights the scene with it and terrain tiles bake
+// their shadows for it, so the two cannot disagree.
+const glm::vec3 SUN_DIRECTION = glm::vec3(-0.2f, -1.0f, -0.3f);
+// Erosion fades out over this many vertices inside the eroded region's border
+constexpr int TERRAIN_EROSION_FADE = 128;
+
+// Tile vertices only store what cannot be derived: x and z come from gl_VertexID and the
+// tile's grid origin in terrainShader.vert. Every format ends with the baked ambient occlusion
+// and sun visibility as two bytes, see heightfieldHorizons.
+enum TerrainVertexFormat {
+    TERRAIN_FLOAT,          // float height, float xyz normal, lighting, 2 bytes padding: 20 bytes
+    TERRAIN_HEIGHT_NORMAL,  // 16-bit height, oct-encoded 2 x 8-bit normal, lighting: 6 bytes
+    TERRAIN_HEIGHT          // 16-bit height, lighting, lit with screen space derivative normals: 4 bytes
+};
+
+// Streams square terrain tiles around the camera. Tiles are built on the shared thread pool,
+// a few finished ones are uploaded per frame, and once the resident tiles go over memoryBudget
+// the farthest ones outside the view radius are evicted.
+// Each frame the tile quadtrees are refined by distance to the camera and coarsened as a whole
+// until the selection fits triangleBudget. Neighbouring nodes of different strides are hidden
+// behind skirts hanging from every node edge.
+// Finished tiles are written to cacheDirectory, keyed by the noise settings and tile layout, and
+// mapped back in instead of being generated again on later runs.
+class Terrain : public Object {
+public:
+    float resolution = 0.1f;
+    // Tiles up to this many tiles away from the camera's tile are streamed in
+    int viewRadius = 3;
+    int uploadsPerFrame = 2;
+    // GPU buffers plus the heights kept on the CPU, for every uploaded tile
+    size_t memoryBudget = 192u * 1024 * 1024;
+    // A node is split while the camera is closer than lodDistance times its width
+    float lodDistance = 3.0f;
+    size_t triangleBudget = 1000000;
+    // Format of tiles generated from now on
+    TerrainVertexFormat vertexFormat = TERRAIN_HEIGHT_NORMAL;
+    // Nodes are drawn as one primitive-restarted strip per row of quads instead of a triangle list
+    bool triangleStrips = true;
+    // Generated tiles are kept here across runs, one file per tile; empty disables the cache
+    std::string cacheDirectory = "cache";
+    // Opt-in: tiles uploaded from now on get no vertex buffers and terrainShader.vert samples the
+    // noise for their heights instead, which only saves the buffers' GPU memory. The tiles are still
+    // generated in full on the CPU for the queries, the lighting and the cache, but brush edits,
+    // erosion and the baked lighting are not drawn. The shader only has noiseGen's Value noise FBm
+    // and OpenSimplex2 warp; --gpu-parity checks it against the CPU heights.
+    bool proceduralHeights = false;
+    // Droplet erosion of a square of erosionRegion x erosionRegion tiles centred on the origin,
+    // run once on the thread pool by the first update; tiles that see it wait until it is done.
+    // Every tile reads the same eroded heights, aprons included, so shared edges still match.
+    // The erosion fades out towards the square's border and the terrain outside it is the plain
+    // noise. Both are read by the first update or randomPoint; 0 tiles disables erosion.
+    int erosionRegion = 4;
+    ErosionSettings erosion;
+
+    Terrain() : rng(std::random_device{}()) {}
+    ~Terrain();
+
+    void update(glm::vec3 cameraPosition);
+    void Draw(Shader& shader) override;
+    // Noise settings for the procedural heights in terrainShader.vert; Draw sets them too
+    void setNoiseUniforms(Shader& shader) const;
+    // Noise anchors for the procedural heights of the tile from global vertex (firstColumn, firstRow)
+    void setNoiseAnchors(Shader& shader, int firstColumn, int firstRow) const;
+
+    float chunkWorldSize() const;
+    size_t residentBytes() const;
+    // Triangles drawn by the last update, skirts included
+    size_t selectedTriangles() const;
+    // Random point on the ground inside [0, width] x [0, height]. Waits for the erosion, starting
+    // it if no update has yet, so the point is still on the ground once the eroded tiles stream in.
+    glm::vec3 randomPoint(float width, float height);
+
+    // Ground height at world (x, z), bilinear between the grid vertices around it. Uploaded tiles
+    // are read with their edits, anywhere else the noise is sampled and eroded.
+    // Both queries are safe to call from any thread while the main thread streams and edits.
+    float heightAt(float x, float z) const;
+    // First point within maxDistance where the ray meets the surface heightAt describes
+    bool raycast(glm::vec3 origin, glm::vec3 direction, float maxDistance, glm::vec3& hit) const;
+
+    // Height brushes centred at (x, z), fading out smoothly towards radius. Only the heights under
+    // the brush are recomputed, and only the changed vertices are uploaded.
+    // The tiles under a stroke keep the new heights of its vertices, and tiles still generating
+    // when it is made or streamed back in after eviction get them on upload.
+    // The baked lighting of the vertices that can see an edit is baked again on the thread pool
+    // once the strokes stop for a frame, and swapped in by a later update.
+    void raise(glm::vec2 center, float radius, float amount);
+    void lower(glm::vec2 center, float radius, float amount);
+    // Pulls the heights towards height, all the way at the centre when strength is 1
+    void flatten(glm::vec2 center, float radius, float height, float strength = 1.0f);
+    // Adds amount times a row-major brushSize x brushSize heightmap stretched over the brush square
+    void stamp(glm::vec2 center, float radius, const std::vector<float>& brush, int brushSize, float amount);
+
+private:
+    // (x, z) tile index; tile (x, z) starts at global vertex (x, z) * TERRAIN_CHUNK_QUADS
+    typedef std::pair<int, int> ChunkKey;
+
+    struct Chunk {
+        // Heights on the CPU; its float vertices are dropped once packed
+        std::unique_ptr<Shape> shape;
+        TerrainVertexFormat format = TERRAIN_HEIGHT_NORMAL;
+        // Packed grid vertices, and one TERRAIN_SKIRT_VERTICES strip per quadtree node drawn
+        // without indices. Both are freed after upload.
+        std::vector<unsigned char> vertexData;
+        std::vector<unsigned char> skirtData;
+        // Ambient occlusion and sun visibility bytes of every grid vertex, kept for repacking
+        std::vector<unsigned char> lighting;
+        // Vertices whose lighting was baked before a stroke near them: first and last i, then
+        // first and last j; empty while first > last
+        int staleLighting[4] = { 1, 0, 1, 0 };
+        // Lighting of the vertices in bakingLighting, the same way, being baked on the thread pool
+        std::future<std::vector<unsigned char>> baking;
+        int bakingLighting[4] = { 1, 0, 1, 0 };
+        // Set instead when the tile was found in the cache; upload reads straight from the mapping
+        std::unique_ptr<MappedFile> cacheFile;
+        unsigned int VAO = 0;
+        unsigned int VBO = 0;
+        unsigned int skirtVAO = 0;
+        unsigned int skirtVBO = 0;
+        float minHeight = 0.0f;
+        float maxHeight = 0.0f;
+        // How far any coarser stride strays from the heights along each node edge: rows (0) or
+        // columns (1), node edge line, then node-wide segment of the line
+        float edgeDeviation[2][TERRAIN_CHUNK_SEGMENTS + 1][TERRAIN_CHUNK_SEGMENTS] = {};
+        std::future<void> generated;
+        bool uploaded = false;
+        size_t bytes = 0;
+    };
+
+    // Followed by the float heights, the packed vertices and the packed skirts
+    struct CacheHeader {
+        char magic[4];
+        unsigned int version;
+        unsigned long long key;
+        int tileX;
+        int tileZ;
+        unsigned int format;
+        unsigned int vertsPerSide;
+        float minHeight;
+        float maxHeight;
+        unsigned int heightBytes;
+        unsigned int lightingBytes;
+        unsigned int vertexBytes;
+        unsigned int skirtBytes;
+    };
+
+    // How far erosion moved the heights of the square of global vertices from (first, first)
+    struct ErosionRegion {
+        int first = 0;
+        int size = 0;
+        std::vector<float> delta;
+
+        bool overlaps(int column, int row, int width, int height) const;
+        // Adds the erosion to the width x height heights of global vertices from (column, row),
+        // rows pitch floats apart
+        void apply(float* heights, int pitch, int column, int row, int width, int height) const;
+        float at(int column, int row) const;
+    };
+
+    // Heights brush strokes left on the vertices of a tile, kept across evictions
+    struct TileEdits {
+        // NaN where no stroke reached
+        std::vector<float> heights;
+        // Edited vertices: first and last i, then first and last j; empty while first > last
+        int bounds[4] = { 1, 0, 1, 0 };
+    };
+
+    // A brush stroke, with the global vertices under its square
+    struct Edit {
+        glm::vec2 center;
+        float radius;
+        int firstColumn;
+        int lastColumn;
+        int firstRow;
+        int lastRow;
+        std::function<float(float height, float u, float v)> brush;
+    };
+
+    // Index buffer of one node at one stride
+    struct NodeIndices {
+        unsigned int buffer = 0;
+        GLenum type = GL_UNSIGNED_INT;
+        GLsizei count = 0;
+    };
+
+    struct NodeDraw {
+        const Chunk* chunk;
+        int level;
+        int baseVertex;
+        int skirtFirst;
+    };
+
+    std::map<ChunkKey, Chunk> chunks;
+    // Edited heights of every tile a stroke has reached so far; main thread only
+    std::map<ChunkKey, TileEdits> edits;
+    // Whether a stroke was made since the last update
+    bool stroked = false;
+    size_t resident = 0;
+    // Held shared by the queries, and exclusively while the main thread changes the map, marks a
+    // tile uploaded or edits heights. Main thread reads need no lock.
+    mutable std::shared_timed_mutex chunksMutex;
+
+    // Index buffer of one node for every stride, shared by all nodes of all tiles
+    NodeIndices nodeIndices[TERRAIN_LOD_LEVELS];
+    bool nodeIndexStrips = false;
+    // Bound for tiles without vertex buffers, which still need somewhere to keep the node indices
+    unsigned int proceduralVAO = 0;
+    std::vector<NodeDraw> selected;
+    size_t triangles = 0;
+
+    const FastNoiseLite noise = terrainNoise(resolution);
+    // Declared after noise, which it reads
+    const FastNoiseLite::Sampler sampler = noise.GetSampler();
+    // Set under chunksMutex once the erosion is done, and never changed after that
+    std::shared_ptr<const ErosionRegion> eroded;
+    std::future<std::shared_ptr<const ErosionRegion>> eroding;
+    bool erosionStarted = false;
+    std::mt19937 rng;
+
+    template <typename T>
+    static bool isReady(const std::future<T>& future);
+    static ChunkKey chunkKey(const Chunk& chunk);
+    static int chunkDistance(ChunkKey a, ChunkKey b);
+    static int chunkDistanceSquared(ChunkKey a, ChunkKey b);
+    static size_t vertexSize(TerrainVertexFormat format);
+    // Grows the range of vertices range holds, first and last i then first and last j, to cover
+    // [beginI, endI] x [beginJ, endJ]
+    static void extendRange(int* range, int beginI, int endI, int beginJ, int endJ);
+    static void packVertex(TerrainVertexFormat format, float height, const float* normal, const unsigned char* lighting, unsigned char* out);
+    static void packVertices(Chunk& chunk);
+    template <typename Visit>
+    static void walkSkirt(int depth, int nodeX, int nodeZ, Visit visit);
+    // Measures edgeDeviation again for the segments holding a vertex of [beginI, endI] x [beginJ, endJ]
+    static void measureEdges(Chunk& chunk, int beginI, int endI, int beginJ, int endJ);
+    static float edgeLineDeviation(const Chunk& chunk, int direction, int line);
+    static void buildSkirts(Chunk& chunk);
+    static void buildNodeIndices(int level, bool strips, std::vector<unsigned int>& indices);
+    static void setupVertexArray(TerrainVertexFormat format, const void* data, size_t size, unsigned int& VAO, unsigned int& VBO);
+    static bool loadCached(Chunk& chunk, const std::string& path, unsigned long long cacheKey, ChunkKey key, float resolution);
+    static void storeCached(const Chunk& chunk, const std::string& path, unsigned long long cacheKey, ChunkKey key);
+
+    unsigned long long cacheKey(TerrainVertexFormat format) const;
+    std::string cachePath(ChunkKey key, unsigned long long cacheKey) const;
+    float vertexHeight(int column, int row) const;
+    // The noise, eroded where the region is; both are safe to call from any thread under chunksMutex
+    float noiseHeight(int column, int row) const;
+    void startErosion();
+    // Publishes the eroded heights once the erosion is done, or waits for it
+    void finishErosion(bool wait);
+    // Whether the tile or anything its horizons see lies in the eroded region
+    bool seesErosion(ChunkKey key) const;
+    const Shape* residentTile(ChunkKey key) const;
+    float skirtDepth(const Chunk& chunk) const;
+    void cellHeights(const Shape* tile, int column, int row, float* h) const;
+    void packGridVertex(const Chunk& chunk, int i, int j, unsigned char* out) const;
+    // brush maps a height and the vertex's offset from the centre, in radii, to the new height
+    void edit(glm::vec2 center, float radius, std::function<float(float height, float u, float v)> brush);
+    // Runs edit on the tile's vertices and keeps their new heights in edits. An uploaded tile
+    // gets them too, under chunksMutex.
+    void applyEdit(ChunkKey key, const Edit& edit);
+    // Uploads again every vertex whose height or normal depends on one in the given range of
+    // global vertices, and the skirts hanging from them
+    void repackVertices(int firstColumn, int lastColumn, int firstRow, int lastRow);
+    // The same for the tile's vertices [beginI, endI] x [beginJ, endJ], clipped to the tile
+    void repackChunk(Chunk& chunk, int beginI, int endI, int beginJ, int endJ) const;
+    // Marks the lighting of every uploaded tile's vertices that can see a vertex in the given range
+    // of global vertices as stale
+    void markLighting(int firstColumn, int lastColumn, int firstRow, int lastRow);
+    // Starts baking the stale lighting of the tile again on the thread pool, from the heights
+    // around it as they are now
+    void bakeLighting(Chunk& chunk);
+    // Copies the finished bake into the tile's lighting and repacks those vertices
+    void finishLighting(Chunk& chunk);
+    void generate(ChunkKey key);
+    void upload(Chunk& chunk);
+    void setupNodeIndices();
+    void evict(ChunkKey center);
+    void select(glm::vec3 cameraPosition);
+    bool selectNode(const Chunk& chunk, ChunkKey key, int depth, int nodeX, int nodeZ, glm::vec3 cameraPosition, float scale);
+};
+
+inline Terrain::~Terrain()
+{
+    if (eroding.valid()) {
+        eroding.wait();
+    }
+    // Workers still hold pointers into pending tiles
+    for (auto& entry : chunks) {
+        if (entry.second.generated.valid()) {
+            entry.second.generated.wait();
+        }
+    }
+}
+
+inline float Terrain::chunkWorldSize() const
+{
+    return TERRAIN_CHUNK_QUADS * resolution;
+}
+
+inline size_t Terrain::residentBytes() const
+{
+    return resident;
+}
+
+inline size_t Terrain::selectedTriangles() const
+{
+    return triangles;
+}
+
+// Rounds towards negative infinity, so negative vertex indices map to negative tiles
+inline int floorDivide(int a, int b)
+{
+    return a / b - (a % b != 0 && (a < 0) != (b < 0));
+}
+
+inline glm::vec3 Terrain::randomPoint(float width, float height)
+{
+    std::uniform_real_distribution<float> x(0.0f, width);
+    std::uniform_real_distribution<float> z(0.0f, height);
+
+    if (!erosionStarted) {
+        startErosion();
+    }
+    finishErosion(true);
+
+    glm::vec3 point(x(rng), 0.0f, z(rng));
+    point.y = heightAt(point.x, point.z);
+    return point;
+}
+
+inline const Shape* Terrain::residentTile(ChunkKey key) const
+{
+    auto it = chunks.find(key);
+    return it != chunks.end() && it->second.uploaded ? it->second.shape.get() : nullptr;
+}
+
+// tile is the resident tile holding the cell, or null to sample the noise
+inline void Terrain::cellHeights(const Shape* tile, int column, int row, float* h) const
+{
+    if (tile == nullptr) {
+        h[0] = noiseHeight(column, row);
+        h[1] = noiseHeight(column + 1, row);
+        h[2] = noiseHeight(column, row + 1);
+        h[3] = noiseHeight(column + 1, row + 1);
+        return;
+    }
+
+    const float* heights = tile->heights.data() + (size_t) (row - tile->firstRow) * tile->vertsPerRow + (column - tile->firstColumn);
+    h[0] = heights[0];
+    h[1] = heights[1];
+    h[2] = heights[tile->vertsPerRow];
+    h[3] = heights[tile->vertsPerRow + 1];
+}
+
+inline float Terrain::heightAt(float x, float z) const
+{
+    std::shared_lock<std::shared_timed_mutex> lock(chunksMutex);
+
+    auto corners = [this](int column, int row, float* h) {
+        // All four corners of a cell lie in the tile holding its (0, 0) corner
+        cellHeights(residentTile(ChunkKey(floorDivide(column, TERRAIN_CHUNK_QUADS), floorDivide(row, TERRAIN_CHUNK_QUADS))), column, row, h);
+    };
+    return heightfieldHeight(corners, x / resolution, z / resolution);
+}
+
+inline bool Terrain::raycast(glm::vec3 origin, glm::vec3 direction, float maxDistance, glm::vec3& hit) const
+{
+    if (glm::length(direction) == 0.0f) {
+        return false;
+    }
+    direction = glm::normalize(direction);
+
+    std::shared_lock<std::shared_timed_mutex> lock(chunksMutex);
+
+    // Consecutive cells are nearly always in the same tile
+    ChunkKey lastKey(0, 0);
+    const Shape* tile = nullptr;
+    bool looked = false;
+    auto corners = [&](int column, int row, float* h) {
+        ChunkKey key(floorDivide(column, TERRAIN_CHUNK_QUADS), floorDivide(row, TERRAIN_CHUNK_QUADS));
+        if (!looked || key != lastKey) {
+            tile = residentTile(key);
+            lastKey = key;
+            looked = true;
+        }
+        cellHeights(tile, column, row, h);
+    };
+
+    // Grid units across, world units up, so t stays a world distance
+    const float gridOrigin[3] = { origin.x / resolution, origin.y, origin.z / resolution };
+    const float gridDirection[3] = { direction.x / resolution, direction.y, direction.z / resolution };
+    float t = heightfieldRaycast(corners, gridOrigin, gridDirection, maxDistance, TERRAIN_MIN_HEIGHT, TERRAIN_MAX_HEIGHT);
+    if (t < 0.0f) {
+        return false;
+    }
+
+    hit = origin + direction * t;
+    return true;
+}
+
+// Weight of a radial brush at (u, v) radii from its centre: 1 at the centre, 0 from the radius on
+inline float brushFalloff(float u, float v)
+{
+    float t = std::min(u * u + v * v, 1.0f);
+    return (1.0f - t) * (1.0f - t);
+}
+
+inline void Terrain::raise(glm::vec2 center, float radius, float amount)
+{
+    edit(center, radius, [amount](float height, float u, float v) {
+        return height + amount * brushFalloff(u, v);
+    });
+}
+
+inline void Terrain::lower(glm::vec2 center, float radius, float amount)
+{
+    raise(center, radius, -amount);
+}
+
+inline void Terrain::flatten(glm::vec2 center, float radius, float height, float strength)
+{
+    edit(center, radius, [height, strength](float current, float u, float v) {
+        return current + (height - current) * strength * brushFalloff(u, v);
+    });
+}
+
+inline void Terrain::stamp(glm::vec2 center, float radius, const std::vector<float>& brush, int brushSize, float amount)
+{
+    if (brushSize < 2 || brush.size() < (size_t) brushSize * brushSize) {
+        return;
+    }
+
+    edit(center, radius, [&brush, brushSize, amount](float height, float u, float v) {
+        // Bilinear lookup, with (-1, -1) at brush[0] and (1, 1) at the last sample
+        float x = (u * 0.5f + 0.5f) * (brushSize - 1);
+        float y = (v * 0.5f + 0.5f) * (brushSize - 1);
+        int x0 = std::min((int) x, brushSize - 2);
+        int y0 = std::min((int) y, brushSize - 2);
+        float tx = x - x0;
+        float ty = y - y0;
+
+        const float* row = brush.data() + (size_t) y0 * brushSize + x0;
+        float top = row[0] * (1.0f - tx) + row[1] * tx;
+        float bottom = row[brushSize] * (1.0f - tx) + row[brushSize + 1] * tx;
+        return height + amount * (top * (1.0f - ty) + bottom * ty);
+    });
+}
+
+inline float Terrain::vertexHeight(int column, int row) const
+{
+    // Vertices on a tile edge are stored by both tiles with the same value, either will do
+    const ChunkKey key(floorDivide(column, TERRAIN_CHUNK_QUADS), floorDivide(row, TERRAIN_CHUNK_QUADS));
+    auto it = chunks.find(key);
+    if (it != chunks.end() && it->second.uploaded) {
+        const Shape& shape = *it->second.shape;
+        return shape.heights[(size_t) (row - shape.firstRow) * shape.vertsPerRow + (column - shape.firstColumn)];
+    }
+
+    // Edited tiles that are not uploaded keep their edited heights here
+    auto edited = edits.find(key);
+    if (edited != edits.end()) {
+        const float height = edited->second.heights[(size_t) (row - key.second * TERRAIN_CHUNK_QUADS) * (TERRAIN_CHUNK_QUADS + 1)
+            + (column - key.first * TERRAIN_CHUNK_QUADS)];
+        if (!std::isnan(height)) {
+            return height;
+        }
+    }
+    return noiseHeight(column, row);
+}
+
+inline float Terrain::noiseHeight(int column, int row) const
+{
+    const float height = terrainVertexHeight(sampler, column, row, resolution);
+    return eroded ? height + eroded->at(column, row) : height;
+}
+
+inline bool Terrain::ErosionRegion::overlaps(int column, int row, int width, int height) const
+{
+    return column < first + size && column + width > first && row < first + size && row + height > first;
+}
+
+inline void Terrain::ErosionRegion::apply(float* heights, int pitch, int column, int row, int width, int height) const
+{
+    const int beginI = std::max(first - column, 0);
+    const int endI = std::min(first + size - column, width);
+    for (int j = std::max(first - row, 0); j < std::min(first + size - row, height); j++) {
+        const float* source = delta.data() + (size_t) (row + j - first) * size + (column - first);
+        float* out = heights + (size_t) j * pitch;
+        for (int i = beginI; i < endI; i++) {
+            out[i] += source[i];
+        }
+    }
+}
+
+inline float Terrain::ErosionRegion::at(int column, int row) const
+{
+    if (column < first || row < first || column >= first + size || row >= first + size) {
+        return 0.0f;
+    }
+    return delta[(size_t) (row - first) * size + (column - first)];
+}
+
+inline void Terrain::startErosion()
+{
+    erosionStarted = true;
+    if (erosionRegion <= 0 || erosion.dropletsPerSample <= 0.0f) {
+        return;
+    }
+
+    const int size = erosionRegion * TERRAIN_CHUNK_QUADS + 1;
+    const int first = -(erosionRegion * TERRAIN_CHUNK_QUADS / 2);
+    const float resolution = this->resolution;
+    const ErosionSettings settings = erosion;
+    ThreadPool& pool = ThreadPool::shared();
+    eroding = pool.submit([size, first, resolution, settings, &pool]() {
+        std::shared_ptr<ErosionRegion> region = std::make_shared<ErosionRegion>();
+        region->first = first;
+        region->size = size;
+
+        const FastNoiseLite noise = terrainNoise(resolution);
+        std::vector<float> heights((size_t) size * size);
+        terrainHeights(noise.GetSampler(), resolution, first, first, size, size, size, heights.data(), pool);
+        region->delta = heights;
+        erodeHeightfield(region->delta.data(), size, size, size, settings, pool);
+
+        // Faded out towards the border, so the terrain just outside meets it without a step
+        pool.parallelFor(0, size, [&](int beginRow, int endRow) {
+            for (int j = beginRow; j < endRow; j++) {
+                for (int i = 0; i < size; i++) {
+                    const int border = std::min(std::min(i, j), std::min(size - 1 - i, size - 1 - j));
+                    const float t = std::min((float) border / TERRAIN_EROSION_FADE, 1.0f);
+                    const size_t k = (size_t) j * size + i;
+                    region->delta[k] = (region->delta[k] - heights[k]) * t * t * (3.0f - 2.0f * t);
+                }
+            }
+        });
+        return std::shared_ptr<const ErosionRegion>(region);
+    });
+}
+
+inline void Terrain::finishErosion(bool wait)
+{
+    if (!eroding.valid() || (!wait && !isReady(eroding))) {
+        return;
+    }
+    // Not under the lock, the queries keep reading the plain noise meanwhile
+    eroding.wait();
+    std::lock_guard<std::shared_timed_mutex> lock(chunksMutex);
+    eroded = eroding.get();
+}
+
+inline bool Terrain::seesErosion(ChunkKey key) const
+{
+    if (!eroding.valid() && !eroded) {
+        return false;
+    }
+    const int size = erosionRegion * TERRAIN_CHUNK_QUADS + 1;
+    const int first = -(erosionRegion * TERRAIN_CHUNK_QUADS / 2);
+    const int column = key.first * TERRAIN_CHUNK_QUADS - TERRAIN_HORIZON_RADIUS;
+    const int row = key.second * TERRAIN_CHUNK_QUADS - TERRAIN_HORIZON_RADIUS;
+    const int width = TERRAIN_CHUNK_QUADS + 1 + 2 * TERRAIN_HORIZON_RADIUS;
+    return column < first + size && column + width > first && row < first + size && row + width > first;
+}
+
+inline void Terrain::packGridVertex(const Chunk& chunk, int i, int j, unsigned char* out) const
+{
+    const Shape& shape = *chunk.shape;
+    auto height = [&](int x, int z) {
+        if (x < 0 || z < 0 || x >= shape.vertsPerRow || z >= shape.vertsPerCol) {
+            return vertexHeight(shape.firstColumn + x, shape.firstRow + z);
+        }
+        return shape.heights[(size_t) z * shape.vertsPerRow + x];
+    };
+
+    // The same arithmetic heightfieldNormals does for a whole tile
+    const float row[3] = { height(i - 1, j), height(i, j), height(i + 1, j) };
+    const float up = height(i, j - 1);
+    const float down = height(i, j + 1);
+    float normal[3];
+    heightfieldNormalRow(&up, row + 1, &down, 1, shape.resolution, normal, normal + 1, normal + 2);
+
+    packVertex(chunk.format, row[1], normal, chunk.lighting.data() + ((size_t) j * shape.vertsPerRow + i) * 2, out);
+}
+
+inline void Terrain::edit(glm::vec2 center, float radius, std::function<float(float height, float u, float v)> brush)
+{
+    if (radius <= 0.0f) {
+        return;
+    }
+
+    // Global vertices under the brush square
+    Edit stroke;
+    stroke.center = center;
+    stroke.radius = radius;
+    stroke.firstColumn = static_cast<int>(std::ceil((center.x - radius) / resolution));
+    stroke.lastColumn = static_cast<int>(std::floor((center.x + radius) / resolution));
+    stroke.firstRow = static_cast<int>(std::ceil((center.y - radius) / resolution));
+    stroke.lastRow = static_cast<int>(std::floor((center.y + radius) / resolution));
+    stroke.brush = std::move(brush);
+    if (stroke.firstColumn > stroke.lastColumn || stroke.firstRow > stroke.lastRow) {
+        return;
+    }
+
+    // Every tile holding a vertex under the stroke, all of them first, so the normals repacked
+    // below see the edits of the neighbours. Both copies of a shared edge hold the same height
+    // and the brush only depends on global positions, so they get the same value.
+    for (int z = floorDivide(stroke.firstRow - 1, TERRAIN_CHUNK_QUADS); z <= floorDivide(stroke.lastRow, TERRAIN_CHUNK_QUADS); z++) {
+        for (int x = floorDivide(stroke.firstColumn - 1, TERRAIN_CHUNK_QUADS); x <= floorDivide(stroke.lastColumn, TERRAIN_CHUNK_QUADS); x++) {
+            applyEdit(ChunkKey(x, z), stroke);
+        }
+    }
+
+    repackVertices(stroke.firstColumn, stroke.lastColumn, stroke.firstRow, stroke.lastRow);
+    markLighting(stroke.firstColumn, stroke.lastColumn, stroke.firstRow, stroke.lastRow);
+    stroked = true;
+}
+
+inline void Terrain::applyEdit(ChunkKey key, const Edit& edit)
+{
+    const int vertsPerSide = TERRAIN_CHUNK_QUADS + 1;
+    const int firstColumn = key.first * TERRAIN_CHUNK_QUADS;
+    const int firstRow = key.second * TERRAIN_CHUNK_QUADS;
+    const int beginColumn = std::max(edit.firstColumn, firstColumn);
+    const int endColumn = std::min(edit.lastColumn, firstColumn + vertsPerSide - 1);
+    const int beginRow = std::max(edit.firstRow, firstRow);
+    const int endRow = std::min(edit.lastRow, firstRow + vertsPerSide - 1);
+    if (beginColumn > endColumn || beginRow > endRow) {
+        return;
+    }
+
+    TileEdits& edited = edits[key];
+    if (edited.heights.empty()) {
+        edited.heights.assign((size_t) vertsPerSide * vertsPerSide, std::numeric_limits<float>::quiet_NaN());
+    }
+    extendRange(edited.bounds, beginColumn - firstColumn, endColumn - firstColumn, beginRow - firstRow, endRow - firstRow);
+
+    // Anywhere else the heights are the ones vertexHeight reads
+    auto it = chunks.find(key);
+    Chunk* chunk = it != chunks.end() && it->second.uploaded ? &it->second : nullptr;
+    std::unique_lock<std::shared_timed_mutex> lock(chunksMutex, std::defer_lock);
+    if (chunk != nullptr) {
+        lock.lock();
+    }
+
+    for (int row = beginRow; row <= endRow; row++) {
+        float* heights = edited.heights.data() + (size_t) (row - firstRow) * vertsPerSide - firstColumn;
+        float* tileHeights = chunk != nullptr ? chunk->shape->heights.data() + (size_t) (row - firstRow) * vertsPerSide - firstColumn : nullptr;
+        for (int column = beginColumn; column <= endColumn; column++) {
+            float u = (column * resolution - edit.center.x) / edit.radius;
+            float v = (row * resolution - edit.center.y) / edit.radius;
+
+            float current = tileHeights != nullptr ? tileHeights[column] : heights[column];
+            if (std::isnan(current)) {
+                current = noiseHeight(column, row);
+            }
+            // Kept inside the range the 16-bit formats can hold
+            const float height = glm::clamp(edit.brush(current, u, v), TERRAIN_MIN_HEIGHT, TERRAIN_MAX_HEIGHT);
+            heights[column] = height;
+            if (chunk != nullptr) {
+                tileHeights[column] = height;
+                chunk->minHeight = std::min(chunk->minHeight, height);
+                chunk->maxHeight = std::max(chunk->maxHeight, height);
+            }
+        }
+    }
+
+    // Only the node edges through the changed vertices can stray differently now
+    if (chunk != nullptr) {
+        measureEdges(*chunk, beginColumn - firstColumn, endColumn - firstColumn, beginRow - firstRow, endRow - firstRow);
+    }
+}
+
+inline void Terrain::repackVertices(int firstColumn, int lastColumn, int firstRow, int lastRow)
+{
+    // Tiles holding a vertex whose normal depends on a height in the range
+    for (int z = floorDivide(firstRow - 2, TERRAIN_CHUNK_QUADS); z <= floorDivide(lastRow + 1, TERRAIN_CHUNK_QUADS); z++) {
+        for (int x = floorDivide(firstColumn - 2, TERRAIN_CHUNK_QUADS); x <= floorDivide(lastColumn + 1, TERRAIN_CHUNK_QUADS); x++) {
+            auto it = chunks.find(ChunkKey(x, z));
+            if (it != chunks.end() && it->second.uploaded) {
+                const Shape& shape = *it->second.shape;
+                repackChunk(it->second, firstColumn - 1 - shape.firstColumn, lastColumn + 1 - shape.firstColumn,
+                    firstRow - 1 - shape.firstRow, lastRow + 1 - shape.firstRow);
+            }
+        }
+    }
+}
+
+inline void Terrain::repackChunk(Chunk& chunk, int beginI, int endI, int beginJ, int endJ) const
+{
+    // Procedural tiles have nothing to repack
+    const Shape& shape = *chunk.shape;
+    beginI = std::max(beginI, 0);
+    endI = std::min(endI, shape.vertsPerRow - 1);
+    beginJ = std::max(beginJ, 0);
+    endJ = std::min(endJ, shape.vertsPerCol - 1);
+    if (beginI > endI || beginJ > endJ || chunk.VBO == 0) {
+        return;
+    }
+
+    // One buffer update per row, then the skirts of the nodes whose perimeter runs through the range
+    const size_t size = vertexSize(chunk.format);
+    std::vector<unsigned char> packed((endI - beginI + 1) * size);
+    glBindBuffer(GL_ARRAY_BUFFER, chunk.VBO);
+    for (int j = beginJ; j <= endJ; j++) {
+        for (int i = beginI; i <= endI; i++) {
+            packGridVertex(chunk, i, j, packed.data() + (i - beginI) * size);
+        }
+        glBufferSubData(GL_ARRAY_BUFFER, ((size_t) j * shape.vertsPerRow + beginI) * size, packed.size(), packed.data());
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER, chunk.skirtVBO);
+    packed.resize(TERRAIN_SKIRT_VERTICES * size);
+    for (int depth = 0, node = 0; depth < TERRAIN_LOD_LEVELS; depth++) {
+        const int nodeSize = TERRAIN_CHUNK_QUADS >> depth;
+        for (int nodeZ = 0; nodeZ < (1 << depth); nodeZ++) {
+            for (int nodeX = 0; nodeX < (1 << depth); nodeX++, node++) {
+                const int minI = nodeX * nodeSize;
+                const int minJ = nodeZ * nodeSize;
+                const bool overlaps = beginI <= minI + nodeSize && endI >= minI && beginJ <= minJ + nodeSize && endJ >= minJ;
+                const bool inside = beginI > minI && endI < minI + nodeSize && beginJ > minJ && endJ < minJ + nodeSize;
+                if (!overlaps || inside) {
+                    continue;
+                }
+
+                unsigned char* out = packed.data();
+                walkSkirt(depth, nodeX, nodeZ, [&](int i, int j) {
+                    packGridVertex(chunk, i, j, out);
+                    std::memcpy(out + size, out, size);
+                    out += 2 * size;
+                });
+                glBufferSubData(GL_ARRAY_BUFFER, (size_t) node * TERRAIN_SKIRT_VERTICES * size, packed.size(), packed.data());
+            }
+        }
+    }
+}
+
+inline void Terrain::markLighting(int firstColumn, int lastColumn, int firstRow, int lastRow)
+{
+    const int reach = TERRAIN_HORIZON_RADIUS;
+    for (int z = floorDivide(firstRow - reach - 1, TERRAIN_CHUNK_QUADS); z <= floorDivide(lastRow + reach, TERRAIN_CHUNK_QUADS); z++) {
+        for (int x = floorDivide(firstColumn - reach - 1, TERRAIN_CHUNK_QUADS); x <= floorDivide(lastColumn + reach, TERRAIN_CHUNK_QUADS); x++) {
+            auto it = chunks.find(ChunkKey(x, z));
+            if (it == chunks.end() || !it->second.uploaded) {
+                continue;
+            }
+
+            Chunk& chunk = it->second;
+            const Shape& shape = *chunk.shape;
+            const int beginI = std::max(firstColumn - reach - shape.firstColumn, 0);
+            const int endI = std::min(lastColumn + reach - shape.firstColumn, shape.vertsPerRow - 1);
+            const int beginJ = std::max(firstRow - reach - shape.firstRow, 0);
+            const int endJ = std::min(lastRow + reach - shape.firstRow, shape.vertsPerCol - 1);
+            if (beginI <= endI && beginJ <= endJ) {
+                extendRange(chunk.staleLighting, beginI, endI, beginJ, endJ);
+            }
+        }
+    }
+}
+
+inline void Terrain::extendRange(int* range, int beginI, int endI, int beginJ, int endJ)
+{
+    const bool empty = range[0] > range[1];
+    range[0] = empty ? beginI : std::min(range[0], beginI);
+    range[1] = empty ? endI : std::max(range[1], endI);
+    range[2] = empty ? beginJ : std::min(range[2], beginJ);
+    range[3] = empty ? endJ : std::max(range[3], endJ);
+}
+
+inline void Terrain::bakeLighting(Chunk& chunk)
+{
+    const Shape& shape = *chunk.shape;
+    int* stale = chunk.staleLighting;
+    const int width = stale[1] - stale[0] + 1;
+    const int height = stale[3] - stale[2] + 1;
+
+    // The stale vertices and everything their horizons see, the neighbours' heights included.
+    // Runs of a row inside an uploaded tile are copied, anything else is looked up vertex by vertex.
+    const int radius = TERRAIN_HORIZON_RADIUS;
+    const int pitch = width + 2 * radius;
+    std::vector<float> apron((size_t) pitch * (height + 2 * radius));
+    for (int j = 0; j < height + 2 * radius; j++) {
+        const int row = shape.firstRow + stale[2] - radius + j;
+        const int tileZ = floorDivide(row, TERRAIN_CHUNK_QUADS);
+        const int firstColumn = shape.firstColumn + stale[0] - radius;
+        float* out = apron.data() + (size_t) j * pitch - firstColumn;
+        for (int column = firstColumn; column < firstColumn + pitch;) {
+            const int tileX = floorDivide(column, TERRAIN_CHUNK_QUADS);
+            const int end = std::min(firstColumn + pitch, (tileX + 1) * TERRAIN_CHUNK_QUADS);
+            const Shape* tile = residentTile(ChunkKey(tileX, tileZ));
+            if (tile != nullptr) {
+                std::memcpy(out + column, tile->heights.data() + (size_t) (row - tile->firstRow) * tile->vertsPerRow + (column - tile->firstColumn),
+                    (size_t) (end - column) * sizeof(float));
+            }
+            else {
+                for (int i = column; i < end; i++) {
+                    out[i] = vertexHeight(i, row);
+                }
+            }
+            column = end;
+        }
+    }
+
+    // The worker only reads its own copy, so the tile may be edited or evicted meanwhile
+    const float resolution = this->resolution;
+    const glm::vec3 sun = -glm::normalize(SUN_DIRECTION);
+    ThreadPool& pool = ThreadPool::shared();
+    chunk.baking = pool.submit([apron = std::move(apron), pitch, width, height, resolution, sun, &pool]() {
+        std::vector<unsigned char> lighting((size_t) width * height * 2);
+        heightfieldHorizons(apron.data() + (size_t) TERRAIN_HORIZON_RADIUS * pitch + TERRAIN_HORIZON_RADIUS, pitch, width, height,
+            resolution, TERRAIN_HORIZON_RADIUS, &sun.x, lighting.data(), pool);
+        return lighting;
+    });
+
+    std::copy(stale, stale + 4, chunk.bakingLighting);
+    stale[0] = 1;
+    stale[1] = 0;
+}
+
+inline void Terrain::finishLighting(Chunk& chunk)
+{
+    const std::vector<unsigned char> lighting = chunk.baking.get();
+    const Shape& shape = *chunk.shape;
+    const int* baked = chunk.bakingLighting;
+    const int width = baked[1] - baked[0] + 1;
+    for (int j = baked[2]; j <= baked[3]; j++) {
+        std::memcpy(chunk.lighting.data() + ((size_t) j * shape.vertsPerRow + baked[0]) * 2,
+            lighting.data() + (size_t) (j - baked[2]) * width * 2, (size_t) width * 2);
+    }
+
+    // Heights edited since are packed with it too, their own bake follows
+    repackChunk(chunk, baked[0], baked[1], baked[2], baked[3]);
+}
+
+template <typename T>
+inline bool Terrain::isReady(const std::future<T>& future)
+{
+    return future.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+}
+
+inline Terrain::ChunkKey Terrain::chunkKey(const Chunk& chunk)
+{
+    return ChunkKey(chunk.shape->firstColumn / TERRAIN_CHUNK_QUADS, chunk.shape->firstRow / TERRAIN_CHUNK_QUADS);
+}
+
+inline int Terrain::chunkDistance(ChunkKey a, ChunkKey b)
+{
+    return std::max(std::abs(a.first - b.first), std::abs(a.second - b.second));
+}
+
+inline int Terrain::chunkDistanceSquared(ChunkKey a, ChunkKey b)
+{
+    int dx = a.first - b.first;
+    int dz = a.second - b.second;
+    return dx * dx + dz * dz;
+}
+
+inline void Terrain::update(glm::vec3 cameraPosition)
+{
+    const float size = chunkWorldSize();
+    const ChunkKey center(static_cast<int>(std::floor(cameraPosition.x / size)),
+        static_cast<int>(std::floor(cameraPosition.z / size)));
+
+    auto nearer = [&center](ChunkKey a, ChunkKey b) {
+        return chunkDistanceSquared(a, center) < chunkDistanceSquared(b, center);
+    };
+
+    if (!erosionStarted) {
+        startErosion();
+    }
+    finishErosion(false);
+
+    // Tiles still building, or built and waiting for their upload
+    int inFlight = 0;
+    std::vector<ChunkKey> finished;
+
+    for (auto it = chunks.begin(); it != chunks.end();) {
+        Chunk& chunk = it->second;
+        if (chunk.uploaded) {
+            ++it;
+        }
+        else if (!isReady(chunk.generated)) {
+            inFlight++;
+            ++it;
+        }
+        else if (chunkDistance(it->first, center) > viewRadius) {
+            // Finished after the camera moved away
+            std::lock_guard<std::shared_timed_mutex> lock(chunksMutex);
+            it = chunks.erase(it);
+        }
+        else {
+            finished.push_back(it->first);
+            inFlight++;
+            ++it;
+        }
+    }
+
+    std::sort(finished.begin(), finished.end(), nearer);
+    for (size_t i = 0; i < finished.size() && (int) i < uploadsPerFrame; i++) {
+        upload(chunks[finished[i]]);
+        inFlight--;
+    }
+
+    // At most one bake per tile in flight, however many strokes and uploads made its lighting
+    // stale meanwhile. None start while a brush is held, the stroke would only make them stale.
+    const bool stroking = stroked;
+    stroked = false;
+    for (auto& entry : chunks) {
+        Chunk& chunk = entry.second;
+        if (!chunk.uploaded) {
+            continue;
+        }
+        if (chunk.baking.valid() && isReady(chunk.baking)) {
+            finishLighting(chunk);
+        }
+        if (!stroking && !chunk.baking.valid() && chunk.staleLighting[0] <= chunk.staleLighting[1]) {
+            bakeLighting(chunk);
+        }
+    }
+
+    evict(center);
+    select(cameraPosition);
+
+    if (resident >= memoryBudget) {
+        return;
+    }
+
+    std::vector<ChunkKey> missing;
+    for (int z = center.second - viewRadius; z <= center.second + viewRadius; z++) {
+        for (int x = center.first - viewRadius; x <= center.first + viewRadius; x++) {
+            ChunkKey key(x, z);
+            // Tiles that see the eroded region wait for it
+            if (chunks.find(key) == chunks.end() && (eroded || !seesErosion(key))) {
+                missing.push_back(key);
+            }
+        }
+    }
+
+    // Nearest first, and only a couple of tiles per worker at a time so the queue
+    // never holds tiles the camera has already left behind
+    std::sort(missing.begin(), missing.end(), nearer);
+    const int maxInFlight = (int) ThreadPool::shared().size() * 2;
+    for (size_t i = 0; i < missing.size() && inFlight < maxInFlight; i++, inFlight++) {
+        generate(missing[i]);
+    }
+}
+
+inline void Terrain::generate(ChunkKey key)
+{
+    std::unique_lock<std::shared_timed_mutex> lock(chunksMutex);
+    Chunk& chunk = chunks[key];
+    lock.unlock();
+
+    chunk.shape = std::make_unique<Shape>();
+    chunk.format = vertexFormat;
+
+    Chunk* target = &chunk;
+    const int firstColumn = key.first * TERRAIN_CHUNK_QUADS;
+    const int firstRow = key.second * TERRAIN_CHUNK_QUADS;
+    const float resolution = this->resolution;
+    const glm::vec3 sun = -glm::normalize(SUN_DIRECTION);
+
+    const unsigned long long tileKey = cacheKey(chunk.format);
+    const std::string path = cacheDirectory.empty() ? std::string() : cachePath(key, tileKey);
+    if (!path.empty()) {
+        makeDirectory(cacheDirectory);
+    }
+
+    const std::shared_ptr<const ErosionRegion> region = eroded;
+    ThreadPool& pool = ThreadPool::shared();
+    chunk.generated = pool.submit([target, key, firstColumn, firstRow, resolution, sun, path, tileKey, region, &pool]() {
+        if (!path.empty() && loadCached(*target, path, tileKey, key, resolution)) {
+            return;
+        }
+
+        // One noise pass covers the tile and everything its horizons can see
+        const FastNoiseLite noise = terrainNoise(resolution);
+        const int pitch = TERRAIN_CHUNK_QUADS + 1 + 2 * TERRAIN_HORIZON_RADIUS;
+        std::vector<float> apron((size_t) pitch * pitch);
+        terrainHeights(noise.GetSampler(), resolution, firstColumn - TERRAIN_HORIZON_RADIUS, firstRow - TERRAIN_HORIZON_RADIUS,
+            pitch, pitch, pitch, apron.data(), pool);
+        if (region) {
+            region->apply(apron.data(), pitch, firstColumn - TERRAIN_HORIZON_RADIUS, firstRow - TERRAIN_HORIZON_RADIUS, pitch, pitch);
+        }
+        const float* tile = apron.data() + (size_t) TERRAIN_HORIZON_RADIUS * pitch + TERRAIN_HORIZON_RADIUS;
+
+        target->shape->buildGrid(TERRAIN_CHUNK_QUADS + 1, TERRAIN_CHUNK_QUADS + 1, resolution, pool, firstColumn, firstRow, tile, pitch);
+        target->lighting.resize(target->shape->heights.size() * 2);
+        heightfieldHorizons(tile, pitch, TERRAIN_CHUNK_QUADS + 1, TERRAIN_CHUNK_QUADS + 1, resolution, TERRAIN_HORIZON_RADIUS,
+            &sun.x, target->lighting.data(), pool);
+
+        packVertices(*target);
+        buildSkirts(*target);
+        std::vector<float>().swap(target->shape->vertices);
+
+        if (!path.empty()) {
+            storeCached(*target, path, tileKey, key);
+        }
+    });
+}
+
+inline unsigned long long Terrain::cacheKey(TerrainVertexFormat format) const
+{
+    // FNV-1a over everything that decides the contents of a tile
+    unsigned long long hash = noise.GetSettingsHash();
+    auto mix = [&hash](const void* data, size_t size) {
+        const unsigned char* bytes = static_cast<const unsigned char*>(data);
+        for (size_t i = 0; i < size; i++) {
+            hash = (hash ^ bytes[i]) * 1099511628211ull;
+        }
+    };
+
+    const glm::vec3 sun = glm::normalize(SUN_DIRECTION);
+    const float floats[] = { resolution, TERRAIN_NOISE_SCALING, TERRAIN_HEIGHT_SCALE, TERRAIN_MIN_HEIGHT, TERRAIN_MAX_HEIGHT, sun.x, sun.y, sun.z };
+    const int ints[] = { TERRAIN_NODE_QUADS, TERRAIN_LOD_LEVELS, (int) format, (int) TERRAIN_DOMAIN_WARP, (int) TERRAIN_CACHE_VERSION,
+        TERRAIN_HORIZON_RADIUS };
+    mix(floats, sizeof(floats));
+    mix(ints, sizeof(ints));
+
+    // Tiles inside the region get the same key as outside, the settings decide both
+    const int erosionInts[] = { erosion.dropletsPerSample > 0.0f ? erosionRegion : 0, TERRAIN_EROSION_FADE };
+    mix(erosionInts, sizeof(erosionInts));
+    mix(&erosion, sizeof(erosion));
+    return hash;
+}
+
+inline std::string Terrain::cachePath(ChunkKey key, unsigned long long cacheKey) const
+{
+    char name[80];
+    std::snprintf(name, sizeof(name), "/terrain_%016llx_%d_%d.bin", cacheKey, key.first, key.second);
+    return cacheDirectory + name;
+}
+
+inline bool Terrain::loadCached(Chunk& chunk, const std::string& path, unsigned long long cacheKey, ChunkKey key, float resolution)
+{
+    std::unique_ptr<MappedFile> file = std::make_unique<MappedFile>();
+    if (!file->open(path) || file->size() < sizeof(CacheHeader)) {
+        return false;
+    }
+
+    CacheHeader header;
+    std::memcpy(&header, file->data(), sizeof(header));
+
+    // Anything unexpected, including a file cut short, is treated as a miss and rebuilt
+    const size_t numVertices = (size_t) (TERRAIN_CHUNK_QUADS + 1) * (TERRAIN_CHUNK_QUADS + 1);
+    const size_t size = vertexSize(chunk.format);
+    if (std::memcmp(header.magic, "TRNC", 4) != 0 || header.version != TERRAIN_CACHE_VERSION || header.key != cacheKey
+        || header.tileX != key.first || header.tileZ != key.second || header.format != (unsigned int) chunk.format
+        || header.vertsPerSide != TERRAIN_CHUNK_QUADS + 1
+        || header.heightBytes != numVertices * sizeof(float)
+        || header.lightingBytes != numVertices * 2
+        || header.vertexBytes != numVertices * size
+        || header.skirtBytes != (size_t) TERRAIN_CHUNK_NODES * TERRAIN_SKIRT_VERTICES * size
+        || file->size() != sizeof(header) + header.heightBytes + header.lightingBytes + header.vertexBytes + header.skirtBytes) {
+        return false;
+    }
+
+    Shape& shape = *chunk.shape;
+    shape.vertsPerRow = shape.vertsPerCol = TERRAIN_CHUNK_QUADS + 1;
+    shape.resolution = resolution;
+    shape.firstColumn = key.first * TERRAIN_CHUNK_QUADS;
+    shape.firstRow = key.second * TERRAIN_CHUNK_QUADS;
+    shape.heights.resize(numVertices);
+    std::memcpy(shape.heights.data(), file->data() + sizeof(header), header.heightBytes);
+    chunk.lighting.resize(header.lightingBytes);
+    std::memcpy(chunk.lighting.data(), file->data() + sizeof(header) + header.heightBytes, header.lightingBytes);
+
+    chunk.minHeight = header.minHeight;
+    chunk.maxHeight = header.maxHeight;
+    measureEdges(chunk, 0, TERRAIN_CHUNK_QUADS, 0, TERRAIN_CHUNK_QUADS);
+    chunk.cacheFile = std::move(file);
+    return true;
+}
+
+inline void Terrain::storeCached(const Chunk& chunk, const std::string& path, unsigned long long cacheKey, ChunkKey key)
+{
+    const std::vector<float>& heights = chunk.shape->heights;
+
+    CacheHeader header;
+    std::memcpy(header.magic, "TRNC", 4);
+    header.version = TERRAIN_CACHE_VERSION;
+    header.key = cacheKey;
+    header.tileX = key.first;
+    header.tileZ = key.second;
+    header.format = (unsigned int) chunk.format;
+    header.vertsPerSide = TERRAIN_CHUNK_QUADS + 1;
+    header.minHeight = chunk.minHeight;
+    header.maxHeight = chunk.maxHeight;
+    header.heightBytes = (unsigned int) (heights.size() * sizeof(float));
+    header.lightingBytes = (unsigned int) chunk.lighting.size();
+    header.vertexBytes = (unsigned int) chunk.vertexData.size();
+    header.skirtBytes = (unsigned int) chunk.skirtData.size();
+
+    std::vector<unsigned char> file(sizeof(header) + header.heightBytes + header.lightingBytes + header.vertexBytes + header.skirtBytes);
+    unsigned char* out = file.data();
+    std::memcpy(out, &header, sizeof(header));
+    std::memcpy(out += sizeof(header), heights.data(), header.heightBytes);
+    std::memcpy(out += header.heightBytes, chunk.lighting.data(), header.lightingBytes);
+    std::memcpy(out += header.lightingBytes, chunk.vertexData.data(), header.vertexBytes);
+    std::memcpy(out += header.vertexBytes, chunk.skirtData.data(), header.skirtBytes);
+
+    // The cache only saves time; a tile that cannot be written is rebuilt next run
+    writeFileAtomic(path, file.data(), file.size());
+}
+
+inline size_t Terrain::vertexSize(TerrainVertexFormat format)
+{
+    switch (format) {
+    case TERRAIN_FLOAT:
+        return 5 * sizeof(float);
+    case TERRAIN_HEIGHT_NORMAL:
+        return sizeof(unsigned short) + 4;
+    default:
+        return sizeof(unsigned short) + 2;
+    }
+}
+
+inline void Terrain::packVertices(Chunk& chunk)
+{
+    const Shape& shape = *chunk.shape;
+    const size_t numVertices = shape.heights.size();
+    const size_t size = vertexSize(chunk.format);
+    const float* normals = shape.vertices.data() + numVertices * 3;
+
+    chunk.vertexData.resize(numVertices * size);
+    for (size_t i = 0; i < numVertices; i++) {
+        packVertex(chunk.format, shape.heights[i], normals + i * 3, chunk.lighting.data() + i * 2, chunk.vertexData.data() + i * size);
+    }
+}
+
+inline void Terrain::packVertex(TerrainVertexFormat format, float height, const float* normal, const unsigned char* lighting, unsigned char* out)
+{
+    // The lighting bytes close every format
+    const size_t size = vertexSize(format);
+    out[size - 2] = lighting[0];
+    out[size - 1] = lighting[1];
+
+    if (format == TERRAIN_FLOAT) {
+        float packed[4] = { height, normal[0], normal[1], normal[2] };
+        std::memcpy(out, packed, sizeof(packed));
+        // Keeps the lighting bytes 4-byte aligned
+        out[size - 4] = out[size - 3] = 0;
+        return;
+    }
+
+    // One fixed range for every tile, so shared edges quantize identically
+    unsigned short quantized = quantizeHeight(height, TERRAIN_MIN_HEIGHT, TERRAIN_MAX_HEIGHT);
+    std::memcpy(out, &quantized, sizeof(quantized));
+
+    if (format == TERRAIN_HEIGHT_NORMAL) {
+        octEncodeNormal(normal, reinterpret_cast<signed char*>(out + sizeof(quantized)));
+    }
+}
+
+// Calls visit(i, j) for the perimeter points of a node in strip order. The walk goes +x along the
+// far z edge, -z, -x along the near z edge, then +z back, so every strip triangle faces out of
+// the node; terrainShader.vert retraces it to place the strip vertices.
+template <typename Visit>
+inline void Terrain::walkSkirt(int depth, int nodeX, int nodeZ, Visit visit)
+{
+    const int nodeSize = TERRAIN_CHUNK_QUADS >> depth;
+    const int stride = nodeSize / TERRAIN_NODE_QUADS;
+    const int stepX[4] = { stride, 0, -stride, 0 };
+    const int stepZ[4] = { 0, -stride, 0, stride };
+
+    int i = nodeX * nodeSize;
+    int j = nodeZ * nodeSize + nodeSize;
+    for (int point = 0; point <= 4 * TERRAIN_NODE_QUADS; point++) {
+        visit(i, j);
+
+        if (point < 4 * TERRAIN_NODE_QUADS) {
+            int side = point / TERRAIN_NODE_QUADS;
+            i += stepX[side];
+            j += stepZ[side];
+        }
+    }
+}
+
+inline void Terrain::measureEdges(Chunk& chunk, int beginI, int endI, int beginJ, int endJ)
+{
+    const Shape& shape = *chunk.shape;
+    const int pitch = shape.vertsPerRow;
+    const float* heights = shape.heights.data();
+
+    // A vertex on a node corner ends the segments on both sides of it
+    auto segments = [](int begin, int end, int& first, int& last) {
+        first = std::max(begin - 1, 0) / TERRAIN_NODE_QUADS;
+        last = std::min(end / TERRAIN_NODE_QUADS, TERRAIN_CHUNK_SEGMENTS - 1);
+    };
+
+    for (int direction = 0; direction < 2; direction++) {
+        // Rows run along i and sit at every node edge j, columns the other way round
+        const int along[2] = { direction == 0 ? beginI : beginJ, direction == 0 ? endI : endJ };
+        const int across[2] = { direction == 0 ? beginJ : beginI, direction == 0 ? endJ : endI };
+        const int step = direction == 0 ? 1 : pitch;
+        int firstSegment, lastSegment;
+        segments(along[0], along[1], firstSegment, lastSegment);
+
+        const int firstLine = (std::max(across[0], 0) + TERRAIN_NODE_QUADS - 1) / TERRAIN_NODE_QUADS;
+        const int lastLine = std::min(across[1], TERRAIN_CHUNK_QUADS) / TERRAIN_NODE_QUADS;
+        for (int line = firstLine; line <= lastLine; line++) {
+            const float* edge = heights + (size_t) line * TERRAIN_NODE_QUADS * (direction == 0 ? pitch : 1);
+            for (int segment = firstSegment; segment <= lastSegment; segment++) {
+                float deviation = 0.0f;
+                for (int stride = 2; stride < (1 << TERRAIN_LOD_LEVELS); stride *= 2) {
+                    for (int k = segment * TERRAIN_NODE_QUADS; k < (segment + 1) * TERRAIN_NODE_QUADS; k++) {
+                        int k0 = k - k % stride;
+                        float t = (float) (k - k0) / stride;
+                        float coarse = edge[k0 * step] * (1.0f - t) + edge[(k0 + stride) * step] * t;
+                        deviation = std::max(deviation, std::abs(edge[k * step] - coarse));
+                    }
+                }
+                chunk.edgeDeviation[direction][line][segment] = deviation;
+            }
+        }
+    }
+}
+
+inline float Terrain::edgeLineDeviation(const Chunk& chunk, int direction, int line)
+{
+    const float* segments = chunk.edgeDeviation[direction][line];
+    return *std::max_element(segments, segments + TERRAIN_CHUNK_SEGMENTS);
+}
+
+inline float Terrain::skirtDepth(const Chunk& chunk) const
+{
+    float deviation = 0.0f;
+    for (int direction = 0; direction < 2; direction++) {
+        for (int line = 0; line <= TERRAIN_CHUNK_SEGMENTS; line++) {
+            deviation = std::max(deviation, edgeLineDeviation(chunk, direction, line));
+        }
+    }
+
+    // The gap between two node edges is at most the sum of how far each strays from the full
+    // resolution heights. Inside the tile both sides are measured on the same line; along the
+    // tile's own edges the other side belongs to the neighbour, which may stray further.
+    const int x = chunkKey(chunk).first;
+    const int z = chunkKey(chunk).second;
+    const struct { ChunkKey key; int direction; int line; } sides[4] = {
+        { ChunkKey(x - 1, z), 1, TERRAIN_CHUNK_SEGMENTS },
+        { ChunkKey(x + 1, z), 1, 0 },
+        { ChunkKey(x, z - 1), 0, TERRAIN_CHUNK_SEGMENTS },
+        { ChunkKey(x, z + 1), 0, 0 },
+    };
+    float other = deviation;
+    for (const auto& side : sides) {
+        auto it = chunks.find(side.key);
+        if (it != chunks.end() && it->second.uploaded) {
+            other = std::max(other, edgeLineDeviation(it->second, side.direction, side.line));
+        }
+    }
+
+    // terrainShader.vert lowers every second strip vertex by this much
+    return deviation + other + resolution;
+}
+
+inline void Terrain::buildSkirts(Chunk& chunk)
+{
+    const Shape& shape = *chunk.shape;
+    const int pitch = shape.vertsPerRow;
+
+    auto minmax = std::minmax_element(shape.heights.begin(), shape.heights.end());
+    chunk.minHeight = *minmax.first;
+    chunk.maxHeight = *minmax.second;
+    measureEdges(chunk, 0, TERRAIN_CHUNK_QUADS, 0, TERRAIN_CHUNK_QUADS);
+
+    // Strip vertices repeat the packed vertex of the perimeter point they hang from
+    const size_t size = vertexSize(chunk.format);
+    chunk.skirtData.resize((size_t) TERRAIN_CHUNK_NODES * TERRAIN_SKIRT_VERTICES * size);
+    unsigned char* out = chunk.skirtData.data();
+
+    for (int depth = 0; depth < TERRAIN_LOD_LEVELS; depth++) {
+        for (int nodeZ = 0; nodeZ < (1 << depth); nodeZ++) {
+            for (int nodeX = 0; nodeX < (1 << depth); nodeX++) {
+                walkSkirt(depth, nodeX, nodeZ, [&](int i, int j) {
+                    const unsigned char* source = chunk.vertexData.data() + ((size_t) j * pitch + i) * size;
+                    for (int bottom = 0; bottom < 2; bottom++, out += size) {
+                        std::memcpy(out, source, size);
+                    }
+                });
+            }
+        }
+    }
+}
+
+// Indices of the node at (0, 0) for a stride of 1 << level; other nodes add their first vertex as
+// base vertex. Strips are separated by 0xFFFFFFFF restart indices.
+inline void Terrain::buildNodeIndices(int level, bool strips, std::vector<unsigned int>& indices)
+{
+    const unsigned int pitch = TERRAIN_CHUNK_QUADS + 1;
+    const unsigned int stride = 1u << level;
+    auto vertex = [stride, pitch](unsigned int x, unsigned int z) {
+        return z * stride * pitch + x * stride;
+    };
+
+    indices.clear();
+    for (unsigned int z = 0; z < TERRAIN_NODE_QUADS; z++) {
+        if (strips) {
+            // Top, bottom, top, ... gives the same triangles and winding as the list below
+            if (z > 0) {
+                indices.push_back(0xFFFFFFFFu);
+            }
+            for (unsigned int x = 0; x <= TERRAIN_NODE_QUADS; x++) {
+                indices.push_back(vertex(x, z));
+                indices.push_back(vertex(x, z + 1));
+            }
+            continue;
+        }
+
+        for (unsigned int x = 0; x < TERRAIN_NODE_QUADS; x++) {
+            // Same winding as Shape::buildIndices
+            unsigned int topLeft = vertex(x, z);
+            unsigned int topRight = vertex(x + 1, z);
+            unsigned int bottomLeft = vertex(x, z + 1);
+            unsigned int bottomRight = vertex(x + 1, z + 1);
+
+            indices.insert(indices.end(), { topLeft, bottomLeft, topRight, topRight, bottomLeft, bottomRight });
+        }
+    }
+}
+
+inline void Terrain::setupNodeIndices()
+{
+    std::vector<unsigned int> indices;
+    indices.reserve(TERRAIN_NODE_INDICES);
+
+    for (int level = 0; level < TERRAIN_LOD_LEVELS; level++) {
+        NodeIndices& node = nodeIndices[level];
+        if (node.buffer == 0) {
+            glGenBuffers(1, &node.buffer);
+        }
+
+        buildNodeIndices(level, triangleStrips, indices);
+        node.count = (GLsizei) indices.size();
+
+        // 16 bits are enough while the node's far corner stays below the 0xFFFF restart index,
+        // which is every stride but the root's; narrowing turns 0xFFFFFFFF into 0xFFFF.
+        const unsigned int farCorner = (TERRAIN_CHUNK_QUADS + 2) * TERRAIN_NODE_QUADS * (1u << level);
+
+        // Filled through GL_ARRAY_BUFFER so no vertex array's element binding is touched
+        glBindBuffer(GL_ARRAY_BUFFER, node.buffer);
+        if (farCorner < 0xFFFFu) {
+            std::vector<unsigned short> narrow(indices.begin(), indices.end());
+            node.type = GL_UNSIGNED_SHORT;
+            glBufferData(GL_ARRAY_BUFFER, narrow.size() * sizeof(unsigned short), narrow.data(), GL_STATIC_DRAW);
+        }
+        else {
+            node.type = GL_UNSIGNED_INT;
+            glBufferData(GL_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), indices.data(), GL_STATIC_DRAW);
+        }
+    }
+
+    nodeIndexStrips = triangleStrips;
+}
+
+inline void Terrain::setupVertexArray(TerrainVertexFormat format, const void* data, size_t size, unsigned int& VAO, unsigned int& VBO)
+{
+    const GLsizei stride = (GLsizei) vertexSize(format);
+
+    glGenVertexArrays(1, &VAO);
+    glGenBuffers(1, &VBO);
+    glBindVertexArray(VAO);
+
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glBufferData(GL_ARRAY_BUFFER, size, data, GL_STATIC_DRAW);
+
+    // Ambient occlusion and sun visibility close every format
+    glVertexAttribPointer(2, 2, GL_UNSIGNED_BYTE, GL_TRUE, stride, (void*)(size_t)(stride - 2));
+    glEnableVertexAttribArray(2);
+
+    switch (format) {
+    case TERRAIN_FLOAT:
+        glVertexAttribPointer(0, 1, GL_FLOAT, GL_FALSE, stride, (void*)0);
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, stride, (void*)sizeof(float));
+        glEnableVertexAttribArray(1);
+        break;
+    case TERRAIN_HEIGHT_NORMAL:
+        // The normal bytes are read unnormalized, GL 3.3 would map them asymmetrically
+        glVertexAttribPointer(0, 1, GL_UNSIGNED_SHORT, GL_TRUE, stride, (void*)0);
+        glVertexAttribPointer(1, 2, GL_BYTE, GL_FALSE, stride, (void*)sizeof(unsigned short));
+        glEnableVertexAttribArray(1);
+        break;
+    default:
+        glVertexAttribPointer(0, 1, GL_UNSIGNED_SHORT, GL_TRUE, stride, (void*)0);
+        break;
+    }
+    glEnableVertexAttribArray(0);
+
+    glBindVertexArray(0);
+}
+
+inline void Terrain::upload(Chunk& chunk)
+{
+    chunk.generated.get();
+
+    const unsigned char* vertices = chunk.vertexData.data();
+    const unsigned char* skirts = chunk.skirtData.data();
+    size_t vertexBytes = chunk.vertexData.size();
+    size_t skirtBytes = chunk.skirtData.size();
+
+    if (chunk.cacheFile) {
+        // loadCached already checked the layout
+        CacheHeader header;
+        std::memcpy(&header, chunk.cacheFile->data(), sizeof(header));
+        vertices = chunk.cacheFile->data() + sizeof(header) + header.heightBytes + header.lightingBytes;
+        skirts = vertices + header.vertexBytes;
+        vertexBytes = header.vertexBytes;
+        skirtBytes = header.skirtBytes;
+    }
+
+    // Heights strokes left on the tile while it was generating or after it was evicted
+    Shape& shape = *chunk.shape;
+    const ChunkKey key = chunkKey(chunk);
+    auto own = edits.find(key);
+    if (own != edits.end()) {
+        const int* bounds = own->second.bounds;
+        for (int j = bounds[2]; j <= bounds[3]; j++) {
+            for (int i = bounds[0]; i <= bounds[1]; i++) {
+                const size_t k = (size_t) j * shape.vertsPerRow + i;
+                const float height = own->second.heights[k];
+                if (!std::isnan(height)) {
+                    shape.heights[k] = height;
+                    chunk.minHeight = std::min(chunk.minHeight, height);
+                    chunk.maxHeight = std::max(chunk.maxHeight, height);
+                }
+            }
+        }
+        measureEdges(chunk, bounds[0], bounds[1], bounds[2], bounds[3]);
+    }
+
+    if (proceduralHeights) {
+        vertexBytes = 0;
+        skirtBytes = 0;
+    }
+    else {
+        setupVertexArray(chunk.format, vertices, vertexBytes, chunk.VAO, chunk.VBO);
+        setupVertexArray(chunk.format, skirts, skirtBytes, chunk.skirtVAO, chunk.skirtVBO);
+    }
+
+    chunk.bytes = vertexBytes + skirtBytes + chunk.shape->heights.size() * sizeof(float) + chunk.lighting.size();
+
+    // Only the heights and the lighting stay on the CPU once the tile is on the GPU
+    std::vector<unsigned char>().swap(chunk.vertexData);
+    std::vector<unsigned char>().swap(chunk.skirtData);
+    chunk.cacheFile.reset();
+
+    std::unique_lock<std::shared_timed_mutex> lock(chunksMutex);
+    chunk.uploaded = true;
+    resident += chunk.bytes;
+    lock.unlock();
+
+    // The tile was packed and baked from the plain noise, so the vertices next to its edits and
+    // to its neighbours', and those whose horizons see them, are packed and baked again. The
+    // neighbours already read the edited heights through vertexHeight.
+    static_assert(TERRAIN_HORIZON_RADIUS < TERRAIN_CHUNK_QUADS, "Only the neighbours' edits reach a tile's lighting");
+    const int reach = TERRAIN_HORIZON_RADIUS;
+    for (int z = key.second - 1; z <= key.second + 1; z++) {
+        for (int x = key.first - 1; x <= key.first + 1; x++) {
+            auto edited = edits.find(ChunkKey(x, z));
+            if (edited == edits.end()) {
+                continue;
+            }
+
+            // The edited vertices in this tile's terms
+            const int* bounds = edited->second.bounds;
+            const int beginI = bounds[0] + (x - key.first) * TERRAIN_CHUNK_QUADS;
+            const int endI = bounds[1] + (x - key.first) * TERRAIN_CHUNK_QUADS;
+            const int beginJ = bounds[2] + (z - key.second) * TERRAIN_CHUNK_QUADS;
+            const int endJ = bounds[3] + (z - key.second) * TERRAIN_CHUNK_QUADS;
+            repackChunk(chunk, beginI - 1, endI + 1, beginJ - 1, endJ + 1);
+
+            const int staleBeginI = std::max(beginI - reach, 0);
+            const int staleEndI = std::min(endI + reach, shape.vertsPerRow - 1);
+            const int staleBeginJ = std::max(beginJ - reach, 0);
+            const int staleEndJ = std::min(endJ + reach, shape.vertsPerCol - 1);
+            if (staleBeginI <= staleEndI && staleBeginJ <= staleEndJ) {
+                extendRange(chunk.staleLighting, staleBeginI, staleEndI, staleBeginJ, staleEndJ);
+            }
+        }
+    }
+}
+
+inline void Terrain::evict(ChunkKey center)
+{
+    while (resident > memoryBudget) {
+        auto farthest = chunks.end();
+        for (auto it = chunks.begin(); it != chunks.end(); ++it) {
+            if (!it->second.uploaded || chunkDistance(it->first, center) <= viewRadius) {
+                continue;
+            }
+            if (farthest == chunks.end() || chunkDistanceSquared(it->first, center) > chunkDistanceSquared(farthest->first, center)) {
+                farthest = it;
+            }
+        }
+
+        // Everything left is in view, keep it even if that is over budget
+        if (farthest == chunks.end()) {
+            break;
+        }
+
+        Chunk& chunk = farthest->second;
+        glDeleteVertexArrays(1, &chunk.VAO);
+        glDeleteBuffers(1, &chunk.VBO);
+        glDeleteVertexArrays(1, &chunk.skirtVAO);
+        glDeleteBuffers(1, &chunk.skirtVBO);
+        resident -= farthest->second.bytes;
+
+        std::lock_guard<std::shared_timed_mutex> lock(chunksMutex);
+        chunks.erase(farthest);
+    }
+}
+
+inline void Terrain::select(glm::vec3 cameraPosition)
+{
+    // Shrink the split distance until the selection fits, or nothing is split any more
+    float scale = lodDistance;
+    while (true) {
+        selected.clear();
+        triangles = 0;
+
+        bool split = false;
+        for (const auto& entry : chunks) {
+            if (entry.second.uploaded) {
+                split |= selectNode(entry.second, entry.first, 0, 0, 0, cameraPosition, scale);
+            }
+        }
+
+        if (triangles <= triangleBudget || !split) {
+            break;
+        }
+        // A node around the camera is always split while scale is above zero
+        scale = scale > 0.01f ? scale * 0.75f : 0.0f;
+    }
+}
+
+inline bool Terrain::selectNode(const Chunk& chunk, ChunkKey key, int depth, int nodeX, int nodeZ, glm::vec3 cameraPosition, float scale)
+{
+    const int nodeSize = TERRAIN_CHUNK_QUADS >> depth;
+    const float worldSize = nodeSize * resolution;
+    const float minX = (key.first * TERRAIN_CHUNK_QUADS + nodeX * nodeSize) * resolution;
+    const float minZ = (key.second * TERRAIN_CHUNK_QUADS + nodeZ * nodeSize) * resolution;
+
+    // Distance from the camera to the node's bounding box
+    glm::vec3 nearest = glm::clamp(cameraPosition,
+        glm::vec3(minX, chunk.minHeight, minZ), glm::vec3(minX + worldSize, chunk.maxHeight, minZ + worldSize));
+
+    if (depth + 1 < TERRAIN_LOD_LEVELS && glm::distance(cameraPosition, nearest) < worldSize * scale) {
+        for (int child = 0; child < 4; child++) {
+            selectNode(chunk, key, depth + 1, nodeX * 2 + child % 2, nodeZ * 2 + child / 2, cameraPosition, scale);
+        }
+        return true;
+    }
+
+    // Nodes are stored level by level, row-major within a level
+    const int node = ((1 << (2 * depth)) - 1) / 3 + nodeZ * (1 << depth) + nodeX;
+
+    NodeDraw draw;
+    draw.chunk = &chunk;
+    draw.level = TERRAIN_LOD_LEVELS - 1 - depth;
+    draw.baseVertex = nodeZ * nodeSize * (TERRAIN_CHUNK_QUADS + 1) + nodeX * nodeSize;
+    draw.skirtFirst = node * TERRAIN_SKIRT_VERTICES;
+    selected.push_back(draw);
+
+    triangles += TERRAIN_NODE_INDICES / 3 + TERRAIN_SKIRT_VERTICES - 2;
+    return false;
+}
+
+inline void Terrain::Draw(Shader& shader)
+{
+    glm::vec3 color = { 1.0f, 1.0f, 1.0f };
+    shader.setValue("material.color_diffuse", color);
+    shader.setValue("gridPitch", TERRAIN_CHUNK_QUADS + 1);
+    shader.setValue("resolution", resolution);
+    shader.setValue("nodeQuads", TERRAIN_NODE_QUADS);
+
+    setNoiseUniforms(shader);
+
+    if (nodeIndices[0].buffer == 0 || nodeIndexStrips != triangleStrips) {
+        setupNodeIndices();
+    }
+    if (proceduralVAO == 0) {
+        glGenVertexArrays(1, &proceduralVAO);
+    }
+    const GLenum mode = nodeIndexStrips ? GL_TRIANGLE_STRIP : GL_TRIANGLES;
+
+    // The restart index is compared before baseVertex is added, so one value serves every node
+    if (nodeIndexStrips) {
+        glEnable(GL_PRIMITIVE_RESTART);
+    }
+
+    // The selection is grouped by tile: the tile's nodes first, then their skirts
+    for (size_t first = 0; first < selected.size();) {
+        const Chunk* chunk = selected[first].chunk;
+        size_t last = first;
+        while (last < selected.size() && selected[last].chunk == chunk) {
+            last++;
+        }
+
+        // Matches the packing in packVertices and the attributes in setupVertexArray. Procedural
+        // tiles have no normals either, shader.frag derives them.
+        const bool procedural = chunk->VAO == 0;
+        const bool quantized = chunk->format != TERRAIN_FLOAT;
+        shader.setValue("proceduralHeight", procedural);
+        shader.setValue("heightOffset", quantized ? TERRAIN_MIN_HEIGHT : 0.0f);
+        shader.setValue("heightScale", quantized ? TERRAIN_MAX_HEIGHT - TERRAIN_MIN_HEIGHT : 1.0f);
+        shader.setValue("normalEncoding", procedural ? 0 : (chunk->format == TERRAIN_FLOAT ? 2 : (chunk->format == TERRAIN_HEIGHT_NORMAL ? 1 : 0)));
+        shader.setValue("gridOrigin", glm::ivec2(chunk->shape->firstColumn, chunk->shape->firstRow));
+        if (procedural) {
+            setNoiseAnchors(shader, chunk->shape->firstColumn, chunk->shape->firstRow);
+        }
+
+        shader.setValue("skirt", false);
+        glBindVertexArray(procedural ? proceduralVAO : chunk->VAO);
+        int boundLevel = -1;
+        for (size_t i = first; i < last; i++) {
+            const NodeIndices& node = nodeIndices[selected[i].level];
+            if (selected[i].level != boundLevel) {
+                boundLevel = selected[i].level;
+                glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, node.buffer);
+                glPrimitiveRestartIndex(node.type == GL_UNSIGNED_SHORT ? 0xFFFFu : 0xFFFFFFFFu);
+            }
+            glDrawElementsBaseVertex(mode, node.count, node.type, 0, selected[i].baseVertex);
+        }
+
+        shader.setValue("skirt", true);
+        shader.setValue("skirtDepth", skirtDepth(*chunk));
+        glBindVertexArray(procedural ? proceduralVAO : chunk->skirtVAO);
+        for (size_t i = first; i < last; i++) {
+            const int pitch = TERRAIN_CHUNK_QUADS + 1;
+            shader.setValue("skirtFirst", selected[i].skirtFirst);
+            shader.setValue("nodeOrigin", glm::ivec2(selected[i].baseVertex % pitch, selected[i].baseVertex / pitch));
+            shader.setValue("nodeStride", 1 << selected[i].level);
+            glDrawArrays(GL_TRIANGLE_STRIP, selected[i].skirtFirst, TERRAIN_SKIRT_VERTICES);
+        }
+
+        first = last;
+    }
+
+    glDisable(GL_PRIMITIVE_RESTART);
+}
+
+inline void Terrain::setNoiseUniforms(Shader& shader) const
+{
+    const FastNoiseLite::FractalParameters parameters = noise.GetFractalParameters();
+    shader.setValue("noiseSeed", parameters.seed);
+    shader.setValue("noiseFrequency", parameters.frequency);
+    shader.setValue("noiseOctaves", std::min(parameters.octaves, FastNoiseLite::AnchorOctaves));
+    shader.setValue("noiseFadedOctave", parameters.fadedOctave);
+    shader.setValue("noiseFadedOctaveWeight", parameters.fadedOctaveWeight);
+    shader.setValue("noiseLacunarity", parameters.lacunarity);
+    shader.setValue("noiseGain", parameters.gain);
+    shader.setValue("noiseWeightedStrength", parameters.weightedStrength);
+    shader.setValue("noiseBounding", parameters.bounding);
+    shader.setValue("noiseWarpAmp", TERRAIN_DOMAIN_WARP ? parameters.warpAmp : 0.0f);
+    shader.setValue("noiseStep", resolution * TERRAIN_NOISE_SCALING);
+    shader.setValue("terrainHeightScale", TERRAIN_HEIGHT_SCALE);
+    shader.setValue("noiseAnchorSpacing", TERRAIN_NOISE_ANCHOR_SPACING);
+}
+
+inline void Terrain::setNoiseAnchors(Shader& shader, int firstColumn, int firstRow) const
+{
+    // A tile's last row and column may belong to the next anchor
+    static_assert(TERRAIN_NOISE_ANCHOR_SPACING % TERRAIN_CHUNK_QUADS == 0, "tiles must not straddle noise anchors");
+    const int rowAnchor = terrainNoiseAnchorIndex(firstRow);
+    const int columnAnchor = terrainNoiseAnchorIndex(firstColumn);
+
+    glm::ivec2 cells[2 * FastNoiseLite::AnchorOctaves];
+    glm::vec2 fractions[2 * FastNoiseLite::AnchorOctaves];
+    glm::ivec2 warpCells[4];
+    glm::vec2 warpFractions[4];
+    for (int a = 0; a < 2; a++) {
+        const FastNoiseLite::AxisAnchor x = terrainNoiseAnchor(noise, rowAnchor + a, resolution);
+        const FastNoiseLite::AxisAnchor y = terrainNoiseAnchor(noise, columnAnchor + a, resolution);
+        for (int i = 0; i < FastNoiseLite::AnchorOctaves; i++) {
+            cells[a * FastNoiseLite::AnchorOctaves + i] = glm::ivec2(x.cell[i], y.cell[i]);
+            fractions[a * FastNoiseLite::AnchorOctaves + i] = glm::vec2(x.fraction[i], y.fraction[i]);
+        }
+        for (int part = 0; part < 2; part++) {
+            warpCells[a * 2 + part] = glm::ivec2(x.warpCell[part], y.warpCell[part]);
+            warpFractions[a * 2 + part] = glm::vec2(x.warpFraction[part], y.warpFraction[part]);
+        }
+    }
+
+    shader.setValue("noiseAnchorFirst", glm::ivec2(columnAnchor, rowAnchor) * TERRAIN_NOISE_ANCHOR_SPACING);
+    shader.setValue("noiseCells", cells, 2 * FastNoiseLite::AnchorOctaves);
+    shader.setValue("noiseFractions", fractions, 2 * FastNoiseLite::AnchorOctaves);
+    shader.setValue("noiseWarpCells", warpCells, 4);
+    shader.setValue("noiseWarpFractions", warpFractions, 4);
+}
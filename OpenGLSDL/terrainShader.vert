@@ -0,0 +1,382 @@
+#version 330 core
+layout (location = 0) in float aHeight;
+layout (location = 1) in vec3 aNormal;
+// Baked ambient occlusion and sun visibility
+layout (location = 2) in vec2 aLighting;
+
+uniform mat4 view;
+uniform mat4 projection;
+
+// Tile vertex (i, j) is vertex j * gridPitch + i and sits at (gridOrigin + (i, j)) * resolution
+uniform ivec2 gridOrigin;
+uniform int gridPitch;
+uniform float resolution;
+
+uniform float heightOffset;
+uniform float heightScale;
+// 0: none, shader.frag falls back to screen space derivatives; 1: oct-encoded bytes; 2: xyz
+uniform int normalEncoding;
+
+// Skirt strips are drawn without indices. Strip vertex k hangs from perimeter point k / 2
+// of the node, lowered by skirtDepth when k is odd; see Terrain::buildSkirts.
+uniform bool skirt;
+uniform int skirtFirst;
+uniform ivec2 nodeOrigin;
+uniform int nodeStride;
+uniform int nodeQuads;
+uniform float skirtDepth;
+
+// Procedural heights replace aHeight: the terrain noise from terrainNoise, ported from FastNoiseLite.
+// Only its anchored Value noise FBm and OpenSimplex2 domain warp are here. The settings come from
+// FastNoiseLite::GetFractalParameters, see Terrain::setNoiseUniforms and setNoiseAnchors.
+uniform bool proceduralHeight;
+uniform int noiseSeed;
+uniform float noiseFrequency;
+uniform int noiseOctaves;
+uniform int noiseFadedOctave;
+uniform float noiseFadedOctaveWeight;
+uniform float noiseLacunarity;
+uniform float noiseGain;
+uniform float noiseWeightedStrength;
+uniform float noiseBounding;
+// 0 skips the warp
+uniform float noiseWarpAmp;
+// Noise units between neighbouring grid vertices
+uniform float noiseStep;
+uniform float terrainHeightScale;
+
+// The noise is sampled from anchors noiseAnchorSpacing vertices apart, FastNoiseLite::AxisAnchor
+// split per axis: anchor 0 is the one at vertex noiseAnchorFirst, below the tile's first vertex,
+// and anchor 1 the next one. In the arrays x holds the row anchors and y the column anchors.
+const int NOISE_ANCHOR_OCTAVES = 16;
+uniform ivec2 noiseAnchorFirst;
+uniform int noiseAnchorSpacing;
+// [anchor * NOISE_ANCHOR_OCTAVES + octave]
+uniform ivec2 noiseCells[2 * NOISE_ANCHOR_OCTAVES];
+uniform vec2 noiseFractions[2 * NOISE_ANCHOR_OCTAVES];
+// [anchor * 2]: the axis' own skewed warp coordinate, [anchor * 2 + 1]: added to the other axis
+uniform ivec2 noiseWarpCells[4];
+uniform vec2 noiseWarpFractions[4];
+
+out vec3 Normal;
+out vec3 FragPos;
+out vec2 TexCoords;
+out vec2 Lighting;
+
+// Hashes run on uint, which wraps like the int arithmetic in FastNoiseLite. Lerps are written
+// out because mix() may be computed differently.
+const uint PRIME_X = 501125321u;
+const uint PRIME_Y = 1136930381u;
+
+// FastNoiseLite::Lookup<float>, rounded to float
+const vec2 GRADIENTS_2D[128] = vec2[](
+    vec2(0.130526185, 0.991444886), vec2(0.382683426, 0.923879504), vec2(0.60876143, 0.793353319), vec2(0.793353319, 0.60876143),
+    vec2(0.923879504, 0.382683426), vec2(0.991444886, 0.130526185), vec2(0.991444886, -0.130526185), vec2(0.923879504, -0.382683426),
+    vec2(0.793353319, -0.60876143), vec2(0.60876143, -0.793353319), vec2(0.382683426, -0.923879504), vec2(0.130526185, -0.991444886),
+    vec2(-0.130526185, -0.991444886), vec2(-0.382683426, -0.923879504), vec2(-0.60876143, -0.793353319), vec2(-0.793353319, -0.60876143),
+    vec2(-0.923879504, -0.382683426), vec2(-0.991444886, -0.130526185), vec2(-0.991444886, 0.130526185), vec2(-0.923879504, 0.382683426),
+    vec2(-0.793353319, 0.60876143), vec2(-0.60876143, 0.793353319), vec2(-0.382683426, 0.923879504), vec2(-0.130526185, 0.991444886),
+    vec2(0.130526185, 0.991444886), vec2(0.382683426, 0.923879504), vec2(0.60876143, 0.793353319), vec2(0.793353319, 0.60876143),
+    vec2(0.923879504, 0.382683426), vec2(0.991444886, 0.130526185), vec2(0.991444886, -0.130526185), vec2(0.923879504, -0.382683426),
+    vec2(0.793353319, -0.60876143), vec2(0.60876143, -0.793353319), vec2(0.382683426, -0.923879504), vec2(0.130526185, -0.991444886),
+    vec2(-0.130526185, -0.991444886), vec2(-0.382683426, -0.923879504), vec2(-0.60876143, -0.793353319), vec2(-0.793353319, -0.60876143),
+    vec2(-0.923879504, -0.382683426), vec2(-0.991444886, -0.130526185), vec2(-0.991444886, 0.130526185), vec2(-0.923879504, 0.382683426),
+    vec2(-0.793353319, 0.60876143), vec2(-0.60876143, 0.793353319), vec2(-0.382683426, 0.923879504), vec2(-0.130526185, 0.991444886),
+    vec2(0.130526185, 0.991444886), vec2(0.382683426, 0.923879504), vec2(0.60876143, 0.793353319), vec2(0.793353319, 0.60876143),
+    vec2(0.923879504, 0.382683426), vec2(0.991444886, 0.130526185), vec2(0.991444886, -0.130526185), vec2(0.923879504, -0.382683426),
+    vec2(0.793353319, -0.60876143), vec2(0.60876143, -0.793353319), vec2(0.382683426, -0.923879504), vec2(0.130526185, -0.991444886),
+    vec2(-0.130526185, -0.991444886), vec2(-0.382683426, -0.923879504), vec2(-0.60876143, -0.793353319), vec2(-0.793353319, -0.60876143),
+    vec2(-0.923879504, -0.382683426), vec2(-0.991444886, -0.130526185), vec2(-0.991444886, 0.130526185), vec2(-0.923879504, 0.382683426),
+    vec2(-0.793353319, 0.60876143), vec2(-0.60876143, 0.793353319), vec2(-0.382683426, 0.923879504), vec2(-0.130526185, 0.991444886),
+    vec2(0.130526185, 0.991444886), vec2(0.382683426, 0.923879504), vec2(0.60876143, 0.793353319), vec2(0.793353319, 0.60876143),
+    vec2(0.923879504, 0.382683426), vec2(0.991444886, 0.130526185), vec2(0.991444886, -0.130526185), vec2(0.923879504, -0.382683426),
+    vec2(0.793353319, -0.60876143), vec2(0.60876143, -0.793353319), vec2(0.382683426, -0.923879504), vec2(0.130526185, -0.991444886),
+    vec2(-0.130526185, -0.991444886), vec2(-0.382683426, -0.923879504), vec2(-0.60876143, -0.793353319), vec2(-0.793353319, -0.60876143),
+    vec2(-0.923879504, -0.382683426), vec2(-0.991444886, -0.130526185), vec2(-0.991444886, 0.130526185), vec2(-0.923879504, 0.382683426),
+    vec2(-0.793353319, 0.60876143), vec2(-0.60876143, 0.793353319), vec2(-0.382683426, 0.923879504), vec2(-0.130526185, 0.991444886),
+    vec2(0.130526185, 0.991444886), vec2(0.382683426, 0.923879504), vec2(0.60876143, 0.793353319), vec2(0.793353319, 0.60876143),
+    vec2(0.923879504, 0.382683426), vec2(0.991444886, 0.130526185), vec2(0.991444886, -0.130526185), vec2(0.923879504, -0.382683426),
+    vec2(0.793353319, -0.60876143), vec2(0.60876143, -0.793353319), vec2(0.382683426, -0.923879504), vec2(0.130526185, -0.991444886),
+    vec2(-0.130526185, -0.991444886), vec2(-0.382683426, -0.923879504), vec2(-0.60876143, -0.793353319), vec2(-0.793353319, -0.60876143),
+    vec2(-0.923879504, -0.382683426), vec2(-0.991444886, -0.130526185), vec2(-0.991444886, 0.130526185), vec2(-0.923879504, 0.382683426),
+    vec2(-0.793353319, 0.60876143), vec2(-0.60876143, 0.793353319), vec2(-0.382683426, 0.923879504), vec2(-0.130526185, 0.991444886),
+    vec2(0.382683426, 0.923879504), vec2(0.923879504, 0.382683426), vec2(0.923879504, -0.382683426), vec2(0.382683426, -0.923879504),
+    vec2(-0.382683426, -0.923879504), vec2(-0.923879504, -0.382683426), vec2(-0.923879504, 0.382683426), vec2(-0.382683426, 0.923879504)
+);
+
+const vec2 RAND_VECS_2D[256] = vec2[](
+    vec2(-0.270022213, -0.962854087), vec2(0.386309266, -0.922369301), vec2(0.0444485918, -0.999011695), vec2(-0.599252343, -0.800560236),
+    vec2(-0.781928003, 0.62336874), vec2(0.946467221, 0.322799921), vec2(-0.651414692, -0.758721888), vec2(0.937847257, 0.347048372),
+    vec2(-0.849787593, -0.527125239), vec2(-0.879042566, 0.476743251), vec2(-0.892300308, -0.451442361), vec2(-0.379844427, -0.925050378),
+    vec2(-0.99516511, 0.0982163772), vec2(0.772439778, -0.635088027), vec2(0.757328331, -0.653034329), vec2(-0.992800474, -0.119780056),
+    vec2(-0.05326657, 0.998580337), vec2(0.975425363, -0.220330074), vec2(-0.766501844, 0.642242134), vec2(0.991636693, 0.129060611),
+    vec2(-0.994696856, 0.102850378), vec2(-0.537920535, -0.842995524), vec2(0.502281547, -0.864704132), vec2(0.455982149, -0.889988899),
+    vec2(-0.865913093, -0.50019443), vec2(0.0879458413, -0.996125281), vec2(-0.505168498, 0.863020718), vec2(0.775318503, -0.631570399),
+    vec2(-0.692194462, 0.72171104), vec2(-0.519165933, -0.854673445), vec2(0.897862315, -0.440276414), vec2(-0.170677409, 0.985326946),
+    vec2(-0.935343027, -0.353742063), vec2(-0.999240458, 0.0389674678), vec2(-0.288206398, -0.957568288), vec2(-0.966381133, 0.257113814),
+    vec2(-0.875971437, -0.482363015), vec2(-0.830312312, -0.557298362), vec2(0.0511013381, -0.998693466), vec2(-0.855837345, -0.517245054),
+    vec2(0.0988702551, 0.995100319), vec2(0.918901622, 0.394486785), vec2(-0.243937582, -0.969790936), vec2(-0.812140942, -0.583461285),
+    vec2(-0.99104315, 0.133542135), vec2(0.849242389, -0.528003156), vec2(-0.971783876, -0.235872954), vec2(0.994945705, 0.100414209),
+    vec2(0.624106526, -0.781339228), vec2(0.662910283, 0.748698831), vec2(-0.719741821, 0.694241822), vec2(-0.814337075, -0.580392241),
+    vec2(0.104521051, -0.994522691), vec2(-0.10659261, -0.99430275), vec2(0.445799679, -0.89513278), vec2(0.105547406, 0.99441427),
+    vec2(-0.992790282, 0.119864449), vec2(-0.833436668, 0.552615047), vec2(0.911556184, -0.411175609), vec2(0.828554511, -0.55990845),
+    vec2(0.721709788, -0.692195773), vec2(0.494049281, -0.86943388), vec2(-0.36523214, -0.930916488), vec2(-0.969660699, 0.244454846),
+    vec2(0.0892550945, -0.996008813), vec2(0.535407126, -0.844594121), vec2(-0.105357617, 0.994434416), vec2(-0.989028454, 0.147725105),
+    vec2(0.00485610496, 0.999988198), vec2(0.988559842, 0.150829136), vec2(0.928612947, -0.371049821), vec2(-0.583239377, -0.812300324),
+    vec2(0.301520765, 0.95345962), vec2(-0.957511067, 0.288396567), vec2(0.971580207, -0.236710548), vec2(0.229981795, 0.973194957),
+    vec2(0.955763817, -0.294135213), vec2(0.740956128, 0.671553433), vec2(-0.997151375, -0.0754263103), vec2(0.69057107, -0.723264515),
+    vec2(-0.290713698, -0.956810117), vec2(0.591277778, -0.80646795), vec2(-0.945459247, -0.325740486), vec2(0.666445553, 0.745553672),
+    vec2(0.623613477, 0.781732857), vec2(0.912699401, -0.408631653), vec2(-0.819176197, 0.573541939), vec2(-0.881274581, -0.472604603),
+    vec2(0.995331347, 0.0965167284), vec2(0.985565066, -0.169296965), vec2(-0.84959811, 0.527430654), vec2(0.617485404, -0.786582351),
+    vec2(0.850815654, 0.525464296), vec2(0.998503268, -0.0546924993), vec2(0.197137162, -0.980375946), vec2(0.660785556, -0.750574708),
+    vec2(-0.0309749413, 0.999520183), vec2(-0.673166096, 0.739491343), vec2(-0.719501853, -0.694490552), vec2(0.972751141, 0.231851593),
+    vec2(0.999705911, -0.0242506899), vec2(0.442178756, -0.896926939), vec2(0.99813509, -0.0610436723), vec2(-0.917366087, -0.398044556),
+    vec2(-0.81500566, -0.579452991), vec2(-0.878933132, 0.476945013), vec2(0.0158605836, 0.999874234), vec2(-0.809546471, 0.587055802),
+    vec2(-0.916589916, -0.399828672), vec2(-0.802354276, 0.596848071), vec2(-0.51767379, 0.855578065), vec2(-0.815440714, -0.578840554),
+    vec2(0.402201027, -0.915551364), vec2(-0.905255675, -0.424867213), vec2(0.731744587, 0.681578994), vec2(-0.564763248, -0.82525301),
+    vec2(-0.840327621, -0.542078853), vec2(-0.931428134, 0.363925248), vec2(0.523819864, 0.851829052), vec2(0.743280411, -0.668980002),
+    vec2(-0.98537159, -0.170419738), vec2(0.460146874, 0.887842834), vec2(0.825855374, 0.563881934), vec2(0.618236601, 0.785992026),
+    vec2(0.833150268, -0.553046644), vec2(0.150030747, 0.988681316), vec2(-0.662330389, -0.749211907), vec2(-0.668598652, 0.743623435),
+    vec2(0.702560604, 0.711623907), vec2(-0.541938961, -0.840417862), vec2(-0.338861644, 0.940836191), vec2(0.833153009, 0.553042531),
+    vec2(-0.29897207, -0.954261839), vec2(0.263852298, 0.964563072), vec2(0.124108739, -0.992268622), vec2(-0.728264928, -0.685295701),
+    vec2(0.696250021, 0.717799366), vec2(-0.918353558, 0.395761013), vec2(-0.632610202, -0.774470329), vec2(-0.933189213, -0.35938552),
+    vec2(-0.115377933, -0.993321657), vec2(0.951497495, -0.307656556), vec2(-0.0898797736, -0.995952606), vec2(0.66784972, 0.744296193),
+    vec2(0.795240045, -0.606294692), vec2(-0.646200716, -0.7631675), vec2(-0.273359865, 0.961911857), vec2(0.966959, -0.254931837),
+    vec2(-0.979289472, 0.202465191), vec2(-0.53695029, -0.843613863), vec2(-0.270036459, -0.962850094), vec2(-0.640027702, 0.768351853),
+    vec2(-0.785453737, -0.618920386), vec2(0.0600590557, -0.998194814), vec2(-0.0245577041, 0.9996984), vec2(-0.659836233, 0.751409471),
+    vec2(-0.625389457, -0.780312777), vec2(-0.621040881, -0.783778191), vec2(0.834888875, 0.550418556), vec2(-0.15922752, 0.987241924),
+    vec2(0.836762249, 0.547566354), vec2(-0.867575407, -0.497305691), vec2(-0.202266261, -0.97933054), vec2(0.939918995, 0.341397554),
+    vec2(0.987740457, -0.156104907), vec2(-0.903445542, 0.428702831), vec2(0.126980424, -0.991905212), vec2(-0.381960094, 0.924178839),
+    vec2(0.975462615, 0.220165253), vec2(-0.320401579, -0.947281837), vec2(-0.98747611, 0.157768741), vec2(0.0253534839, -0.999678552),
+    vec2(0.483513087, -0.875337124), vec2(-0.285079986, -0.958503723), vec2(-0.0680551603, -0.997681558), vec2(-0.788524389, -0.615003467),
+    vec2(0.318539202, -0.947909713), vec2(0.888004303, 0.459835142), vec2(0.647692144, -0.761902153), vec2(0.982024133, 0.188755423),
+    vec2(0.935727537, -0.352723718), vec2(-0.889489532, 0.456955522), vec2(0.792279124, 0.610158801), vec2(0.748381853, 0.663268149),
+    vec2(-0.728892982, -0.684627652), vec2(0.872903287, -0.487893283), vec2(0.828834593, 0.559493721), vec2(0.0807456672, 0.996734738),
+    vec2(0.979914844, -0.199416503), vec2(-0.580730677, -0.814095736), vec2(-0.470004976, -0.882663786), vec2(0.240949303, 0.970537722),
+    vec2(0.943781674, -0.330569416), vec2(-0.892799854, -0.45045355), vec2(-0.806962252, 0.590603054), vec2(0.0625897348, 0.998039365),
+    vec2(-0.931259751, 0.364355981), vec2(0.577744961, 0.816217363), vec2(-0.336009592, -0.94185859), vec2(0.697932065, -0.716163933),
+    vec2(-0.00200815732, -0.999997973), vec2(-0.182729438, -0.983163238), vec2(-0.652391195, 0.757882416), vec2(-0.430262685, -0.902703702),
+    vec2(-0.998512626, -0.0545209125), vec2(-0.0102810217, -0.999947131), vec2(-0.494607121, 0.869116664), vec2(-0.299935013, 0.953959644),
+    vec2(0.816547215, 0.577278674), vec2(0.269746035, 0.962931514), vec2(-0.730628729, -0.682774961), vec2(-0.759095192, -0.650979638),
+    vec2(-0.907053828, 0.421014607), vec2(-0.510486126, -0.859885991), vec2(0.861335039, 0.508037329), vec2(0.500788152, -0.86556989),
+    vec2(-0.654158175, 0.756357789), vec2(-0.838275552, -0.54524684), vec2(0.694007099, 0.7199682), vec2(0.0695093572, 0.997581303),
+    vec2(0.170294225, -0.985393286), vec2(0.269597322, 0.962973118), vec2(0.551961243, -0.833869755), vec2(0.225657493, -0.974206686),
+    vec2(0.421526283, -0.906816185), vec2(0.488187343, -0.872738838), vec2(-0.368385494, -0.929673135), vec2(-0.982539058, 0.18605645),
+    vec2(0.812564731, 0.58287102), vec2(0.31964609, -0.947537005), vec2(0.957091391, 0.289786249), vec2(-0.687665522, -0.726027608),
+    vec2(-0.998877108, -0.0473767295), vec2(-0.125017896, 0.992154479), vec2(-0.828013361, 0.560708344), vec2(0.932486355, -0.361205131),
+    vec2(0.639465332, 0.768819928), vec2(-0.0162384715, -0.999868155), vec2(-0.995501459, -0.0947461352), vec2(-0.814533174, 0.580116987),
+    vec2(0.403732806, -0.914876938), vec2(0.99442631, 0.10543368), vec2(-0.16247116, 0.98671329), vec2(-0.994948804, -0.100383878),
+    vec2(-0.699530244, 0.714603007), vec2(0.526341498, -0.850273252), vec2(-0.539522171, 0.841971397), vec2(0.65793705, 0.753072917),
+    vec2(0.014267588, -0.999898195), vec2(-0.67343837, 0.739243329), vec2(0.639412105, -0.768864214), vec2(0.921157122, 0.389190853),
+    vec2(-0.146637216, -0.98919034), vec2(-0.782318115, 0.622879088), vec2(-0.503961086, -0.863726377), vec2(-0.774312019, -0.632803977)
+);
+
+int fastFloor(float f)
+{
+    return f >= 0.0 ? int(f) : int(f) - 1;
+}
+
+float interpHermite(float t)
+{
+    return t * t * (3.0 - 2.0 * t);
+}
+
+float lerpNoise(float a, float b, float t)
+{
+    return a + t * (b - a);
+}
+
+uint noiseHash(int seed, uint xPrimed, uint yPrimed)
+{
+    return (uint(seed) ^ xPrimed ^ yPrimed) * 0x27d4eb2du;
+}
+
+float valueCoord(int seed, uint xPrimed, uint yPrimed)
+{
+    uint hash = noiseHash(seed, xPrimed, yPrimed);
+    hash *= hash;
+    hash ^= hash << 19;
+    return float(int(hash)) * (1.0 / 2147483648.0);
+}
+
+// SingleValueAnchored: at xCell + x and yCell + y
+float singleValue(int seed, int xCell, float x, int yCell, float y)
+{
+    int x0 = fastFloor(x);
+    int y0 = fastFloor(y);
+
+    float xs = interpHermite(x - float(x0));
+    float ys = interpHermite(y - float(y0));
+
+    uint xPrimed0 = (uint(x0) + uint(xCell)) * PRIME_X;
+    uint yPrimed0 = (uint(y0) + uint(yCell)) * PRIME_Y;
+    uint xPrimed1 = xPrimed0 + PRIME_X;
+    uint yPrimed1 = yPrimed0 + PRIME_Y;
+
+    float xf0 = lerpNoise(valueCoord(seed, xPrimed0, yPrimed0), valueCoord(seed, xPrimed1, yPrimed0), xs);
+    float xf1 = lerpNoise(valueCoord(seed, xPrimed0, yPrimed1), valueCoord(seed, xPrimed1, yPrimed1), xs);
+
+    return lerpNoise(xf0, xf1, ys);
+}
+
+// x and y are offsets from row anchor xAnchor and column anchor yAnchor
+float valueFBm(float x, float y, int xAnchor, int yAnchor)
+{
+    int seed = noiseSeed;
+    float sum = 0.0;
+    float amp = noiseBounding;
+
+    for (int i = 0; i < noiseOctaves; i++) {
+        if (i == noiseFadedOctave) {
+            amp *= noiseFadedOctaveWeight;
+        }
+
+        int xi = xAnchor * NOISE_ANCHOR_OCTAVES + i;
+        int yi = yAnchor * NOISE_ANCHOR_OCTAVES + i;
+        float noise = singleValue(seed++, noiseCells[xi].x, noiseFractions[xi].x + x, noiseCells[yi].y, noiseFractions[yi].y + y);
+        sum += noise * amp;
+        amp *= lerpNoise(1.0, min(noise + 1.0, 2.0) * 0.5, noiseWeightedStrength);
+
+        x *= noiseLacunarity;
+        y *= noiseLacunarity;
+        amp *= noiseGain;
+    }
+
+    return sum;
+}
+
+// GradCoordDual, scaled by the corner's falloff
+vec2 warpCorner(float falloff, uint xPrimed, uint yPrimed, vec2 d)
+{
+    if (falloff <= 0.0) {
+        return vec2(0.0);
+    }
+
+    uint hash = noiseHash(noiseSeed, xPrimed, yPrimed);
+    vec2 gradient = GRADIENTS_2D[(hash & 254u) >> 1];
+    vec2 direction = RAND_VECS_2D[((hash >> 7) & 510u) >> 1];
+    float value = d.x * gradient.x + d.y * gradient.y;
+
+    float ffff = (falloff * falloff) * (falloff * falloff);
+    return vec2(ffff * (value * direction.x), ffff * (value * direction.y));
+}
+
+// AnchoredWarpSimplex with DomainWarpType_OpenSimplex2, p from the anchors as in valueFBm
+vec2 domainWarp(vec2 p, int xAnchor, int yAnchor)
+{
+    const float G2 = 0.211324871;
+    const float F2 = 0.366025388;
+
+    float skew = (p.x + p.y) * F2;
+    float x = (noiseWarpFractions[xAnchor * 2].x + noiseWarpFractions[yAnchor * 2 + 1].y) + (p.x + skew) * noiseFrequency;
+    float y = (noiseWarpFractions[yAnchor * 2].y + noiseWarpFractions[xAnchor * 2 + 1].x) + (p.y + skew) * noiseFrequency;
+
+    int i = fastFloor(x);
+    int j = fastFloor(y);
+    float xi = x - float(i);
+    float yi = y - float(j);
+
+    float t = (xi + yi) * G2;
+    float x0 = xi - t;
+    float y0 = yi - t;
+
+    uint iPrimed = (uint(i) + uint(noiseWarpCells[xAnchor * 2].x) + uint(noiseWarpCells[yAnchor * 2 + 1].y)) * PRIME_X;
+    uint jPrimed = (uint(j) + uint(noiseWarpCells[yAnchor * 2].y) + uint(noiseWarpCells[xAnchor * 2 + 1].x)) * PRIME_Y;
+
+    float a = 0.5 - x0 * x0 - y0 * y0;
+    vec2 v = warpCorner(a, iPrimed, jPrimed, vec2(x0, y0));
+
+    float c = 3.15470052 * t + (-0.666666627 + a);
+    v += warpCorner(c, iPrimed + PRIME_X, jPrimed + PRIME_Y, vec2(x0 - 0.577350259, y0 - 0.577350259));
+
+    if (y0 > x0) {
+        vec2 d = vec2(x0 + G2, y0 - 0.788675129);
+        v += warpCorner(0.5 - d.x * d.x - d.y * d.y, iPrimed, jPrimed + PRIME_Y, d);
+    }
+    else {
+        vec2 d = vec2(x0 - 0.788675129, y0 + G2);
+        v += warpCorner(0.5 - d.x * d.x - d.y * d.y, iPrimed + PRIME_X, jPrimed, d);
+    }
+
+    return vec2(p.x + v.x * noiseWarpAmp, p.y + v.y * noiseWarpAmp);
+}
+
+// terrainVertexHeight: the noise is sampled as (row, column) from the anchors of the vertex
+float noiseHeight(ivec2 vertex)
+{
+    ivec2 local = vertex - noiseAnchorFirst;
+    ivec2 anchor = ivec2(local.x >= noiseAnchorSpacing ? 1 : 0, local.y >= noiseAnchorSpacing ? 1 : 0);
+    local -= anchor * noiseAnchorSpacing;
+
+    vec2 p = vec2(float(local.y) * noiseStep, float(local.x) * noiseStep);
+    if (noiseWarpAmp != 0.0) {
+        p = domainWarp(p, anchor.y, anchor.x);
+    }
+    return (valueFBm(p.x * noiseFrequency, p.y * noiseFrequency, anchor.y, anchor.x) + 0.5) * terrainHeightScale;
+}
+
+// Octahedron folded around +y, matching octEncodeNormal
+vec3 octDecode(vec2 e)
+{
+    vec3 n = vec3(e.x, 1.0 - abs(e.x) - abs(e.y), e.y);
+    if (n.y < 0.0) {
+        vec2 signs = vec2(n.x >= 0.0 ? 1.0 : -1.0, n.z >= 0.0 ? 1.0 : -1.0);
+        n.xz = (1.0 - abs(n.zx)) * signs;
+    }
+    return normalize(n);
+}
+
+void main()
+{
+    ivec2 vertex;
+    bool lowered = false;
+
+    if (skirt) {
+        int k = gl_VertexID - skirtFirst;
+        int point = k / 2;
+        int side = min(point / nodeQuads, 3);
+        int along = (point - side * nodeQuads) * nodeStride;
+        int size = nodeQuads * nodeStride;
+
+        if (side == 0) {
+            vertex = ivec2(along, size);
+        }
+        else if (side == 1) {
+            vertex = ivec2(size, size - along);
+        }
+        else if (side == 2) {
+            vertex = ivec2(size - along, 0);
+        }
+        else {
+            vertex = ivec2(0, along);
+        }
+        vertex += nodeOrigin;
+        lowered = k % 2 == 1;
+    }
+    else {
+        vertex = ivec2(gl_VertexID % gridPitch, gl_VertexID / gridPitch);
+    }
+
+    float height = proceduralHeight ? noiseHeight(gridOrigin + vertex) : heightOffset + aHeight * heightScale;
+    if (lowered) {
+        height -= skirtDepth;
+    }
+
+    vec3 position = vec3(float(gridOrigin.x + vertex.x) * resolution, height, float(gridOrigin.y + vertex.y) * resolution);
+
+    if (normalEncoding == 1) {
+        Normal = octDecode(aNormal.xy / 127.0);
+    }
+    else if (normalEncoding == 2) {
+        Normal = aNormal;
+    }
+    else {
+        Normal = vec3(0.0);
+    }
+
+    gl_Position = projection * view * vec4(position, 1.0);
+    FragPos = position;
+    TexCoords = vec2(0.0);
+    // Procedural heights have nothing baked
+    Lighting = proceduralHeight ? vec2(1.0) : aLighting;
+}
@@ -0,0 +1,153 @@
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+class ThreadPool {
+public:
+    // threadCount 0 means one worker per hardware thread
+    explicit ThreadPool(unsigned int threadCount = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    template <typename F>
+    auto submit(F&& task) -> std::future<decltype(task())>;
+
+    // Splits [begin, end) into contiguous bands and runs band(first, last) for each on the workers.
+    // Blocks until every band is done. Called from a worker it runs inline so nested use cannot deadlock.
+    void parallelFor(int begin, int end, const std::function<void(int, int)>& band);
+
+    unsigned int size() const;
+    static bool onWorkerThread();
+    static ThreadPool& shared();
+
+private:
+    std::vector<std::thread> workers;
+    std::queue<std::function<void()>> tasks;
+    std::mutex mutex;
+    std::condition_variable condition;
+    bool stopping = false;
+
+    void workerLoop();
+    static bool& workerFlag();
+};
+
+inline ThreadPool::ThreadPool(unsigned int threadCount)
+{
+    if (threadCount == 0) {
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    workers.reserve(threadCount);
+    for (unsigned int i = 0; i < threadCount; i++) {
+        workers.emplace_back(&ThreadPool::workerLoop, this);
+    }
+}
+
+inline ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    condition.notify_all();
+
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+template <typename F>
+auto ThreadPool::submit(F&& task) -> std::future<decltype(task())>
+{
+    using Result = decltype(task());
+
+    // std::function needs a copyable target, so the packaged_task lives behind a shared_ptr
+    auto packaged = std::make_shared<std::packaged_task<Result()>>(std::forward<F>(task));
+    std::future<Result> result = packaged->get_future();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        tasks.emplace([packaged]() { (*packaged)(); });
+    }
+    condition.notify_one();
+
+    return result;
+}
+
+inline void ThreadPool::parallelFor(int begin, int end, const std::function<void(int, int)>& band)
+{
+    const int count = end - begin;
+    if (count <= 0) {
+        return;
+    }
+
+    if (onWorkerThread()) {
+        band(begin, end);
+        return;
+    }
+
+    // A few bands per worker so uneven rows still balance out
+    const int bandCount = std::min(count, (int)size() * 4);
+    const int bandSize = (count + bandCount - 1) / bandCount;
+
+    std::vector<std::future<void>> pending;
+    pending.reserve(bandCount);
+    for (int first = begin; first < end; first += bandSize) {
+        int last = std::min(first + bandSize, end);
+        pending.push_back(submit([&band, first, last]() { band(first, last); }));
+    }
+
+    for (auto& result : pending) {
+        result.get();
+    }
+}
+
+inline unsigned int ThreadPool::size() const
+{
+    return (unsigned int)workers.size();
+}
+
+inline bool ThreadPool::onWorkerThread()
+{
+    return workerFlag();
+}
+
+inline ThreadPool& ThreadPool::shared()
+{
+    static ThreadPool pool;
+    return pool;
+}
+
+inline void ThreadPool::workerLoop()
+{
+    workerFlag() = true;
+
+    while (true) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            condition.wait(lock, [this]() { return stopping || !tasks.empty(); });
+            if (stopping && tasks.empty()) {
+                return;
+            }
+            task = std::move(tasks.front());
+            tasks.pop();
+        }
+        task();
+    }
+}
+
+inline bool& ThreadPool::workerFlag()
+{
+    thread_local bool flag = false;
+    return flag;
+}
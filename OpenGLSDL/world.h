@@ -1,56 +1,47 @@
 #pragma once
 
 #include <list>
+#include <memory>
 
 #include "object.h"
 
 class World {
 public:
-	std::list<std::unique_ptr<Object>> objects{};
+	std::list<std::shared_ptr<Object>> objects{};
 
-	void addObject(std::unique_ptr<Object>, glm::mat4);
-	void addObject(std::unique_ptr<Model>, std::vector<glm::mat4>);
+	void addObject(std::shared_ptr<Object>, glm::mat4);
+	void addObject(std::shared_ptr<Model>, std::vector<glm::mat4>);
 	void Draw(Shader&);
 	void Draw(Shader&, int);
+	void selectLod(glm::vec3 cameraPosition, const glm::mat4& projection);
+	void cull(glm::vec3 cameraPosition, const glm::mat4& viewProjection);
 };
 
-inline void World::addObject(std::unique_ptr<Object> obj, glm::mat4 location)
+inline void World::addObject(std::shared_ptr<Object> obj, glm::mat4 location)
 {
 	obj->location = location;
 	objects.push_back(std::move(obj));
 }
 
-inline void World::addObject(std::unique_ptr<Model> obj, std::vector<glm::mat4> locations)
+inline void World::addObject(std::shared_ptr<Model> obj, std::vector<glm::mat4> locations)
 {
-    unsigned int buffer;
-    glGenBuffers(1, &buffer);
-    glBindBuffer(GL_ARRAY_BUFFER, buffer);
-    glBufferData(GL_ARRAY_BUFFER, locations.size() * sizeof(glm::mat4), locations.data(), GL_STATIC_DRAW);
-
-    for (unsigned int i = 0; i < obj->meshes.size(); i++)
-    {
-        unsigned int VAO = obj->meshes[i].VAO;
-        glBindVertexArray(VAO);
-        // set attribute pointers for matrix (4 times vec4)
-        glEnableVertexAttribArray(3);
-        glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void*)0);
-        glEnableVertexAttribArray(4);
-        glVertexAttribPointer(4, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void*)(sizeof(glm::vec4)));
-        glEnableVertexAttribArray(5);
-        glVertexAttribPointer(5, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void*)(2 * sizeof(glm::vec4)));
-        glEnableVertexAttribArray(6);
-        glVertexAttribPointer(6, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void*)(3 * sizeof(glm::vec4)));
-
-        glVertexAttribDivisor(3, 1);
-        glVertexAttribDivisor(4, 1);
-        glVertexAttribDivisor(5, 1);
-        glVertexAttribDivisor(6, 1);
+    // A model still loading has no meshes yet and picks the locations up once it has
+    obj->setInstances(locations);
+    objects.push_back(std::move(obj));
+}
 
-        glBindVertexArray(0);
-    }
+inline void World::selectLod(glm::vec3 cameraPosition, const glm::mat4& projection)
+{
+	for (auto&& obj : objects) {
+		obj->selectLod(cameraPosition, projection);
+	}
+}
 
-    obj->locations = locations;
-    objects.push_back(std::move(obj));
+inline void World::cull(glm::vec3 cameraPosition, const glm::mat4& viewProjection)
+{
+	for (auto&& obj : objects) {
+		obj->cull(cameraPosition, viewProjection);
+	}
 }
 
 inline void World::Draw(Shader& shader)